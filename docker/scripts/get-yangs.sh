@@ -53,6 +53,7 @@ rm "$FILE_DOWNLOADZIP"
 # fill yang folder
 cp "$DIR_AVAILABLE_YANGS/"_3gpp-common*.yang "$DIR_YANGS"
 cp "$DIR_AVAILABLE_YANGS/"ietf-*.yang "$DIR_YANGS/"
+cp "$DIRBIN/local-yangs/"*.yang "$DIR_YANGS/"
 
 declare special_files=(
     "_3gpp-5g-common-yang-types.yang"
@@ -62,6 +62,8 @@ declare yang_files=(
     "_3gpp-5gc-ecmconnectioninfo.yang"
     "_3gpp-nr-nrm-nrcellcu.yang"
     "_3gpp-nr-nrm-desmanagementfunction.yang"
+
+    "o1-adapter-alarms.yang"
 )
 
 # checkAL ERROR IN 3GPP FILES
@@ -27,11 +27,83 @@
 #include "common/log.h"
 #include "ves/ves.h"
 #include "netconf/netconf_data.h"
+#include "common/utils.h"
+#include "alarms_inventory.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
+typedef enum alarms_comparator {
+    ALARMS_COMPARATOR_GT = 0,
+    ALARMS_COMPARATOR_GE,
+    ALARMS_COMPARATOR_LT,
+    ALARMS_COMPARATOR_LE,
+} alarms_comparator_t;
+
+typedef enum alarms_scope {
+    ALARMS_SCOPE_CELL = 0,
+    ALARMS_SCOPE_UE,
+} alarms_scope_t;
+
+struct alarms_rule;
+
+// alarm of a ue scope rule, exists from the first time its condition holds until it is cleared again
+typedef struct alarms_instance {
+    alarm_t alarm;                      // first, the inventory hands out &instance->alarm
+    const struct alarms_rule *rule;
+    struct alarms_instance *next;       // the rule's instances
+    struct alarms_instance *prev;
+    unsigned int seen;                  // alarms_generation of the last sample that had the UE
+} alarms_instance_t;
+
+// what a ue scope rule stamps its instances from
+typedef struct alarms_rule_ue {
+    char *alarm;                        // shared by all instances
+    alarm_severity_t severity;
+    alarm_type_t type;
+    const alarm_t *suppressor;
+    char *prefix;                       // object instance before @ue-id@
+    char *suffix;                       // object instance after @ue-id@
+    char *key;                          // object instance of the UE being looked at
+    alarms_instance_t *instances;
+} alarms_rule_ue_t;
+
+/**
+ * compiled alarm rule, kept small so a tick over many rules stays within a few cache lines
+ *   the alarm condition holds once metric <comparator> raise, and stops holding only once
+ *   metric <comparator> clear is false again (hysteresis band between the two thresholds)
+*/
+typedef struct alarms_rule {
+    double raise;
+    double clear;
+    alarm_t *alarm;             // ALARMS_SCOPE_CELL
+    alarms_rule_ue_t *ue;       // ALARMS_SCOPE_UE
+    int debounce;               // milliseconds a change has to persist
+    uint8_t metric;             // alarms_metric_t
+    uint8_t comparator;         // alarms_comparator_t
+    uint8_t scope;              // alarms_scope_t
+} alarms_rule_t;
+
 static int alarm_raise(alarm_t *alarm);
 static int alarm_clear(alarm_t *alarm);
+static void alarms_alarm_setup(alarm_t *alarm);
+static void alarms_alarm_cancel(alarm_t *alarm);
+static void alarms_report(alarm_t *alarm);
+static void alarms_report_send(alarm_t *alarm, alarm_state_t state, alarm_severity_t severity);
+static void alarms_report_dependents(const alarm_t *suppressor);
+static void alarms_settle(alarm_t *alarm);
+static const alarm_t *alarms_find_suppressor(const char *name);
+static int alarms_rule_compile(const config_alarm_rule_t *config, alarms_rule_t *rule, alarm_t *alarm, alarms_rule_ue_t *ue);
+static int alarms_rule_verdict(const alarms_rule_t *rule, double value);
+static void alarms_rule_condition(alarm_t *alarm, int debounce, bool holds);
+static void alarms_rule_ue_feed(const alarms_rule_t *rule, const alarms_data_t *alarms_data);
+static void alarms_timer_expired(void *arg);
+static void alarms_report_expired(void *arg);
+static void alarms_flap_expired(void *arg);
+static alarms_instance_t *alarms_instance_new(const alarms_rule_t *rule, const char *object_instance);
+static void alarms_instance_free(alarms_instance_t *instance);
 
 static alarm_t alarm_internal_connection_loss = {
     .alarm = "internalConnectionLoss",
@@ -39,23 +111,21 @@ static alarm_t alarm_internal_connection_loss = {
     .type = ALARM_TYPE_COMMUNICATIONS_ALARM,
     .object_instance = 0,
     .state = ALARM_STATE_CLEARED,
-    .timeout = 0,
 };
 
-static alarm_t alarm_load_downlink_exceeded_warning = {
-    .alarm = "loadDownlinkExceededWarning",
-    .severity = ALARM_SEVERITY_WARNING,
-    .type = ALARM_TYPE_EQUIPMENT_ALARM,
-    .object_instance = 0,
-    .state = ALARM_STATE_CLEARED,
-    .timeout = 0,
+static const char *alarms_metric_names[ALARMS_METRICS] = {
+    "load",
+    "num-ues",
+    "ue-thp-dl",
+    "ue-thp-ul",
 };
 
-static const alarm_t *alarms[] = {
-    &alarm_internal_connection_loss,
-    &alarm_load_downlink_exceeded_warning,
-    0
-};
+// one entry per rule, the alarm is used by cell scope rules and the template by ue scope ones
+static alarms_rule_t *alarms_rules = 0;
+static alarm_t *alarms_rule_alarms = 0;
+static alarms_rule_ue_t *alarms_rule_ues = 0;
+static int alarms_rules_len = 0;
+static unsigned int alarms_generation = 0;
 
 static const config_t *alarms_config = 0;
 static int alarm_notification_id = 1;
@@ -71,24 +141,112 @@ int alarms_init(const config_t *config) {
     alarms_config = config;
     alarm_notification_id = 1;
 
+    rc = alarms_inventory_init(64);
+    if(rc != 0) {
+        log_error("alarms_inventory_init() failed");
+        goto failed;
+    }
+
     asprintf(&alarm_internal_connection_loss.object_instance, "ManagedElement=%s", alarms_config->info.node_id);
     if(alarm_internal_connection_loss.object_instance == 0) {
         log_error("asprintf failed");
         goto failed;
     }
+    alarms_alarm_setup(&alarm_internal_connection_loss);
 
-    asprintf(&alarm_load_downlink_exceeded_warning.object_instance, "ManagedElement=%s,GNBDUFunction=%d,NRCellDU=0", alarms_config->info.node_id, alarms_config->info.gnb_du_id);
-    if(alarm_load_downlink_exceeded_warning.object_instance == 0) {
-        log_error("asprintf failed");
+    rc = alarms_inventory_add(&alarm_internal_connection_loss);
+    if(rc != 0) {
+        log_error("alarms_inventory_add(%s) failed", alarm_internal_connection_loss.alarm);
         goto failed;
     }
 
-    rc = netconf_data_alarms_init(alarms);
-    if(rc != 0) {
-        log_error("netconf_data_alarms_init() error");
+    const config_alarm_rule_t *rules = config->alarms.rules;
+    int rules_len = config->alarms.rules_len;
+    config_alarm_rule_t load_rule = {
+        .alarm = "loadDownlinkExceededWarning",
+        .metric = "load",
+        .comparator = ">",
+        .raise = config->alarms.load_downlink_exceeded_warning_threshold,
+        .clear = config->alarms.load_downlink_exceeded_warning_threshold,
+        .debounce = config->alarms.load_downlink_exceeded_warning_timeout,
+        .severity = "WARNING",
+        .type = "EQUIPMENT_ALARM",
+        .object_instance = "ManagedElement=@node-id@,GNBDUFunction=@gnb-du-id@,NRCellDU=0",
+        .scope = "cell",
+    };
+    if(rules_len == 0) {
+        // configs without rules keep the single load alarm they always had
+        rules = &load_rule;
+        rules_len = 1;
+    }
+
+    alarms_rules = (alarms_rule_t *)calloc(rules_len, sizeof(alarms_rule_t));
+    alarms_rule_alarms = (alarm_t *)calloc(rules_len, sizeof(alarm_t));
+    alarms_rule_ues = (alarms_rule_ue_t *)calloc(rules_len, sizeof(alarms_rule_ue_t));
+    if((alarms_rules == 0) || (alarms_rule_alarms == 0) || (alarms_rule_ues == 0)) {
+        log_error("calloc failed");
         goto failed;
     }
 
+    for(int i = 0; i < rules_len; i++) {
+        alarms_rules_len++;
+        rc = alarms_rule_compile(&rules[i], &alarms_rules[i], &alarms_rule_alarms[i], &alarms_rule_ues[i]);
+        if(rc != 0) {
+            log_error("alarms_rule_compile(%s) failed", rules[i].alarm);
+            goto failed;
+        }
+
+        if(alarms_rules[i].scope == ALARMS_SCOPE_CELL) {
+            rc = alarms_inventory_add(alarms_rules[i].alarm);
+            if(rc != 0) {
+                log_error("alarms_inventory_add(%s) failed", rules[i].alarm);
+                goto failed;
+            }
+            continue;
+        }
+
+        // instances are told apart from other alarms by name alone
+        bool shared = (strcmp(rules[i].alarm, alarm_internal_connection_loss.alarm) == 0);
+        for(int j = 0; j < rules_len; j++) {
+            if((j != i) && (strcmp(rules[i].alarm, rules[j].alarm) == 0)) {
+                shared = true;
+            }
+        }
+        if(shared) {
+            log_error("ue scope alarm %s shares its name with another alarm", rules[i].alarm);
+            goto failed;
+        }
+    }
+
+    // correlation, resolved once every alarm exists
+    for(int i = 0; i < rules_len; i++) {
+        if(rules[i].suppressed_by == 0) {
+            continue;
+        }
+
+        const alarm_t *suppressor = alarms_find_suppressor(rules[i].suppressed_by);
+        if(suppressor == 0) {
+            log_error("alarm %s is suppressed by %s, which is unknown, per UE or not unique", rules[i].alarm, rules[i].suppressed_by);
+            goto failed;
+        }
+
+        if(alarms_rules[i].scope == ALARMS_SCOPE_CELL) {
+            alarms_rules[i].alarm->suppressor = suppressor;
+        }
+        else {
+            alarms_rules[i].ue->suppressor = suppressor;
+        }
+    }
+
+    for(int i = 0; i < rules_len; i++) {
+        const alarm_t *suppressor = (alarms_rules[i].scope == ALARMS_SCOPE_CELL) ? alarms_rules[i].alarm->suppressor : alarms_rules[i].ue->suppressor;
+        if(suppressor && suppressor->suppressor) {
+            // one level only, a suppressor's reports are never held back
+            log_error("alarm %s is suppressed by %s, which is suppressed itself", rules[i].alarm, suppressor->alarm);
+            goto failed;
+        }
+    }
+
     return 0;
 failed:
     alarms_free();
@@ -96,14 +254,34 @@ failed:
 }
 
 int alarms_free() {
-    alarm_t **alarm = (alarm_t **)alarms;
-    while(*alarm) {
-        free((*alarm)->object_instance);
-        (*alarm)->object_instance = 0;
-        (*alarm)->state = ALARM_STATE_CLEARED;
-        (*alarm)->timeout = 0;
-        alarm++;
+    for(int i = 0; i < alarms_rules_len; i++) {
+        alarms_rule_ue_t *ue = &alarms_rule_ues[i];
+        while(ue->instances) {
+            alarms_instance_free(ue->instances);
+        }
+        free(ue->alarm);
+        free(ue->prefix);
+        free(ue->suffix);
+        free(ue->key);
+
+        alarms_alarm_cancel(&alarms_rule_alarms[i]);
+        free(alarms_rule_alarms[i].alarm);
+        free(alarms_rule_alarms[i].object_instance);
     }
+    free(alarms_rule_ues);
+    alarms_rule_ues = 0;
+    free(alarms_rule_alarms);
+    alarms_rule_alarms = 0;
+    free(alarms_rules);
+    alarms_rules = 0;
+    alarms_rules_len = 0;
+
+    alarms_alarm_cancel(&alarm_internal_connection_loss);
+    free(alarm_internal_connection_loss.object_instance);
+    alarm_internal_connection_loss.object_instance = 0;
+    alarm_internal_connection_loss.state = ALARM_STATE_CLEARED;
+
+    alarms_inventory_free();
 
     alarms_config = 0;
     return 0;
@@ -189,14 +367,35 @@ const char *alarm_type_to_str(const alarm_type_t type) {
     }
 }
 
+int alarm_severity_from_str(const char *severity) {
+    for(int i = ALARM_SEVERITY_INDETERMINATE; i <= ALARM_SEVERITY_CRITICAL; i++) {
+        if(strcmp(severity, alarm_severity_to_str(i)) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+int alarm_type_from_str(const char *type) {
+    for(int i = ALARM_TYPE_COMMUNICATIONS_ALARM; i <= ALARM_TYPE_TIME_DOMAIN_VIOLATION; i++) {
+        if(strcmp(type, alarm_type_to_str(i)) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
 void alarms_on_telnet_connected() {
     log("telnet connected");
     if(alarm_internal_connection_loss.state == ALARM_STATE_RAISED) {
         alarm_internal_connection_loss.state = ALARM_STATE_CLEAR;
-        alarm_internal_connection_loss.timeout = 0;
+        timer_wheel_add(&alarm_internal_connection_loss.timer, 0);
     }
     else if(alarm_internal_connection_loss.state == ALARM_STATE_RAISE) {
         alarm_internal_connection_loss.state = ALARM_STATE_CLEARED;
+        timer_wheel_cancel(&alarm_internal_connection_loss.timer);
     }
 }
 
@@ -204,10 +403,11 @@ void alarms_on_telnet_disconnected() {
     log_error("telnet disconnected");
     if(alarm_internal_connection_loss.state == ALARM_STATE_CLEARED) {
         alarm_internal_connection_loss.state = ALARM_STATE_RAISE;
-        alarm_internal_connection_loss.timeout = alarms_config->alarms.internal_connection_lost_timeout;
+        timer_wheel_add(&alarm_internal_connection_loss.timer, alarms_config->alarms.internal_connection_lost_timeout * 1000L);
     }
     else if(alarm_internal_connection_loss.state == ALARM_STATE_CLEAR) {
         alarm_internal_connection_loss.state = ALARM_STATE_RAISED;
+        timer_wheel_cancel(&alarm_internal_connection_loss.timer);
     }
 }
 
@@ -217,24 +417,18 @@ int alarms_data_feed(const alarms_data_t *alarms_data) {
         goto failed;
     }
 
-    if(alarms_data->load > alarms_config->alarms.load_downlink_exceeded_warning_threshold) {
-        if(alarm_load_downlink_exceeded_warning.state == ALARM_STATE_CLEARED) {
-            alarm_load_downlink_exceeded_warning.state = ALARM_STATE_RAISE;
-            alarm_load_downlink_exceeded_warning.timeout = alarms_config->alarms.load_downlink_exceeded_warning_timeout;
-        }
-        else if(alarm_load_downlink_exceeded_warning.state == ALARM_STATE_CLEAR) {
-            alarm_load_downlink_exceeded_warning.state = ALARM_STATE_RAISED;
-            alarm_load_downlink_exceeded_warning.timeout = alarms_config->alarms.load_downlink_exceeded_warning_timeout;
-        }
-    }
-    else {
-        if(alarm_load_downlink_exceeded_warning.state == ALARM_STATE_RAISED) {
-            alarm_load_downlink_exceeded_warning.state = ALARM_STATE_CLEAR;
-            alarm_load_downlink_exceeded_warning.timeout = alarms_config->alarms.load_downlink_exceeded_warning_timeout;
+    alarms_generation++;
+    for(int i = 0; i < alarms_rules_len; i++) {
+        const alarms_rule_t *rule = &alarms_rules[i];
+
+        if(rule->scope == ALARMS_SCOPE_UE) {
+            alarms_rule_ue_feed(rule, alarms_data);
+            continue;
         }
-        else if(alarm_load_downlink_exceeded_warning.state == ALARM_STATE_RAISE) {
-            alarm_load_downlink_exceeded_warning.state = ALARM_STATE_CLEARED;
-            alarm_load_downlink_exceeded_warning.timeout = alarms_config->alarms.load_downlink_exceeded_warning_timeout;
+
+        int verdict = alarms_rule_verdict(rule, alarms_data->metrics[rule->metric]);
+        if(verdict != -1) {
+            alarms_rule_condition(rule->alarm, rule->debounce, verdict);
         }
     }
 
@@ -244,96 +438,536 @@ failed:
     return 1;
 }
 
-void alarms_loop() {
+// the debounce of a RAISE / CLEAR command ran out without the condition flipping back
+static void alarms_timer_expired(void *arg) {
+    alarm_t *alarm = (alarm_t *)arg;
     int rc;
 
-    alarm_t **alarm = (alarm_t **)alarms;
-    while(*alarm) {
-        switch((*alarm)->state) {
-            case ALARM_STATE_CLEAR:
-                if((*alarm)->timeout == 0) {
-                    rc = alarm_clear(*alarm);
-                    if(rc != 0) {
-                        log_error("alarm_clear(%s) failed", (*alarm)->alarm);
-                    }
-                }
-                else {
-                    (*alarm)->timeout--;
-                }
-                break;
-
-            case ALARM_STATE_RAISE:
-                if((*alarm)->timeout == 0) {
-                    rc = alarm_raise(*alarm);
-                    if(rc != 0) {
-                        log_error("alarm_raise(%s) failed", (*alarm)->alarm);
-                    }
-                }
-                else {
-                    (*alarm)->timeout--;
-                }
-                break;
-
-            default:
-                break;
-        }
-        
-        alarm++;
+    switch(alarm->state) {
+        case ALARM_STATE_CLEAR:
+            rc = alarm_clear(alarm);
+            if(rc != 0) {
+                log_error("alarm_clear(%s) failed", alarm->alarm);
+            }
+            break;
+
+        case ALARM_STATE_RAISE:
+            rc = alarm_raise(alarm);
+            if(rc != 0) {
+                log_error("alarm_raise(%s) failed", alarm->alarm);
+            }
+            break;
+
+        default:
+            break;
     }
+
+    alarms_settle(alarm);
 }
 
-static int alarm_raise(alarm_t *alarm) {
-    int rc;
+// the coalesce window since the last report is over
+static void alarms_report_expired(void *arg) {
+    alarm_t *alarm = (alarm_t *)arg;
+
+    alarms_report(alarm);
+    alarms_settle(alarm);
+}
+
+// stayed cleared for a whole flap window
+static void alarms_flap_expired(void *arg) {
+    alarm_t *alarm = (alarm_t *)arg;
+
+    log("alarm %s on %s stopped flapping", alarm->alarm, alarm->object_instance);
+    alarm->flapping = false;
+    alarm->flaps = 0;
+    alarm->flap_start = get_monotonic_milliseconds();
 
+    alarms_report(alarm);
+    alarms_settle(alarm);
+}
+
+static int alarm_raise(alarm_t *alarm) {
     alarm->state = ALARM_STATE_RAISED;
 
-    ves_alarm_t ves_alarm = {
-        .alarm = alarm->alarm,
-        .severity = (char *)alarm_severity_to_str(alarm->severity),
-        .type = (char *)alarm_type_to_str(alarm->type),
-        .object_instance = alarm->object_instance,
-        .notification_id = alarm_notification_id,
-    };
+    int threshold = alarms_config->alarms.flap_threshold;
+    if(threshold > 0) {
+        long int now = get_monotonic_milliseconds();
+        if(now - alarm->flap_start > alarms_config->alarms.flap_window * 1000L) {
+            alarm->flap_start = now;
+            alarm->flaps = 0;
+        }
 
-    rc = ves_alarm_new_execute(&ves_alarm);
-    if(rc != 0) {
-        log_error("ves_alarm_new_execute() failed");
+        alarm->flaps++;
+        timer_wheel_cancel(&alarm->flap_timer);
+        if(!alarm->flapping && (alarm->flaps >= threshold)) {
+            log("alarm %s on %s is flapping, %d raises within %d seconds", alarm->alarm, alarm->object_instance, alarm->flaps, alarms_config->alarms.flap_window);
+            alarm->flapping = true;
+        }
     }
 
-    rc = netconf_data_update_alarm(alarm, alarm_notification_id);
-    if(rc != 0) {
-        log_error("netconf_data_update_alarm() failed");
+    alarms_report(alarm);
+
+    return 0;
+}
+
+static int alarm_clear(alarm_t *alarm) {
+    alarm->state = ALARM_STATE_CLEARED;
+
+    if(alarm->flapping) {
+        // stays reported raised until it settles down
+        timer_wheel_add(&alarm->flap_timer, alarms_config->alarms.flap_window * 1000L);
     }
 
-    alarm_notification_id++;
+    alarms_report(alarm);
 
     return 0;
 }
 
-static int alarm_clear(alarm_t *alarm) {
+static void alarms_alarm_setup(alarm_t *alarm) {
+    timer_wheel_timer_init(&alarm->timer, alarms_timer_expired, alarm);
+    timer_wheel_timer_init(&alarm->report_timer, alarms_report_expired, alarm);
+    timer_wheel_timer_init(&alarm->flap_timer, alarms_flap_expired, alarm);
+
+    alarm->reported = ALARM_STATE_CLEARED;
+    alarm->reported_severity = alarm->severity;
+    alarm->reported_time = 0;
+    alarm->notification_id = 0;
+    alarm->raised_time = 0;
+    alarm->changed_time = 0;
+    alarm->cleared_time = 0;
+    alarm->flaps = 0;
+    alarm->flap_start = 0;
+    alarm->flapping = false;
+}
+
+static void alarms_alarm_cancel(alarm_t *alarm) {
+    timer_wheel_cancel(&alarm->timer);
+    timer_wheel_cancel(&alarm->report_timer);
+    timer_wheel_cancel(&alarm->flap_timer);
+}
+
+/**
+ * brings what VES and netconf know in line with the alarm, unless
+ *   - its suppressor is reported raised: the report waits for the suppressor to clear
+ *   - it was reported less than a coalesce window ago: the report waits for the window to end,
+ *     transitions that cancel out by then are never reported
+*/
+static void alarms_report(alarm_t *alarm) {
+    alarm_state_t state = ALARM_STATE_CLEARED;
+    alarm_severity_t severity = alarm->severity;
+    if((alarm->state == ALARM_STATE_RAISED) || (alarm->state == ALARM_STATE_CLEAR) || alarm->flapping) {
+        state = ALARM_STATE_RAISED;
+    }
+
+    if(alarm->flapping && (severity < ALARM_SEVERITY_CRITICAL)) {
+        severity++;
+    }
+
+    if((state == alarm->reported) && ((state == ALARM_STATE_CLEARED) || (severity == alarm->reported_severity))) {
+        timer_wheel_cancel(&alarm->report_timer);
+        return;
+    }
+
+    if(alarm->suppressor && (alarm->suppressor->reported == ALARM_STATE_RAISED)) {
+        return;
+    }
+
+    long int window = alarms_config->alarms.coalesce_window * 1000L;
+    if((window > 0) && alarm->reported_time && (get_monotonic_milliseconds() - alarm->reported_time < window)) {
+        if(!timer_wheel_pending(&alarm->report_timer)) {
+            timer_wheel_add_at(&alarm->report_timer, alarm->reported_time + window);
+        }
+        return;
+    }
+
+    alarms_report_send(alarm, state, severity);
+}
+
+// VES event and netconf notification, the AlarmList is read from the inventory when asked for
+static void alarms_report_send(alarm_t *alarm, alarm_state_t state, alarm_severity_t severity) {
     int rc;
 
-    alarm->state = ALARM_STATE_CLEARED;
+    // a severity change keeps the time the alarm was raised at
+    alarm_state_t previous = alarm->reported;
+    long int now = get_microseconds_since_epoch() / 1000;
+    alarms_inventory_lock();
+    if(state == ALARM_STATE_CLEARED) {
+        alarm->cleared_time = now;
+    }
+    else if(previous == ALARM_STATE_CLEARED) {
+        alarm->raised_time = now;
+    }
+    alarm->changed_time = now;
+
+    alarm->reported = state;
+    alarm->reported_severity = severity;
+    alarm->reported_time = get_monotonic_milliseconds();
+    alarm->notification_id = alarm_notification_id;
+    alarms_inventory_unlock();
+    timer_wheel_cancel(&alarm->report_timer);
 
     ves_alarm_t ves_alarm = {
         .alarm = alarm->alarm,
-        .severity = (char *)alarm_severity_to_str(alarm->severity),
+        .severity = (char *)alarm_severity_to_str(severity),
         .type = (char *)alarm_type_to_str(alarm->type),
         .object_instance = alarm->object_instance,
         .notification_id = alarm_notification_id,
     };
 
-    rc = ves_alarm_clear_execute(&ves_alarm);
-    if(rc != 0) {
-        log_error("ves_alarm_clear_execute() failed");
+    if(state == ALARM_STATE_RAISED) {
+        rc = ves_alarm_new_execute(&ves_alarm);
+        if(rc != 0) {
+            log_error("ves_alarm_new_execute() failed");
+        }
+    }
+    else {
+        rc = ves_alarm_clear_execute(&ves_alarm);
+        if(rc != 0) {
+            log_error("ves_alarm_clear_execute() failed");
+        }
     }
 
-    rc = netconf_data_update_alarm(alarm, alarm_notification_id);
+    rc = netconf_data_notify_alarm(alarm, previous);
     if(rc != 0) {
-        log_error("netconf_data_update_alarm() failed");
+        log_error("netconf_data_notify_alarm() failed");
     }
 
     alarm_notification_id++;
 
+    alarms_report_dependents(alarm);
+}
+
+// a suppressor changed, the alarms it held back may have something to report now
+static void alarms_report_dependents(const alarm_t *suppressor) {
+    for(int i = 0; i < alarms_rules_len; i++) {
+        const alarms_rule_t *rule = &alarms_rules[i];
+
+        if(rule->scope == ALARMS_SCOPE_CELL) {
+            if(rule->alarm->suppressor == suppressor) {
+                alarms_report(rule->alarm);
+            }
+            continue;
+        }
+
+        if(rule->ue->suppressor == suppressor) {
+            alarms_instance_t *instance = rule->ue->instances;
+            while(instance) {
+                alarms_instance_t *next = instance->next;
+                alarms_report(&instance->alarm);
+                alarms_settle(&instance->alarm);
+                instance = next;
+            }
+        }
+    }
+}
+
+// drops a per-UE instance once nothing about it is pending any more
+static void alarms_settle(alarm_t *alarm) {
+    if(!alarm->transient || (alarm->state != ALARM_STATE_CLEARED) || (alarm->reported != ALARM_STATE_CLEARED) || alarm->flapping) {
+        return;
+    }
+
+    // keep the flap history while it still counts
+    if(alarm->flaps && (get_monotonic_milliseconds() - alarm->flap_start <= alarms_config->alarms.flap_window * 1000L)) {
+        return;
+    }
+
+    if(timer_wheel_pending(&alarm->timer) || timer_wheel_pending(&alarm->report_timer)) {
+        return;
+    }
+
+    alarms_instance_free((alarms_instance_t *)alarm);
+}
+
+// only cell alarms with a unique name can suppress others
+static const alarm_t *alarms_find_suppressor(const char *name) {
+    const alarm_t *found = 0;
+    int matches = 0;
+
+    if(strcmp(name, alarm_internal_connection_loss.alarm) == 0) {
+        found = &alarm_internal_connection_loss;
+        matches++;
+    }
+
+    for(int i = 0; i < alarms_rules_len; i++) {
+        if(strcmp(name, alarms_rule_alarms[i].alarm) == 0) {
+            found = (alarms_rules[i].scope == ALARMS_SCOPE_CELL) ? alarms_rules[i].alarm : 0;
+            matches++;
+        }
+    }
+
+    return (matches == 1) ? found : 0;
+}
+
+static int alarms_rule_compile(const config_alarm_rule_t *config, alarms_rule_t *rule, alarm_t *alarm, alarms_rule_ue_t *ue) {
+    int metric = -1;
+    for(int i = 0; i < ALARMS_METRICS; i++) {
+        if(strcmp(config->metric, alarms_metric_names[i]) == 0) {
+            metric = i;
+            break;
+        }
+    }
+    if(metric == -1) {
+        log_error("unknown alarm metric %s", config->metric);
+        goto failed;
+    }
+
+    const char *comparators[] = {">", ">=", "<", "<="};
+    int comparator = -1;
+    for(int i = 0; i < 4; i++) {
+        if(strcmp(config->comparator, comparators[i]) == 0) {
+            comparator = i;
+            break;
+        }
+    }
+    if(comparator == -1) {
+        log_error("unknown alarm comparator %s", config->comparator);
+        goto failed;
+    }
+
+    int severity = alarm_severity_from_str(config->severity);
+    int type = alarm_type_from_str(config->type);
+    if((severity == -1) || (type == -1)) {
+        log_error("unknown alarm severity %s or type %s", config->severity, config->type);
+        goto failed;
+    }
+
+    int scope = -1;
+    if(strcmp(config->scope, "cell") == 0) {
+        scope = ALARMS_SCOPE_CELL;
+    }
+    else if(strcmp(config->scope, "ue") == 0) {
+        scope = ALARMS_SCOPE_UE;
+        if((metric != ALARMS_METRIC_UE_THP_DL) && (metric != ALARMS_METRIC_UE_THP_UL)) {
+            log_error("metric %s is not available per UE", config->metric);
+            goto failed;
+        }
+
+        if(strstr(config->object_instance, "@ue-id@") == 0) {
+            log_error("ue scope object instance %s lacks @ue-id@", config->object_instance);
+            goto failed;
+        }
+    }
+    else {
+        log_error("unknown alarm scope %s", config->scope);
+        goto failed;
+    }
+
+    char du_id[16];
+    sprintf(du_id, "%d", alarms_config->info.gnb_du_id);
+    char cell_id[16];
+    sprintf(cell_id, "%d", alarms_config->info.cell_local_id);
+
+    alarm->alarm = strdup(config->alarm);
+    alarm->object_instance = strdup(config->object_instance);
+    alarm->object_instance = str_replace_inplace(alarm->object_instance, "@node-id@", alarms_config->info.node_id);
+    alarm->object_instance = str_replace_inplace(alarm->object_instance, "@gnb-du-id@", du_id);
+    alarm->object_instance = str_replace_inplace(alarm->object_instance, "@cell-local-id@", cell_id);
+    if((alarm->alarm == 0) || (alarm->object_instance == 0)) {
+        log_error("strdup failed");
+        goto failed;
+    }
+    alarm->severity = severity;
+    alarm->type = type;
+    alarm->state = ALARM_STATE_CLEARED;
+    alarms_alarm_setup(alarm);
+
+    rule->raise = config->raise;
+    rule->clear = config->clear;
+    rule->alarm = alarm;
+    rule->ue = 0;
+    rule->debounce = config->debounce * 1000;
+    rule->metric = metric;
+    rule->comparator = comparator;
+    rule->scope = scope;
+
+    if(scope == ALARMS_SCOPE_UE) {
+        // the compiled cell alarm only serves as the template of the instances
+        char *ue_id = strstr(alarm->object_instance, "@ue-id@");
+        ue->alarm = strdup(alarm->alarm);
+        ue->prefix = strndup(alarm->object_instance, ue_id - alarm->object_instance);
+        ue->suffix = strdup(ue_id + strlen("@ue-id@"));
+        if((ue->alarm == 0) || (ue->prefix == 0) || (ue->suffix == 0)) {
+            log_error("strdup failed");
+            goto failed;
+        }
+
+        ue->key = (char *)malloc(strlen(ue->prefix) + strlen(ue->suffix) + 16);
+        if(ue->key == 0) {
+            log_error("malloc failed");
+            goto failed;
+        }
+        ue->severity = severity;
+        ue->type = type;
+        ue->suppressor = 0;
+        ue->instances = 0;
+
+        rule->alarm = 0;
+        rule->ue = ue;
+    }
+
+    return 0;
+
+failed:
+    return 1;
+}
+
+// 1 if the alarm condition holds, 0 if it stopped holding, -1 inside the hysteresis band
+static int alarms_rule_verdict(const alarms_rule_t *rule, double value) {
+    bool raise = false;
+    bool clear = false;
+    switch(rule->comparator) {
+        case ALARMS_COMPARATOR_GT:
+            raise = (value > rule->raise);
+            clear = !(value > rule->clear);
+            break;
+
+        case ALARMS_COMPARATOR_GE:
+            raise = (value >= rule->raise);
+            clear = !(value >= rule->clear);
+            break;
+
+        case ALARMS_COMPARATOR_LT:
+            raise = (value < rule->raise);
+            clear = !(value < rule->clear);
+            break;
+
+        case ALARMS_COMPARATOR_LE:
+            raise = (value <= rule->raise);
+            clear = !(value <= rule->clear);
+            break;
+    }
+
+    if(raise) {
+        return 1;
+    }
+    else if(clear) {
+        return 0;
+    }
+
+    return -1;
+}
+
+// moves the alarm towards raised (holds) or cleared, a change takes effect after the debounce time
+static void alarms_rule_condition(alarm_t *alarm, int debounce, bool holds) {
+    if(holds) {
+        if(alarm->state == ALARM_STATE_CLEARED) {
+            alarm->state = ALARM_STATE_RAISE;
+            timer_wheel_add(&alarm->timer, debounce);
+        }
+        else if(alarm->state == ALARM_STATE_CLEAR) {
+            alarm->state = ALARM_STATE_RAISED;
+            timer_wheel_cancel(&alarm->timer);
+        }
+    }
+    else {
+        if(alarm->state == ALARM_STATE_RAISED) {
+            alarm->state = ALARM_STATE_CLEAR;
+            timer_wheel_add(&alarm->timer, debounce);
+        }
+        else if(alarm->state == ALARM_STATE_RAISE) {
+            alarm->state = ALARM_STATE_CLEARED;
+            timer_wheel_cancel(&alarm->timer);
+        }
+    }
+}
+
+// one hash lookup per UE; instances only exist while their alarm is (being) raised
+static void alarms_rule_ue_feed(const alarms_rule_t *rule, const alarms_data_t *alarms_data) {
+    alarms_rule_ue_t *ue = rule->ue;
+
+    for(int i = 0; i < alarms_data->ues_len; i++) {
+        const alarms_ue_data_t *ue_data = &alarms_data->ues[i];
+        int verdict = alarms_rule_verdict(rule, ue_data->metrics[rule->metric]);
+
+        sprintf(ue->key, "%s%d%s", ue->prefix, ue_data->id, ue->suffix);
+        alarms_instance_t *instance = (alarms_instance_t *)alarms_inventory_find(ue->alarm, ue->key);
+        if(instance == 0) {
+            if(verdict != 1) {
+                continue;
+            }
+
+            instance = alarms_instance_new(rule, ue->key);
+            if(instance == 0) {
+                log_error("alarms_instance_new(%s) failed", ue->key);
+                continue;
+            }
+        }
+
+        instance->seen = alarms_generation;
+        if(verdict != -1) {
+            alarms_rule_condition(&instance->alarm, rule->debounce, verdict);
+        }
+    }
+
+    // a UE that left no longer holds the condition; drops the instances that have nothing left to do
+    alarms_instance_t *instance = ue->instances;
+    while(instance) {
+        alarms_instance_t *next = instance->next;
+        if(instance->seen != alarms_generation) {
+            alarms_rule_condition(&instance->alarm, rule->debounce, false);
+        }
+        alarms_settle(&instance->alarm);
+        instance = next;
+    }
+}
+
+static alarms_instance_t *alarms_instance_new(const alarms_rule_t *rule, const char *object_instance) {
+    alarms_instance_t *instance = (alarms_instance_t *)calloc(1, sizeof(alarms_instance_t));
+    if(instance == 0) {
+        log_error("calloc failed");
+        goto failed;
+    }
+
+    instance->alarm.alarm = rule->ue->alarm;
+    instance->alarm.object_instance = strdup(object_instance);
+    if(instance->alarm.object_instance == 0) {
+        log_error("strdup failed");
+        goto failed;
+    }
+    instance->alarm.severity = rule->ue->severity;
+    instance->alarm.type = rule->ue->type;
+    instance->alarm.state = ALARM_STATE_CLEARED;
+    instance->alarm.suppressor = rule->ue->suppressor;
+    instance->alarm.transient = true;
+    alarms_alarm_setup(&instance->alarm);
+    instance->rule = rule;
+
+    if(alarms_inventory_add(&instance->alarm) != 0) {
+        log_error("alarms_inventory_add() failed");
+        goto failed;
+    }
+
+    instance->next = rule->ue->instances;
+    if(instance->next) {
+        instance->next->prev = instance;
+    }
+    rule->ue->instances = instance;
+
+    return instance;
+
+failed:
+    if(instance) {
+        free(instance->alarm.object_instance);
+    }
+    free(instance);
     return 0;
 }
+
+static void alarms_instance_free(alarms_instance_t *instance) {
+    alarms_alarm_cancel(&instance->alarm);
+    alarms_inventory_remove(&instance->alarm);
+
+    if(instance->prev) {
+        instance->prev->next = instance->next;
+    }
+    else {
+        instance->rule->ue->instances = instance->next;
+    }
+    if(instance->next) {
+        instance->next->prev = instance->prev;
+    }
+
+    free(instance->alarm.object_instance);
+    free(instance);
+}
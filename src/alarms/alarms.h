@@ -23,7 +23,10 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
 #include "common/config.h"
+#include "common/timer_wheel.h"
 
 typedef enum alarm_state {
     // state
@@ -64,19 +67,59 @@ typedef struct alarm {
     char *object_instance;
 
     alarm_state_t state;
-    int timeout;
+    timer_wheel_timer_t timer;      // pending while a RAISE / CLEAR command waits out its debounce
+
+    // what VES and netconf were last told, lags state while coalesced, suppressed or flapping
+    alarm_state_t reported;         // ALARM_STATE_CLEARED or ALARM_STATE_RAISED
+    alarm_severity_t reported_severity;
+    long int reported_time;         // get_monotonic_milliseconds(), 0 before the first report
+    int notification_id;            // of the last report
+    long int raised_time;           // wall clock ms of the last raise, 0 if never raised
+    long int changed_time;          // wall clock ms of the last report
+    long int cleared_time;          // wall clock ms of the last clear, 0 if never cleared
+    timer_wheel_timer_t report_timer;   // pending while a report waits for the coalesce window
+    const struct alarm *suppressor; // reports are held back while it is reported raised
+    bool transient;                 // per-UE instance, its record goes away once cleared
+
+    int flaps;                      // raises since flap_start
+    long int flap_start;
+    bool flapping;                  // reported raised, one severity up, until cleared for a whole flap window
+    timer_wheel_timer_t flap_timer;
+
+    struct alarm *inventory_next;   // alarms_inventory bucket chain
+    uint32_t inventory_hash;
 } alarm_t;
 
+typedef enum alarms_metric {
+    ALARMS_METRIC_LOAD = 0,         // "load", downlink load in %
+    ALARMS_METRIC_NUM_UES,          // "num-ues"
+    ALARMS_METRIC_UE_THP_DL,        // "ue-thp-dl", summed over the UEs
+    ALARMS_METRIC_UE_THP_UL,        // "ue-thp-ul"
+
+    ALARMS_METRICS,
+} alarms_metric_t;
+
+// per-UE sample for rules with ue scope, only the ue-thp-* metrics are per UE
+typedef struct alarms_ue_data {
+    int id;                         // @ue-id@ in the object instance
+    double metrics[ALARMS_METRICS];
+} alarms_ue_data_t;
+
+// one sample of every metric the alarm rules (config alarms.rules) can watch
 typedef struct alarms_data {
-    int load;
+    double metrics[ALARMS_METRICS];
+    const alarms_ue_data_t *ues;
+    int ues_len;
 } alarms_data_t;
 
 int alarms_init(const config_t *config);
 int alarms_free();
-void alarms_loop();
 
 const char *alarm_severity_to_str(const alarm_severity_t severity);
 const char *alarm_type_to_str(const alarm_type_t type);
+// return -1 for unknown names
+int alarm_severity_from_str(const char *severity);
+int alarm_type_from_str(const char *type);
 
 void alarms_on_telnet_connected();
 void alarms_on_telnet_disconnected();
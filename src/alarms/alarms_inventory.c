@@ -0,0 +1,196 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+#include "alarms_inventory.h"
+#include "common/log.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static alarm_t **alarms_inventory_buckets = 0;
+static int alarms_inventory_size = 0;      // power of two
+static int alarms_inventory_len = 0;
+static pthread_mutex_t alarms_inventory_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t alarms_inventory_hash(const char *alarm, const char *object_instance);
+static int alarms_inventory_grow();
+
+int alarms_inventory_init(int buckets) {
+    alarms_inventory_size = 16;
+    while(alarms_inventory_size < buckets) {
+        alarms_inventory_size *= 2;
+    }
+
+    alarms_inventory_buckets = (alarm_t **)calloc(alarms_inventory_size, sizeof(alarm_t *));
+    if(alarms_inventory_buckets == 0) {
+        log_error("calloc failed");
+        goto failed;
+    }
+    alarms_inventory_len = 0;
+
+    return 0;
+
+failed:
+    alarms_inventory_size = 0;
+    return 1;
+}
+
+void alarms_inventory_free() {
+    pthread_mutex_lock(&alarms_inventory_mutex);
+    free(alarms_inventory_buckets);
+    alarms_inventory_buckets = 0;
+    alarms_inventory_size = 0;
+    alarms_inventory_len = 0;
+    pthread_mutex_unlock(&alarms_inventory_mutex);
+}
+
+int alarms_inventory_add(alarm_t *alarm) {
+    if(alarms_inventory_find(alarm->alarm, alarm->object_instance)) {
+        log_error("alarm %s on %s already in the inventory", alarm->alarm, alarm->object_instance);
+        goto failed;
+    }
+
+    pthread_mutex_lock(&alarms_inventory_mutex);
+    if((alarms_inventory_len >= alarms_inventory_size) && (alarms_inventory_grow() != 0)) {
+        // a longer chain still works
+        log_error("alarms_inventory_grow() failed");
+    }
+
+    alarm->inventory_hash = alarms_inventory_hash(alarm->alarm, alarm->object_instance);
+    alarm_t **bucket = &alarms_inventory_buckets[alarm->inventory_hash & (alarms_inventory_size - 1)];
+    alarm->inventory_next = *bucket;
+    *bucket = alarm;
+    alarms_inventory_len++;
+    pthread_mutex_unlock(&alarms_inventory_mutex);
+
+    return 0;
+
+failed:
+    return 1;
+}
+
+void alarms_inventory_remove(alarm_t *alarm) {
+    pthread_mutex_lock(&alarms_inventory_mutex);
+    alarm_t **entry = &alarms_inventory_buckets[alarm->inventory_hash & (alarms_inventory_size - 1)];
+    while(*entry) {
+        if(*entry == alarm) {
+            *entry = alarm->inventory_next;
+            alarm->inventory_next = 0;
+            alarms_inventory_len--;
+            break;
+        }
+        entry = &(*entry)->inventory_next;
+    }
+    pthread_mutex_unlock(&alarms_inventory_mutex);
+}
+
+alarm_t *alarms_inventory_find(const char *alarm, const char *object_instance) {
+    uint32_t hash = alarms_inventory_hash(alarm, object_instance);
+
+    alarm_t *entry = alarms_inventory_buckets[hash & (alarms_inventory_size - 1)];
+    while(entry) {
+        if((entry->inventory_hash == hash) && (strcmp(entry->object_instance, object_instance) == 0) && (strcmp(entry->alarm, alarm) == 0)) {
+            return entry;
+        }
+        entry = entry->inventory_next;
+    }
+
+    return 0;
+}
+
+int alarms_inventory_count() {
+    return alarms_inventory_len;
+}
+
+void alarms_inventory_lock() {
+    pthread_mutex_lock(&alarms_inventory_mutex);
+}
+
+void alarms_inventory_unlock() {
+    pthread_mutex_unlock(&alarms_inventory_mutex);
+}
+
+int alarms_inventory_foreach(alarms_inventory_callback_t callback, void *arg) {
+    int rc = 0;
+
+    pthread_mutex_lock(&alarms_inventory_mutex);
+    for(int i = 0; (i < alarms_inventory_size) && (rc == 0); i++) {
+        alarm_t *entry = alarms_inventory_buckets[i];
+        while(entry) {
+            alarm_t *next = entry->inventory_next;
+            rc = callback(entry, arg);
+            if(rc != 0) {
+                break;
+            }
+            entry = next;
+        }
+    }
+    pthread_mutex_unlock(&alarms_inventory_mutex);
+
+    return rc;
+}
+
+// FNV-1a over both key parts
+static uint32_t alarms_inventory_hash(const char *alarm, const char *object_instance) {
+    uint32_t hash = 2166136261u;
+
+    for(const char *c = alarm; *c; c++) {
+        hash = (hash ^ (uint8_t)*c) * 16777619u;
+    }
+    hash = (hash ^ '-') * 16777619u;
+    for(const char *c = object_instance; *c; c++) {
+        hash = (hash ^ (uint8_t)*c) * 16777619u;
+    }
+
+    return hash;
+}
+
+static int alarms_inventory_grow() {
+    int size = alarms_inventory_size * 2;
+    alarm_t **buckets = (alarm_t **)calloc(size, sizeof(alarm_t *));
+    if(buckets == 0) {
+        log_error("calloc failed");
+        goto failed;
+    }
+
+    for(int i = 0; i < alarms_inventory_size; i++) {
+        alarm_t *entry = alarms_inventory_buckets[i];
+        while(entry) {
+            alarm_t *next = entry->inventory_next;
+            alarm_t **bucket = &buckets[entry->inventory_hash & (size - 1)];
+            entry->inventory_next = *bucket;
+            *bucket = entry;
+            entry = next;
+        }
+    }
+
+    free(alarms_inventory_buckets);
+    alarms_inventory_buckets = buckets;
+    alarms_inventory_size = size;
+
+    return 0;
+
+failed:
+    return 1;
+}
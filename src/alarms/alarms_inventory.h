@@ -0,0 +1,51 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+#pragma once
+
+#include "alarms.h"
+
+/**
+ * every alarm instance the adapter knows about, keyed by alarm (its specific problem,
+ * which fixes the type) and object instance, the same pair the 3GPP alarmId is made of
+ *   chained hash table that doubles when it gets full; the inventory does not own the alarms
+ *   alarms are added, removed and looked up from the alarms thread only, foreach may run
+ *   from any thread (the netconf operational callback) and holds off add, remove and the
+ *   reported state updates made under alarms_inventory_lock() meanwhile
+*/
+typedef int (*alarms_inventory_callback_t)(const alarm_t *alarm, void *arg);
+
+int alarms_inventory_init(int buckets);
+void alarms_inventory_free();
+
+// fails if an alarm with the same key is already there
+int alarms_inventory_add(alarm_t *alarm);
+void alarms_inventory_remove(alarm_t *alarm);
+alarm_t *alarms_inventory_find(const char *alarm, const char *object_instance);
+int alarms_inventory_count();
+
+void alarms_inventory_lock();
+void alarms_inventory_unlock();
+
+// stops at, and returns, the first non zero callback result
+int alarms_inventory_foreach(alarms_inventory_callback_t callback, void *arg);
@@ -0,0 +1,335 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+
+#define _GNU_SOURCE
+
+#include "bench/ves_collector_stub.h"
+#include "common/config.h"
+#include "common/histogram.h"
+#include "common/log.h"
+#include "ves/ves.h"
+#include "ves/ves_sender.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#define VES_BENCH_DRAIN_TIMEOUT     30      // seconds to wait for the last acknowledgements
+
+/**
+ * offline VES throughput benchmark
+ *   starts the loopback collector stub, points every configured collector at it and drives
+ *   ves_alarm_new_execute() and ves_fileready_execute() alternately at the requested rate,
+ *   then reports events/s, enqueue to acknowledgement latency per priority and CPU time per event
+*/
+
+static long int ves_bench_cpu_us(void);
+static int ves_bench_redirect(char **url, int port);
+
+int main(int argc, char **argv) {
+    int rc = 0;
+    config_t *config = 0;
+    bool stub_started = false;
+    bool ves_started = false;
+
+    const char *config_file = "./config/config.json";
+    long int events = 10000;
+    long int rate = 0;                  // events/s, 0 sends as fast as the sender queues take them
+    bool keep_outbox = false;
+    int low_rate = -1;                  // -1 keeps ves.low-priority-rate
+    ves_collector_stub_config_t stub_config = {
+        .port = 0,
+        .latency_ms = 0,
+        .error_permille = 0,
+        .error_code = 503,
+    };
+
+    for(int i = 1; i < argc; i++) {
+        if((i + 1 < argc) && ((strcmp(argv[i], "-c") == 0) || (strcmp(argv[i], "--config") == 0))) {
+            config_file = argv[++i];
+        }
+        else if((i + 1 < argc) && (strcmp(argv[i], "--events") == 0)) {
+            events = atol(argv[++i]);
+        }
+        else if((i + 1 < argc) && (strcmp(argv[i], "--rate") == 0)) {
+            rate = atol(argv[++i]);
+        }
+        else if((i + 1 < argc) && (strcmp(argv[i], "--latency") == 0)) {
+            stub_config.latency_ms = atoi(argv[++i]);
+        }
+        else if((i + 1 < argc) && (strcmp(argv[i], "--errors") == 0)) {
+            stub_config.error_permille = atoi(argv[++i]);
+        }
+        else if((i + 1 < argc) && (strcmp(argv[i], "--error-code") == 0)) {
+            stub_config.error_code = atoi(argv[++i]);
+        }
+        else if((i + 1 < argc) && (strcmp(argv[i], "--low-rate") == 0)) {
+            low_rate = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--outbox") == 0) {
+            keep_outbox = true;
+        }
+        else if(strcmp(argv[i], "--help") == 0) {
+            printf("VES throughput benchmark against a loopback collector:\n");
+            printf(" --help                         displays help\n");
+            printf(" -c/--config [config_file]      adapter config, its ves section is used (collectors are redirected)\n");
+            printf(" --events [n]                   events to send, half alarms and half file-ready (default 10000)\n");
+            printf(" --rate [events/s]              pace the producer; 0 waits for room in the queues instead (default)\n");
+            printf(" --latency [ms]                 collector response latency (default 0)\n");
+            printf(" --errors [permille]            requests the collector fails (default 0)\n");
+            printf(" --error-code [code]            http code of the failed requests (default 503)\n");
+            printf(" --low-rate [events/s]          overrides ves.low-priority-rate, 0 disables shaping\n");
+            printf(" --outbox                       keep ves.outbox enabled (disabled by default)\n");
+            exit(0);
+        }
+        else {
+            log_error("invalid argument passed: %s", argv[i]);
+            goto failure;
+        }
+    }
+
+    if(events < 1) {
+        log_error("--events must be positive");
+        goto failure;
+    }
+
+    rc = config_init(config_file);
+    if(rc) {
+        log_error("config error");
+        goto failure;
+    }
+
+    config = config_get();
+    if(config == 0) {
+        log_error("config_get() error");
+        goto failure;
+    }
+
+    // only the report goes to stdout
+    log_level = 0;
+
+    rc = ves_collector_stub_init(&stub_config);
+    if(rc) {
+        log_error("ves_collector_stub_init() failed");
+        goto failure;
+    }
+    stub_started = true;
+
+    // nothing but the benchmarked events, and no side effects on the host
+    config->ves.pnf_registration = false;
+    config->ves.heartbeat_interval = -1;
+    config->ves.sftp_daemon = false;
+    if(low_rate >= 0) {
+        config->ves.low_priority_rate = low_rate;
+    }
+    if(!keep_outbox) {
+        free(config->ves.outbox);
+        config->ves.outbox = strdup("");
+    }
+
+    rc = ves_bench_redirect(&config->ves.url, ves_collector_stub_port());
+    for(int i = 0; i < config->ves.collectors_len; i++) {
+        rc |= ves_bench_redirect(&config->ves.collectors[i].url, ves_collector_stub_port());
+    }
+    if(rc || (config->ves.outbox == 0)) {
+        log_error("strdup failed");
+        goto failure;
+    }
+
+    rc = ves_init(config);
+    if(rc) {
+        log_error("ves_init() failed");
+        goto failure;
+    }
+    ves_started = true;
+
+    ves_info_t info = {
+        .vendor = "OpenAirInterface",
+        .managed_element_id = "1",
+    };
+    rc = ves_set_info(&info);
+    if(rc) {
+        log_error("ves_set_info() failed");
+        goto failure;
+    }
+
+    ves_alarm_t alarm = {
+        .alarm = "number-of-ue-exceeded",
+        .severity = "MINOR",
+        .type = "COMMUNICATION_ALARM",
+        .object_instance = "ManagedElement=1,GNBDUFunction=1,NRCellDU=1",
+        .notification_id = 0,
+    };
+    ves_file_ready_t file_ready = {
+        .file_location = "sftp://user@127.0.0.1:1222/ftp/A20240101.0000+0000-0005+0000_bench.xml.gz",
+        .file_size = 4096,
+        .file_compression = "gzip",
+        .notification_id = 0,
+    };
+
+    histogram_t execute;
+    histogram_reset(&execute);
+
+    int collectors = ves_sender_collectors_count();
+    long int cpu_start = ves_bench_cpu_us();
+    long int start = get_monotonic_microseconds();
+    for(long int i = 0; i < events; i++) {
+        if(rate > 0) {
+            long int due = start + i * 1000000L / rate;
+            long int now = get_monotonic_microseconds();
+            if(due > now) {
+                usleep(due - now);
+            }
+        }
+        else {
+            // saturate the sender without overflowing it, so nothing is dropped
+            ves_sender_priority_t priority = (i % 2 == 0) ? VES_SENDER_PRIORITY_HIGH : VES_SENDER_PRIORITY_LOW;
+            for(int c = 0; c < collectors; c++) {
+                ves_sender_stats_t stats;
+                ves_sender_get_stats(c, &stats);
+                while(stats.queue_depths[priority] >= config->ves.queue_size) {
+                    usleep(50);
+                    ves_sender_get_stats(c, &stats);
+                }
+            }
+        }
+
+        long int before = get_monotonic_microseconds();
+        if(i % 2 == 0) {
+            alarm.notification_id = (int)i;
+            rc = ves_alarm_new_execute(&alarm);
+        }
+        else {
+            file_ready.notification_id = (int)i;
+            rc = ves_fileready_execute(&file_ready);
+        }
+        histogram_record(&execute, get_monotonic_microseconds() - before);
+    }
+    long int produced = get_monotonic_microseconds();
+
+    // every collector gets every event; wait until each of them has settled all of them
+    long int deadline = produced + VES_BENCH_DRAIN_TIMEOUT * 1000000L + (config->ves.low_priority_rate ? events * 1000000L / config->ves.low_priority_rate : 0);
+    long int settled = 0;
+    while(get_monotonic_microseconds() < deadline) {
+        settled = 0;
+        for(int i = 0; i < collectors; i++) {
+            ves_sender_stats_t stats;
+            ves_sender_get_stats(i, &stats);
+            settled += stats.sent + stats.failed + stats.dropped + stats.rejected;
+        }
+
+        if(settled >= events * collectors) {
+            break;
+        }
+        usleep(1000);
+    }
+    long int finished = get_monotonic_microseconds();
+
+    ves_collector_stub_stats_t stub_stats;
+    ves_collector_stub_get_stats(&stub_stats);
+    long int cpu = ves_bench_cpu_us() - cpu_start - stub_stats.cpu_us;
+    double elapsed = (finished - start) / 1000000.0;
+
+    printf("events          %ld x %d collector(s), %s\n", events, collectors, (settled >= events * collectors) ? "all settled" : "timed out");
+    printf("producer        %.0f events/s, execute p50 %lu us, p99 %lu us, max %lu us\n",
+        events / ((produced - start) / 1000000.0), histogram_percentile(&execute, 50), histogram_percentile(&execute, 99), execute.max);
+    printf("throughput      %.0f events/s over %.3f s\n", (events * collectors) / elapsed, elapsed);
+    printf("cpu             %.1f us/event (adapter side, stub excluded)\n", (double)cpu / (events * collectors));
+    printf("stub            %ld requests, %ld events, %ld errors, %ld body bytes, %.1f us cpu/request\n",
+        stub_stats.requests, stub_stats.events, stub_stats.errors, stub_stats.bytes, stub_stats.requests ? (double)stub_stats.cpu_us / stub_stats.requests : 0.0);
+
+    for(int i = 0; i < collectors; i++) {
+        ves_sender_stats_t stats;
+        ves_sender_get_stats(i, &stats);
+
+        printf("collector %-6s sent %ld, failed %ld, dropped %ld, rejected %ld, retried %ld, batches %ld\n",
+            stats.collector, stats.sent, stats.failed, stats.dropped, stats.rejected, stats.retried, stats.batches);
+
+        const char *priorities[VES_SENDER_PRIORITIES] = {"high", "normal", "low"};
+        for(int p = 0; p < VES_SENDER_PRIORITIES; p++) {
+            histogram_t latency;
+            ves_sender_get_latency(i, p, &latency);
+            if(latency.count == 0) {
+                continue;
+            }
+
+            printf("  %-6s ack   %lu events, p50 %lu us, p99 %lu us, max %lu us\n",
+                priorities[p], latency.count, histogram_percentile(&latency, 50), histogram_percentile(&latency, 99), latency.max);
+        }
+    }
+
+    ves_free();
+    ves_collector_stub_free();
+    config_free(config);
+    free(config);
+    config_free(0);
+
+    return 0;
+
+failure:
+    if(ves_started) {
+        ves_free();
+    }
+    if(stub_started) {
+        ves_collector_stub_free();
+    }
+    if(config) {
+        config_free(config);
+        free(config);
+    }
+    config_free(0);
+
+    return 1;
+}
+
+// user and system time of the whole process
+static long int ves_bench_cpu_us(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000L + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+// keeps the path of url, sends it to the stub on 127.0.0.1:port over plain http
+static int ves_bench_redirect(char **url, int port) {
+    const char *path = "/eventListener/v7";
+    if(*url) {
+        const char *host = strstr(*url, "://");
+        host = host ? (host + 3) : *url;
+        const char *slash = strchr(host, '/');
+        if(slash) {
+            path = slash;
+        }
+    }
+
+    char *redirected = 0;
+    if(asprintf(&redirected, "http://127.0.0.1:%d%s", port, path) == -1) {
+        return 1;
+    }
+
+    free(*url);
+    *url = redirected;
+    return 0;
+}
@@ -0,0 +1,483 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+
+#define _GNU_SOURCE
+
+#include "ves_collector_stub.h"
+#include "common/log.h"
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#define VES_COLLECTOR_STUB_MAX_CONNECTIONS  64
+#define VES_COLLECTOR_STUB_BUFFER_SIZE      65536
+#define VES_COLLECTOR_STUB_LISTEN_ID        (VES_COLLECTOR_STUB_MAX_CONNECTIONS)
+#define VES_COLLECTOR_STUB_STOP_ID          (VES_COLLECTOR_STUB_MAX_CONNECTIONS + 1)
+
+typedef struct ves_collector_stub_connection {
+    int fd;                     // -1 when unused
+    char *buffer;
+    size_t buffer_size;
+    size_t buffer_len;
+    size_t request_len;         // bytes of the buffered request being answered
+    long int respond_at;        // monotonic ms, -1 while the request is incomplete
+    int response_code;
+    bool continued;             // "100 Continue" already sent for this request
+} ves_collector_stub_connection_t;
+
+static ves_collector_stub_config_t ves_collector_stub_config;
+static pthread_t ves_collector_stub_thread;
+static bool ves_collector_stub_running = false;
+static pthread_mutex_t ves_collector_stub_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ves_collector_stub_stats_t ves_collector_stub_stats;
+
+// only touched by the stub thread after init
+static int ves_collector_stub_epoll = -1;
+static int ves_collector_stub_listen = -1;
+static int ves_collector_stub_stop = -1;
+static int ves_collector_stub_bound_port = 0;
+static ves_collector_stub_connection_t ves_collector_stub_connections[VES_COLLECTOR_STUB_MAX_CONNECTIONS];
+static unsigned char *ves_collector_stub_inflated = 0;     // scratch for gzip bodies
+static size_t ves_collector_stub_inflated_size = 0;
+static unsigned int ves_collector_stub_seed = 1;
+
+static void *ves_collector_stub_routine(void *arg);
+static void ves_collector_stub_accept(void);
+static void ves_collector_stub_read(ves_collector_stub_connection_t *connection);
+static void ves_collector_stub_parse(ves_collector_stub_connection_t *connection);
+static void ves_collector_stub_respond(ves_collector_stub_connection_t *connection);
+static void ves_collector_stub_close(ves_collector_stub_connection_t *connection);
+static long int ves_collector_stub_count_events(const char *body, size_t size, bool gzip);
+
+int ves_collector_stub_init(const ves_collector_stub_config_t *config) {
+    memcpy(&ves_collector_stub_config, config, sizeof(ves_collector_stub_config_t));
+    memset(&ves_collector_stub_stats, 0, sizeof(ves_collector_stub_stats_t));
+    for(int i = 0; i < VES_COLLECTOR_STUB_MAX_CONNECTIONS; i++) {
+        memset(&ves_collector_stub_connections[i], 0, sizeof(ves_collector_stub_connection_t));
+        ves_collector_stub_connections[i].fd = -1;
+    }
+
+    ves_collector_stub_listen = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if(ves_collector_stub_listen < 0) {
+        log_error("socket() failed: %s", strerror(errno));
+        goto failure;
+    }
+
+    int one = 1;
+    setsockopt(ves_collector_stub_listen, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(config->port);
+    if(bind(ves_collector_stub_listen, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        log_error("bind() to port %d failed: %s", config->port, strerror(errno));
+        goto failure;
+    }
+
+    socklen_t address_len = sizeof(address);
+    if(getsockname(ves_collector_stub_listen, (struct sockaddr *)&address, &address_len) != 0) {
+        log_error("getsockname() failed: %s", strerror(errno));
+        goto failure;
+    }
+    ves_collector_stub_bound_port = ntohs(address.sin_port);
+
+    if(listen(ves_collector_stub_listen, VES_COLLECTOR_STUB_MAX_CONNECTIONS) != 0) {
+        log_error("listen() failed: %s", strerror(errno));
+        goto failure;
+    }
+
+    ves_collector_stub_stop = eventfd(0, EFD_NONBLOCK);
+    ves_collector_stub_epoll = epoll_create1(0);
+    if((ves_collector_stub_stop < 0) || (ves_collector_stub_epoll < 0)) {
+        log_error("eventfd()/epoll_create1() failed: %s", strerror(errno));
+        goto failure;
+    }
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u32 = VES_COLLECTOR_STUB_LISTEN_ID;
+    if(epoll_ctl(ves_collector_stub_epoll, EPOLL_CTL_ADD, ves_collector_stub_listen, &event) != 0) {
+        log_error("epoll_ctl() failed: %s", strerror(errno));
+        goto failure;
+    }
+
+    event.events = EPOLLIN;
+    event.data.u32 = VES_COLLECTOR_STUB_STOP_ID;
+    if(epoll_ctl(ves_collector_stub_epoll, EPOLL_CTL_ADD, ves_collector_stub_stop, &event) != 0) {
+        log_error("epoll_ctl() failed: %s", strerror(errno));
+        goto failure;
+    }
+
+    if(pthread_create(&ves_collector_stub_thread, 0, ves_collector_stub_routine, 0) != 0) {
+        log_error("pthread_create() failed");
+        goto failure;
+    }
+    ves_collector_stub_running = true;
+
+    return 0;
+
+failure:
+    ves_collector_stub_free();
+    return 1;
+}
+
+void ves_collector_stub_free(void) {
+    if(ves_collector_stub_running) {
+        uint64_t one = 1;
+        if(write(ves_collector_stub_stop, &one, sizeof(one)) != sizeof(one)) {
+            log_error("write() to the stop eventfd failed");
+        }
+        pthread_join(ves_collector_stub_thread, 0);
+        ves_collector_stub_running = false;
+    }
+
+    for(int i = 0; i < VES_COLLECTOR_STUB_MAX_CONNECTIONS; i++) {
+        if(ves_collector_stub_connections[i].fd != -1) {
+            ves_collector_stub_close(&ves_collector_stub_connections[i]);
+        }
+    }
+
+    if(ves_collector_stub_epoll != -1) {
+        close(ves_collector_stub_epoll);
+        ves_collector_stub_epoll = -1;
+    }
+
+    if(ves_collector_stub_stop != -1) {
+        close(ves_collector_stub_stop);
+        ves_collector_stub_stop = -1;
+    }
+
+    if(ves_collector_stub_listen != -1) {
+        close(ves_collector_stub_listen);
+        ves_collector_stub_listen = -1;
+    }
+
+    free(ves_collector_stub_inflated);
+    ves_collector_stub_inflated = 0;
+    ves_collector_stub_inflated_size = 0;
+}
+
+int ves_collector_stub_port(void) {
+    return ves_collector_stub_bound_port;
+}
+
+void ves_collector_stub_get_stats(ves_collector_stub_stats_t *stats) {
+    pthread_mutex_lock(&ves_collector_stub_mutex);
+    memcpy(stats, &ves_collector_stub_stats, sizeof(ves_collector_stub_stats_t));
+    pthread_mutex_unlock(&ves_collector_stub_mutex);
+
+    stats->cpu_us = 0;
+    clockid_t clock;
+    struct timespec ts;
+    if(ves_collector_stub_running && (pthread_getcpuclockid(ves_collector_stub_thread, &clock) == 0) && (clock_gettime(clock, &ts) == 0)) {
+        stats->cpu_us = ts.tv_sec * 1000000L + ts.tv_nsec / 1000L;
+    }
+}
+
+static void *ves_collector_stub_routine(void *arg) {
+    struct epoll_event events[VES_COLLECTOR_STUB_MAX_CONNECTIONS + 2];
+    bool stop = false;
+
+    while(!stop) {
+        // sleep until the earliest delayed response is due
+        long int now = get_monotonic_milliseconds();
+        int timeout = -1;
+        for(int i = 0; i < VES_COLLECTOR_STUB_MAX_CONNECTIONS; i++) {
+            const ves_collector_stub_connection_t *connection = &ves_collector_stub_connections[i];
+            if((connection->fd != -1) && (connection->respond_at != -1)) {
+                int remaining = (connection->respond_at > now) ? (int)(connection->respond_at - now) : 0;
+                if((timeout == -1) || (remaining < timeout)) {
+                    timeout = remaining;
+                }
+            }
+        }
+
+        int n = epoll_wait(ves_collector_stub_epoll, events, VES_COLLECTOR_STUB_MAX_CONNECTIONS + 2, timeout);
+        if((n < 0) && (errno != EINTR)) {
+            log_error("epoll_wait() failed: %s", strerror(errno));
+            break;
+        }
+
+        for(int i = 0; i < n; i++) {
+            if(events[i].data.u32 == VES_COLLECTOR_STUB_STOP_ID) {
+                stop = true;
+            }
+            else if(events[i].data.u32 == VES_COLLECTOR_STUB_LISTEN_ID) {
+                ves_collector_stub_accept();
+            }
+            else {
+                ves_collector_stub_read(&ves_collector_stub_connections[events[i].data.u32]);
+            }
+        }
+
+        now = get_monotonic_milliseconds();
+        for(int i = 0; i < VES_COLLECTOR_STUB_MAX_CONNECTIONS; i++) {
+            ves_collector_stub_connection_t *connection = &ves_collector_stub_connections[i];
+            if((connection->fd != -1) && (connection->respond_at != -1) && (connection->respond_at <= now)) {
+                ves_collector_stub_respond(connection);
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void ves_collector_stub_accept(void) {
+    while(true) {
+        int fd = accept4(ves_collector_stub_listen, 0, 0, SOCK_NONBLOCK);
+        if(fd < 0) {
+            if((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+                log_error("accept4() failed: %s", strerror(errno));
+            }
+            return;
+        }
+
+        int index = -1;
+        for(int i = 0; i < VES_COLLECTOR_STUB_MAX_CONNECTIONS; i++) {
+            if(ves_collector_stub_connections[i].fd == -1) {
+                index = i;
+                break;
+            }
+        }
+
+        if(index == -1) {
+            log_error("ves collector stub: too many connections");
+            close(fd);
+            continue;
+        }
+
+        ves_collector_stub_connection_t *connection = &ves_collector_stub_connections[index];
+        connection->buffer = (char *)malloc(VES_COLLECTOR_STUB_BUFFER_SIZE);
+        if(connection->buffer == 0) {
+            log_error("malloc failed");
+            close(fd);
+            continue;
+        }
+        connection->fd = fd;
+        connection->buffer_size = VES_COLLECTOR_STUB_BUFFER_SIZE;
+        connection->buffer_len = 0;
+        connection->request_len = 0;
+        connection->respond_at = -1;
+        connection->continued = false;
+
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.u32 = index;
+        if(epoll_ctl(ves_collector_stub_epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+            log_error("epoll_ctl() failed: %s", strerror(errno));
+            ves_collector_stub_close(connection);
+        }
+    }
+}
+
+static void ves_collector_stub_read(ves_collector_stub_connection_t *connection) {
+    while(true) {
+        if(connection->buffer_len == connection->buffer_size) {
+            char *buffer = (char *)realloc(connection->buffer, connection->buffer_size * 2);
+            if(buffer == 0) {
+                log_error("realloc failed");
+                ves_collector_stub_close(connection);
+                return;
+            }
+            connection->buffer = buffer;
+            connection->buffer_size *= 2;
+        }
+
+        ssize_t rc = recv(connection->fd, connection->buffer + connection->buffer_len, connection->buffer_size - connection->buffer_len, 0);
+        if(rc > 0) {
+            connection->buffer_len += rc;
+            continue;
+        }
+
+        if((rc < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) {
+            break;
+        }
+
+        // closed by the client, or broken
+        ves_collector_stub_close(connection);
+        return;
+    }
+
+    ves_collector_stub_parse(connection);
+}
+
+// looks for a complete request at the start of the buffer and schedules its response
+static void ves_collector_stub_parse(ves_collector_stub_connection_t *connection) {
+    if(connection->respond_at != -1) {
+        // one request at a time, a pipelined one waits in the buffer
+        return;
+    }
+
+    char *end = memmem(connection->buffer, connection->buffer_len, "\r\n\r\n", 4);
+    if(end == 0) {
+        return;
+    }
+    size_t header_len = end - connection->buffer + 4;
+
+    size_t content_length = 0;
+    bool gzip = false;
+    bool expect_continue = false;
+    *end = 0;
+    for(char *line = strstr(connection->buffer, "\r\n"); line; line = strstr(line, "\r\n")) {
+        line += 2;
+        if(strncasecmp(line, "Content-Length:", 15) == 0) {
+            content_length = strtoul(line + 15, 0, 10);
+        }
+        else if(strncasecmp(line, "Content-Encoding:", 17) == 0) {
+            gzip = (strcasestr(line + 17, "gzip") != 0);
+        }
+        else if(strncasecmp(line, "Expect:", 7) == 0) {
+            expect_continue = (strcasestr(line + 7, "100-continue") != 0);
+        }
+    }
+    *end = '\r';
+
+    if(connection->buffer_len < header_len + content_length) {
+        if(expect_continue && !connection->continued) {
+            const char *response = "HTTP/1.1 100 Continue\r\n\r\n";
+            if(send(connection->fd, response, strlen(response), MSG_NOSIGNAL) < 0) {
+                ves_collector_stub_close(connection);
+                return;
+            }
+            connection->continued = true;
+        }
+        return;
+    }
+
+    bool error = (ves_collector_stub_config.error_permille > 0) && ((rand_r(&ves_collector_stub_seed) % 1000) < ves_collector_stub_config.error_permille);
+    long int events = error ? 0 : ves_collector_stub_count_events(connection->buffer + header_len, content_length, gzip);
+
+    pthread_mutex_lock(&ves_collector_stub_mutex);
+    ves_collector_stub_stats.requests++;
+    ves_collector_stub_stats.bytes += content_length;
+    if(error) {
+        ves_collector_stub_stats.errors++;
+    }
+    else {
+        ves_collector_stub_stats.events += events;
+    }
+    pthread_mutex_unlock(&ves_collector_stub_mutex);
+
+    connection->request_len = header_len + content_length;
+    connection->response_code = error ? ves_collector_stub_config.error_code : 202;
+    connection->respond_at = get_monotonic_milliseconds() + ves_collector_stub_config.latency_ms;
+}
+
+static void ves_collector_stub_respond(ves_collector_stub_connection_t *connection) {
+    char response[128];
+    int len = snprintf(response, sizeof(response), "HTTP/1.1 %d %s\r\nContent-Length: 0\r\n\r\n", connection->response_code, (connection->response_code == 202) ? "Accepted" : "Injected Error");
+
+    // a few bytes on an otherwise idle keep-alive connection, the socket buffer always takes them
+    if(send(connection->fd, response, len, MSG_NOSIGNAL) != len) {
+        ves_collector_stub_close(connection);
+        return;
+    }
+
+    connection->buffer_len -= connection->request_len;
+    memmove(connection->buffer, connection->buffer + connection->request_len, connection->buffer_len);
+    connection->request_len = 0;
+    connection->respond_at = -1;
+    connection->continued = false;
+
+    ves_collector_stub_parse(connection);
+}
+
+static void ves_collector_stub_close(ves_collector_stub_connection_t *connection) {
+    epoll_ctl(ves_collector_stub_epoll, EPOLL_CTL_DEL, connection->fd, 0);
+    close(connection->fd);
+    free(connection->buffer);
+    memset(connection, 0, sizeof(ves_collector_stub_connection_t));
+    connection->fd = -1;
+    connection->respond_at = -1;
+}
+
+// every event, alone or in an eventList, carries exactly one commonEventHeader
+static long int ves_collector_stub_count_events(const char *body, size_t size, bool gzip) {
+    static const char needle[] = "\"commonEventHeader\"";
+
+    if(gzip) {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        if(inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+            log_error("inflateInit2() failed");
+            return 0;
+        }
+
+        stream.next_in = (Bytef *)body;
+        stream.avail_in = size;
+        size_t total = 0;
+        int rc;
+        do {
+            if(total == ves_collector_stub_inflated_size) {
+                size_t inflated_size = ves_collector_stub_inflated_size ? ves_collector_stub_inflated_size * 2 : VES_COLLECTOR_STUB_BUFFER_SIZE;
+                unsigned char *inflated = (unsigned char *)realloc(ves_collector_stub_inflated, inflated_size);
+                if(inflated == 0) {
+                    log_error("realloc failed");
+                    inflateEnd(&stream);
+                    return 0;
+                }
+                ves_collector_stub_inflated = inflated;
+                ves_collector_stub_inflated_size = inflated_size;
+            }
+
+            stream.next_out = ves_collector_stub_inflated + total;
+            stream.avail_out = ves_collector_stub_inflated_size - total;
+            rc = inflate(&stream, Z_NO_FLUSH);
+            total = ves_collector_stub_inflated_size - stream.avail_out;
+        } while(rc == Z_OK);
+        inflateEnd(&stream);
+
+        if(rc != Z_STREAM_END) {
+            log_error("inflate() failed: %d", rc);
+            return 0;
+        }
+
+        body = (const char *)ves_collector_stub_inflated;
+        size = total;
+    }
+
+    long int events = 0;
+    const char *end = body + size;
+    const char *found;
+    while((found = memmem(body, end - body, needle, sizeof(needle) - 1))) {
+        events++;
+        body = found + sizeof(needle) - 1;
+    }
+
+    return events;
+}
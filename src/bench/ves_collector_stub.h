@@ -0,0 +1,52 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+
+#pragma once
+
+/**
+ * loopback VES collector stand-in for offline benchmarks
+ *   a single epoll thread serving HTTP/1.1 keep-alive POSTs on 127.0.0.1, counting the events
+ *   (gzip bodies are inflated first) and answering 202 after latency_ms, or error_code for
+ *   error_permille out of every 1000 requests
+*/
+typedef struct ves_collector_stub_config {
+    int port;                   // 0 picks a free one, see ves_collector_stub_port()
+    int latency_ms;             // delay before each response
+    int error_permille;
+    int error_code;             // sent instead of 202 for the injected errors, e.g. 503
+} ves_collector_stub_config_t;
+
+typedef struct ves_collector_stub_stats {
+    long int requests;
+    long int events;            // events in the requests answered with 202
+    long int errors;            // requests answered with error_code
+    long int bytes;             // request bodies as received
+    long int cpu_us;            // time spent by the stub thread
+} ves_collector_stub_stats_t;
+
+int ves_collector_stub_init(const ves_collector_stub_config_t *config);
+void ves_collector_stub_free(void);
+
+int ves_collector_stub_port(void);
+void ves_collector_stub_get_stats(ves_collector_stub_stats_t *stats);
@@ -26,9 +26,16 @@
 files=(
     # alarms
     "alarms/alarms.c"
+    "alarms/alarms_inventory.c"
 
     # common
     "common/config.c"
+    "common/histogram.c"
+    "common/log.c"
+    "common/stages.c"
+    "common/timer_wheel.c"
+    "common/timestamp.c"
+    "common/trace.c"
     "common/utils.c"
 
     # netconf
@@ -42,6 +49,10 @@ files=(
 
     # pm_data
     "pm_data/pm_data.c"
+    "pm_data/pm_data_journal.c"
+    "pm_data/pm_data_retention.c"
+    "pm_data/pm_data_ue.c"
+    "pm_data/pm_data_writer.c"
 
     # telnet
     "telnet/telnet.c"
@@ -49,6 +60,9 @@ files=(
     # ves
     "ves/ves.c"
     "ves/ves_internal.c"
+    "ves/ves_outbox.c"
+    "ves/ves_template.c"
+    "ves/ves_sender.c"
 
     "main.c"
 )
@@ -64,8 +78,67 @@ libs=(
     "curl"
     "telnet"
     "cjson"
+    "z"
 )
 
+output="gnb-adapter"
+
+# ./build.sh --release compiles out log_debug() and log_trace() sites, see common/log.h
+defines=""
+if [ "$1" == "--release" ]; then
+    defines="-O2 -DLOG_MAX_VERBOSITY=1"
+fi
+
+# ./build.sh --bench builds the offline VES benchmark against the loopback collector stub instead
+if [ "$1" == "--bench" ]; then
+    files=(
+        # bench
+        "bench/ves_bench.c"
+        "bench/ves_collector_stub.c"
+
+        # common
+        "common/config.c"
+        "common/histogram.c"
+        "common/log.c"
+        "common/stages.c"
+        "common/timer_wheel.c"
+        "common/timestamp.c"
+        "common/trace.c"
+        "common/utils.c"
+
+        # ves
+        "ves/ves.c"
+        "ves/ves_internal.c"
+        "ves/ves_outbox.c"
+        "ves/ves_template.c"
+        "ves/ves_sender.c"
+    )
+
+    libs=(
+        "pthread"
+        "curl"
+        "cjson"
+        "z"
+    )
+
+    output="ves-bench"
+fi
+
+# ./build.sh --tools builds the offline trace log decoder
+if [ "$1" == "--tools" ]; then
+    files=(
+        # common
+        "common/timestamp.c"
+
+        # tools
+        "tools/trace_decode.c"
+    )
+
+    libs=()
+
+    output="trace-decode"
+fi
+
 sources=""
 for i in ${files[@]}
 do
@@ -89,8 +162,7 @@ do
     includes="$includes -I$i"
 done
 
-output="gnb-adapter"
-build="gcc -g -Wall -pedantic $includes $sources $libraries -o$output"
+build="gcc -g -Wall -pedantic $defines $includes $sources $libraries -o$output"
 
 clear
 echo "Building with command: $build"
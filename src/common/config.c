@@ -247,6 +247,19 @@ int config_init(const char *filename) {
         log_error("config json strdup error");
         goto failure;
     }
+    object = cJSON_GetObjectItem(template, "measurement");
+    if(object) {
+        strobject = cJSON_GetStringValue(object);
+        if(strobject == 0) {
+            log_error("config json strobject null");
+            goto failure;
+        }
+        config.ves.template.measurement = strdup(strobject);
+        if(config.ves.template.measurement == 0) {
+            log_error("config json strdup error");
+            goto failure;
+        }
+    }
 
     object = cJSON_GetObjectItem(top, "pnf-registration");
     if(object == 0) {
@@ -262,6 +275,12 @@ int config_init(const char *filename) {
     }
     config.ves.heartbeat_interval = object->valueint;
 
+    config.ves.sftp_daemon = true;
+    object = cJSON_GetObjectItem(top, "sftp-daemon");
+    if(object) {
+        config.ves.sftp_daemon = object->valueint;
+    }
+
     object = cJSON_GetObjectItem(top, "url");
     if(object == 0) {
         log_error("config json parser error: url");
@@ -310,6 +329,122 @@ int config_init(const char *filename) {
         goto failure;
     }
 
+    config.ves.collectors = 0;
+    config.ves.collectors_len = 0;
+    object = cJSON_GetObjectItem(top, "collectors");
+    if(object) {
+        int collectors_len = cJSON_GetArraySize(object);
+        if(collectors_len > 0) {
+            config.ves.collectors = (config_ves_collector_t *)calloc(collectors_len, sizeof(config_ves_collector_t));
+            if(config.ves.collectors == 0) {
+                log_error("calloc failed");
+                goto failure;
+            }
+        }
+
+        for(int i = 0; i < collectors_len; i++) {
+            cJSON *item = cJSON_GetArrayItem(object, i);
+            config_ves_collector_t *collector = &config.ves.collectors[i];
+            config.ves.collectors_len++;
+
+            const char *keys[] = {"name", "url", "username", "password"};
+            char **values[] = {&collector->name, &collector->url, &collector->username, &collector->password};
+            for(int j = 0; j < 4; j++) {
+                strobject = cJSON_GetStringValue(cJSON_GetObjectItem(item, keys[j]));
+                if(strobject == 0) {
+                    log_error("config json parser error: collectors[%d].%s", i, keys[j]);
+                    goto failure;
+                }
+
+                *values[j] = strdup(strobject);
+                if(*values[j] == 0) {
+                    log_error("config json strdup error");
+                    goto failure;
+                }
+            }
+        }
+    }
+
+    config.ves.queue_size = 256;
+    object = cJSON_GetObjectItem(top, "queue-size");
+    if(object) {
+        config.ves.queue_size = object->valueint;
+    }
+
+    config.ves.max_in_flight = 4;
+    object = cJSON_GetObjectItem(top, "max-in-flight");
+    if(object) {
+        config.ves.max_in_flight = object->valueint;
+    }
+
+    config.ves.batch_window = 0;
+    object = cJSON_GetObjectItem(top, "batch-window");
+    if(object) {
+        config.ves.batch_window = object->valueint;
+    }
+
+    config.ves.batch_max_events = 16;
+    object = cJSON_GetObjectItem(top, "batch-max-events");
+    if(object) {
+        config.ves.batch_max_events = object->valueint;
+    }
+
+    object = cJSON_GetObjectItem(top, "outbox");
+    if(object) {
+        strobject = cJSON_GetStringValue(object);
+        if(strobject == 0) {
+            log_error("config json strobject null");
+            goto failure;
+        }
+        config.ves.outbox = strdup(strobject);
+        if(config.ves.outbox == 0) {
+            log_error("config json strdup error");
+            goto failure;
+        }
+    }
+
+    config.ves.outbox_max_segments = 64;
+    object = cJSON_GetObjectItem(top, "outbox-max-segments");
+    if(object) {
+        config.ves.outbox_max_segments = object->valueint;
+    }
+
+    config.ves.breaker_threshold = 5;
+    object = cJSON_GetObjectItem(top, "breaker-threshold");
+    if(object) {
+        config.ves.breaker_threshold = object->valueint;
+    }
+
+    config.ves.breaker_probe_interval = 10;
+    object = cJSON_GetObjectItem(top, "breaker-probe-interval");
+    if(object) {
+        config.ves.breaker_probe_interval = object->valueint;
+    }
+
+    config.ves.low_priority_rate = 0;
+    object = cJSON_GetObjectItem(top, "low-priority-rate");
+    if(object) {
+        config.ves.low_priority_rate = object->valueint;
+    }
+
+    config.ves.low_priority_burst = 16;
+    object = cJSON_GetObjectItem(top, "low-priority-burst");
+    if(object) {
+        config.ves.low_priority_burst = object->valueint;
+    }
+
+    config.ves.compression = false;
+    object = cJSON_GetObjectItem(top, "compression");
+    if(object) {
+        config.ves.compression = object->valueint;
+    }
+
+    config.ves.compression_level = 6;
+    object = cJSON_GetObjectItem(top, "compression-level");
+    if(object) {
+        config.ves.compression_level = object->valueint;
+    }
+
     object = cJSON_GetObjectItem(top, "file-expiry");
     if(object == 0) {
         log_error("config json parser error: file-expiry");
@@ -324,25 +459,161 @@ int config_init(const char *filename) {
     }
     config.ves.pm_data_interval = object->valueint;
 
+    // measurement streaming is optional and off unless configured
+    config.ves.measurement_interval = 0;
+    object = cJSON_GetObjectItem(top, "measurement-interval");
+    if(object) {
+        config.ves.measurement_interval = object->valueint;
+    }
+
+    if((config.ves.measurement_interval > 0) && (config.ves.template.measurement == 0)) {
+        log_error("config json parser error: measurement-interval set without measurement template");
+        goto failure;
+    }
+
+    // pm-data section is optional, defaults match the former 24h "find -delete" rotation
+    config.pm_data.retention_max_age = 24 * 60 * 60;
+    config.pm_data.retention_max_bytes = 0;
+    config.pm_data.compression = false;
+    config.pm_data.compression_level = 6;
+    config.pm_data.max_ues = 64;
+    top = cJSON_GetObjectItem(cjson, "pm-data");
+    if(top) {
+        object = cJSON_GetObjectItem(top, "retention-max-age");
+        if(object) {
+            config.pm_data.retention_max_age = object->valueint;
+        }
+
+        object = cJSON_GetObjectItem(top, "retention-max-bytes");
+        if(object) {
+            config.pm_data.retention_max_bytes = (long long)object->valuedouble;
+        }
+
+        object = cJSON_GetObjectItem(top, "compression");
+        if(object) {
+            config.pm_data.compression = object->valueint;
+        }
+
+        object = cJSON_GetObjectItem(top, "compression-level");
+        if(object) {
+            config.pm_data.compression_level = object->valueint;
+        }
+
+        object = cJSON_GetObjectItem(top, "journal");
+        if(object) {
+            strobject = cJSON_GetStringValue(object);
+            if(strobject == 0) {
+                log_error("config json strobject null");
+                goto failure;
+            }
+            config.pm_data.journal = strdup(strobject);
+            if(config.pm_data.journal == 0) {
+                log_error("config json strdup error");
+                goto failure;
+            }
+        }
+
+        object = cJSON_GetObjectItem(top, "max-ues");
+        if(object) {
+            config.pm_data.max_ues = object->valueint;
+        }
+    }
+
     top = cJSON_GetObjectItem(cjson, "alarms");
     if(top == 0) {
         log_error("config json parse error: alarms");
         goto failure;
     }
 
+    config.alarms.rules = 0;
+    config.alarms.rules_len = 0;
+    object = cJSON_GetObjectItem(top, "rules");
+    if(object) {
+        int rules_len = cJSON_GetArraySize(object);
+        if(rules_len > 0) {
+            config.alarms.rules = (config_alarm_rule_t *)calloc(rules_len, sizeof(config_alarm_rule_t));
+            if(config.alarms.rules == 0) {
+                log_error("calloc failed");
+                goto failure;
+            }
+        }
+
+        for(int i = 0; i < rules_len; i++) {
+            cJSON *item = cJSON_GetArrayItem(object, i);
+            config_alarm_rule_t *rule = &config.alarms.rules[i];
+            config.alarms.rules_len++;
+
+            const char *keys[] = {"alarm", "metric", "comparator", "severity", "type", "object-instance"};
+            char **values[] = {&rule->alarm, &rule->metric, &rule->comparator, &rule->severity, &rule->type, &rule->object_instance};
+            for(int j = 0; j < 6; j++) {
+                strobject = cJSON_GetStringValue(cJSON_GetObjectItem(item, keys[j]));
+                if(strobject == 0) {
+                    log_error("config json parser error: rules[%d].%s", i, keys[j]);
+                    goto failure;
+                }
+
+                *values[j] = strdup(strobject);
+                if(*values[j] == 0) {
+                    log_error("config json strdup error");
+                    goto failure;
+                }
+            }
+
+            cJSON *threshold = cJSON_GetObjectItem(item, "raise");
+            if(!cJSON_IsNumber(threshold)) {
+                log_error("config json parser error: rules[%d].raise", i);
+                goto failure;
+            }
+            rule->raise = threshold->valuedouble;
+
+            // no hysteresis unless a separate clear threshold is given
+            rule->clear = rule->raise;
+            threshold = cJSON_GetObjectItem(item, "clear");
+            if(cJSON_IsNumber(threshold)) {
+                rule->clear = threshold->valuedouble;
+            }
+
+            rule->debounce = 0;
+            threshold = cJSON_GetObjectItem(item, "debounce");
+            if(cJSON_IsNumber(threshold)) {
+                rule->debounce = threshold->valueint;
+            }
+
+            strobject = cJSON_GetStringValue(cJSON_GetObjectItem(item, "scope"));
+            rule->scope = strdup(strobject ? strobject : "cell");
+            if(rule->scope == 0) {
+                log_error("config json strdup error");
+                goto failure;
+            }
+
+            strobject = cJSON_GetStringValue(cJSON_GetObjectItem(item, "suppressed-by"));
+            if(strobject) {
+                rule->suppressed_by = strdup(strobject);
+                if(rule->suppressed_by == 0) {
+                    log_error("config json strdup error");
+                    goto failure;
+                }
+            }
+        }
+    }
+
     object = cJSON_GetObjectItem(top, "load-downlink-exceeded-warning-threshold");
-    if(object == 0) {
+    if(object) {
+        config.alarms.load_downlink_exceeded_warning_threshold = object->valueint;
+    }
+    else if(config.alarms.rules_len == 0) {
         log_error("config json parser error: load-downlink-exceeded-warning-threshold");
         goto failure;
     }
-    config.alarms.load_downlink_exceeded_warning_threshold = object->valueint;
 
     object = cJSON_GetObjectItem(top, "load-downlink-exceeded-warning-timeout");
-    if(object == 0) {
+    if(object) {
+        config.alarms.load_downlink_exceeded_warning_timeout = object->valueint;
+    }
+    else if(config.alarms.rules_len == 0) {
         log_error("config json parser error: load-downlink-exceeded-warning-timeout");
         goto failure;
     }
-    config.alarms.load_downlink_exceeded_warning_timeout = object->valueint;
 
     object = cJSON_GetObjectItem(top, "internal-connection-lost-timeout");
     if(object == 0) {
@@ -351,6 +622,24 @@ int config_init(const char *filename) {
     }
     config.alarms.internal_connection_lost_timeout = object->valueint;
 
+    config.alarms.coalesce_window = 0;
+    object = cJSON_GetObjectItem(top, "coalesce-window");
+    if(object) {
+        config.alarms.coalesce_window = object->valueint;
+    }
+
+    config.alarms.flap_threshold = 0;
+    object = cJSON_GetObjectItem(top, "flap-threshold");
+    if(object) {
+        config.alarms.flap_threshold = object->valueint;
+    }
+
+    config.alarms.flap_window = 60;
+    object = cJSON_GetObjectItem(top, "flap-window");
+    if(object) {
+        config.alarms.flap_window = object->valueint;
+    }
+
 
     top = cJSON_GetObjectItem(cjson, "telnet");
     if(top == 0) {
@@ -380,6 +669,62 @@ int config_init(const char *filename) {
     }
     config.telnet.port = object->valueint;
 
+    // trace section is optional, without a file nothing is traced
+    config.trace.file = 0;
+    config.trace.records = 65536;
+    top = cJSON_GetObjectItem(cjson, "trace");
+    if(top) {
+        object = cJSON_GetObjectItem(top, "file");
+        if(object) {
+            strobject = cJSON_GetStringValue(object);
+            if(strobject == 0) {
+                log_error("config json strobject null");
+                goto failure;
+            }
+            config.trace.file = strdup(strobject);
+            if(config.trace.file == 0) {
+                log_error("config json strdup error");
+                goto failure;
+            }
+        }
+
+        object = cJSON_GetObjectItem(top, "records");
+        if(object) {
+            config.trace.records = object->valueint;
+        }
+    }
+
+    // stages section is optional
+    config.stages.budget = 1000;
+    config.stages.log_interval = 60;
+    config.stages.socket = 0;
+    top = cJSON_GetObjectItem(cjson, "stages");
+    if(top) {
+        object = cJSON_GetObjectItem(top, "budget");
+        if(object) {
+            config.stages.budget = object->valueint;
+        }
+
+        object = cJSON_GetObjectItem(top, "log-interval");
+        if(object) {
+            config.stages.log_interval = object->valueint;
+        }
+
+        object = cJSON_GetObjectItem(top, "socket");
+        if(object) {
+            strobject = cJSON_GetStringValue(object);
+            if(strobject == 0) {
+                log_error("config json strobject null");
+                goto failure;
+            }
+            config.stages.socket = strdup(strobject);
+            if(config.stages.socket == 0) {
+                log_error("config json strdup error");
+                goto failure;
+            }
+        }
+    }
+
     top = cJSON_GetObjectItem(cjson, "info");
     if(top == 0) {
         log_error("config json parse error: info");
@@ -574,6 +919,7 @@ config_t *config_get() {
     }
     c->ves.pnf_registration = config.ves.pnf_registration;
     c->ves.heartbeat_interval = config.ves.heartbeat_interval;
+    c->ves.sftp_daemon = config.ves.sftp_daemon;
     c->ves.url = strdup(config.ves.url);
     if(c->ves.url == 0) {
         log_error("ves.url failed");
@@ -589,12 +935,107 @@ config_t *config_get() {
         log_error("ves.password failed");
         goto failure;
     }
+    if(config.ves.collectors_len) {
+        c->ves.collectors = (config_ves_collector_t *)calloc(config.ves.collectors_len, sizeof(config_ves_collector_t));
+        if(c->ves.collectors == 0) {
+            log_error("ves.collectors failed");
+            goto failure;
+        }
+    }
+    for(int i = 0; i < config.ves.collectors_len; i++) {
+        c->ves.collectors_len++;
+        c->ves.collectors[i].name = strdup(config.ves.collectors[i].name);
+        c->ves.collectors[i].url = strdup(config.ves.collectors[i].url);
+        c->ves.collectors[i].username = strdup(config.ves.collectors[i].username);
+        c->ves.collectors[i].password = strdup(config.ves.collectors[i].password);
+        if(!c->ves.collectors[i].name || !c->ves.collectors[i].url || !c->ves.collectors[i].username || !c->ves.collectors[i].password) {
+            log_error("ves.collectors failed");
+            goto failure;
+        }
+    }
+    c->ves.queue_size = config.ves.queue_size;
+    c->ves.max_in_flight = config.ves.max_in_flight;
+    c->ves.batch_window = config.ves.batch_window;
+    c->ves.batch_max_events = config.ves.batch_max_events;
+    if(config.ves.outbox) {
+        c->ves.outbox = strdup(config.ves.outbox);
+        if(c->ves.outbox == 0) {
+            log_error("ves.outbox failed");
+            goto failure;
+        }
+    }
+    c->ves.outbox_max_segments = config.ves.outbox_max_segments;
+    c->ves.breaker_threshold = config.ves.breaker_threshold;
+    c->ves.breaker_probe_interval = config.ves.breaker_probe_interval;
+    c->ves.low_priority_rate = config.ves.low_priority_rate;
+    c->ves.low_priority_burst = config.ves.low_priority_burst;
+    c->ves.compression = config.ves.compression;
+    c->ves.compression_level = config.ves.compression_level;
     c->ves.file_expiry = config.ves.file_expiry;
     c->ves.pm_data_interval = config.ves.pm_data_interval;
+    if(config.ves.template.measurement) {
+        c->ves.template.measurement = strdup(config.ves.template.measurement);
+        if(c->ves.template.measurement == 0) {
+            log_error("ves.template.measurement failed");
+            goto failure;
+        }
+    }
+    c->ves.measurement_interval = config.ves.measurement_interval;
+
+    c->pm_data.retention_max_age = config.pm_data.retention_max_age;
+    c->pm_data.retention_max_bytes = config.pm_data.retention_max_bytes;
+    c->pm_data.compression = config.pm_data.compression;
+    c->pm_data.compression_level = config.pm_data.compression_level;
+    if(config.pm_data.journal) {
+        c->pm_data.journal = strdup(config.pm_data.journal);
+        if(c->pm_data.journal == 0) {
+            log_error("pm_data.journal failed");
+            goto failure;
+        }
+    }
+    c->pm_data.max_ues = config.pm_data.max_ues;
 
     c->alarms.internal_connection_lost_timeout = config.alarms.internal_connection_lost_timeout;
     c->alarms.load_downlink_exceeded_warning_threshold = config.alarms.load_downlink_exceeded_warning_threshold;
     c->alarms.load_downlink_exceeded_warning_timeout = config.alarms.load_downlink_exceeded_warning_timeout;
+    c->alarms.coalesce_window = config.alarms.coalesce_window;
+    c->alarms.flap_threshold = config.alarms.flap_threshold;
+    c->alarms.flap_window = config.alarms.flap_window;
+    if(config.alarms.rules_len) {
+        c->alarms.rules = (config_alarm_rule_t *)calloc(config.alarms.rules_len, sizeof(config_alarm_rule_t));
+        if(c->alarms.rules == 0) {
+            log_error("alarms.rules failed");
+            goto failure;
+        }
+    }
+    for(int i = 0; i < config.alarms.rules_len; i++) {
+        const config_alarm_rule_t *from = &config.alarms.rules[i];
+        config_alarm_rule_t *rule = &c->alarms.rules[i];
+        c->alarms.rules_len++;
+
+        rule->raise = from->raise;
+        rule->clear = from->clear;
+        rule->debounce = from->debounce;
+        rule->alarm = strdup(from->alarm);
+        rule->metric = strdup(from->metric);
+        rule->comparator = strdup(from->comparator);
+        rule->severity = strdup(from->severity);
+        rule->type = strdup(from->type);
+        rule->object_instance = strdup(from->object_instance);
+        rule->scope = strdup(from->scope);
+        if(!rule->alarm || !rule->metric || !rule->comparator || !rule->severity || !rule->type || !rule->object_instance || !rule->scope) {
+            log_error("alarms.rules failed");
+            goto failure;
+        }
+
+        if(from->suppressed_by) {
+            rule->suppressed_by = strdup(from->suppressed_by);
+            if(rule->suppressed_by == 0) {
+                log_error("alarms.rules failed");
+                goto failure;
+            }
+        }
+    }
     
     c->telnet.host = strdup(config.telnet.host);
     if(c->telnet.host == 0) {
@@ -603,6 +1044,25 @@ config_t *config_get() {
     }
     c->telnet.port = config.telnet.port;
 
+    if(config.trace.file) {
+        c->trace.file = strdup(config.trace.file);
+        if(c->trace.file == 0) {
+            log_error("trace.file failed");
+            goto failure;
+        }
+    }
+    c->trace.records = config.trace.records;
+
+    c->stages.budget = config.stages.budget;
+    c->stages.log_interval = config.stages.log_interval;
+    if(config.stages.socket) {
+        c->stages.socket = strdup(config.stages.socket);
+        if(c->stages.socket == 0) {
+            log_error("stages.socket failed");
+            goto failure;
+        }
+    }
+
     c->info.gnb_du_id = config.info.gnb_du_id;
     c->info.cell_local_id = config.info.cell_local_id;
     c->info.node_id = strdup(config.info.node_id);
@@ -670,16 +1130,52 @@ void config_free(config_t *cconfig) {
     cconfig->ves.template.heartbeat = 0;
     free(cconfig->ves.template.pm_data);
     cconfig->ves.template.pm_data = 0;
+    free(cconfig->ves.template.measurement);
+    cconfig->ves.template.measurement = 0;
     free(cconfig->ves.url);
     cconfig->ves.url = 0;
     free(cconfig->ves.username);
     cconfig->ves.username = 0;
     free(cconfig->ves.password);
     cconfig->ves.password = 0;
+    for(int i = 0; i < cconfig->ves.collectors_len; i++) {
+        free(cconfig->ves.collectors[i].name);
+        free(cconfig->ves.collectors[i].url);
+        free(cconfig->ves.collectors[i].username);
+        free(cconfig->ves.collectors[i].password);
+    }
+    free(cconfig->ves.collectors);
+    cconfig->ves.collectors = 0;
+    cconfig->ves.collectors_len = 0;
+    free(cconfig->ves.outbox);
+    cconfig->ves.outbox = 0;
+
+    free(cconfig->pm_data.journal);
+    cconfig->pm_data.journal = 0;
+
+    for(int i = 0; i < cconfig->alarms.rules_len; i++) {
+        free(cconfig->alarms.rules[i].alarm);
+        free(cconfig->alarms.rules[i].metric);
+        free(cconfig->alarms.rules[i].comparator);
+        free(cconfig->alarms.rules[i].severity);
+        free(cconfig->alarms.rules[i].type);
+        free(cconfig->alarms.rules[i].object_instance);
+        free(cconfig->alarms.rules[i].scope);
+        free(cconfig->alarms.rules[i].suppressed_by);
+    }
+    free(cconfig->alarms.rules);
+    cconfig->alarms.rules = 0;
+    cconfig->alarms.rules_len = 0;
     
     free(cconfig->telnet.host);
     cconfig->telnet.host = 0;
 
+    free(cconfig->trace.file);
+    cconfig->trace.file = 0;
+
+    free(cconfig->stages.socket);
+    cconfig->stages.socket = 0;
+
     free(cconfig->info.node_id);
     cconfig->info.node_id = 0;
     free(cconfig->info.location_name);
@@ -718,18 +1214,55 @@ void config_print(const config_t *cconfig) {
     log("- ves.template.file_ready: %s", cconfig->ves.template.file_ready);
     log("- ves.template.heartbeat: %s", cconfig->ves.template.heartbeat);
     log("- ves.template.pm_data: %s", cconfig->ves.template.pm_data);
+    log("- ves.template.measurement: %s", cconfig->ves.template.measurement ? cconfig->ves.template.measurement : "");
     log("- ves.pnf_registration: %d", cconfig->ves.pnf_registration);
     log("- ves.heartbeat_interval: %d", cconfig->ves.heartbeat_interval);
+    log("- ves.sftp_daemon: %d", cconfig->ves.sftp_daemon);
     log("- ves.url: %s", cconfig->ves.url);
     log("- ves.username: %s", cconfig->ves.username);
     log("- ves.password: %s", cconfig->ves.password);
+    for(int i = 0; i < cconfig->ves.collectors_len; i++) {
+        log("- ves.collectors[%d]: %s %s (%s:%s)", i, cconfig->ves.collectors[i].name, cconfig->ves.collectors[i].url, cconfig->ves.collectors[i].username, cconfig->ves.collectors[i].password);
+    }
+    log("- ves.queue_size: %d", cconfig->ves.queue_size);
+    log("- ves.max_in_flight: %d", cconfig->ves.max_in_flight);
+    log("- ves.batch_window: %d", cconfig->ves.batch_window);
+    log("- ves.batch_max_events: %d", cconfig->ves.batch_max_events);
+    log("- ves.outbox: %s", cconfig->ves.outbox ? cconfig->ves.outbox : "");
+    log("- ves.outbox_max_segments: %d", cconfig->ves.outbox_max_segments);
+    log("- ves.breaker_threshold: %d", cconfig->ves.breaker_threshold);
+    log("- ves.breaker_probe_interval: %d", cconfig->ves.breaker_probe_interval);
+    log("- ves.low_priority_rate: %d", cconfig->ves.low_priority_rate);
+    log("- ves.low_priority_burst: %d", cconfig->ves.low_priority_burst);
+    log("- ves.compression: %d", cconfig->ves.compression);
+    log("- ves.compression_level: %d", cconfig->ves.compression_level);
     log("- ves.file_expiry: %d", cconfig->ves.file_expiry);
     log("- ves.pm_data_interval: %d", cconfig->ves.pm_data_interval);
+    log("- ves.measurement_interval: %d", cconfig->ves.measurement_interval);
+    log("- pm_data.retention_max_age: %d", cconfig->pm_data.retention_max_age);
+    log("- pm_data.retention_max_bytes: %lld", cconfig->pm_data.retention_max_bytes);
+    log("- pm_data.compression: %d", cconfig->pm_data.compression);
+    log("- pm_data.compression_level: %d", cconfig->pm_data.compression_level);
+    log("- pm_data.journal: %s", cconfig->pm_data.journal ? cconfig->pm_data.journal : "");
+    log("- pm_data.max_ues: %d", cconfig->pm_data.max_ues);
     log("- alarms.internal_connection_lost_timeout: %d", cconfig->alarms.internal_connection_lost_timeout);
     log("- alarms.load_downlink_exceeded_warning_threshold: %d", cconfig->alarms.load_downlink_exceeded_warning_threshold);
     log("- alarms.load_downlink_exceeded_warning_timeout: %d", cconfig->alarms.load_downlink_exceeded_warning_timeout);
+    for(int i = 0; i < cconfig->alarms.rules_len; i++) {
+        const config_alarm_rule_t *rule = &cconfig->alarms.rules[i];
+        log("- alarms.rules[%d]: %s if %s %s %g (clear %g), debounce %d, %s %s on %s (per %s)%s%s", i, rule->alarm, rule->metric, rule->comparator, rule->raise, rule->clear, rule->debounce, rule->severity, rule->type, rule->object_instance, rule->scope,
+            rule->suppressed_by ? ", suppressed by " : "", rule->suppressed_by ? rule->suppressed_by : "");
+    }
+    log("- alarms.coalesce_window: %d", cconfig->alarms.coalesce_window);
+    log("- alarms.flap_threshold: %d", cconfig->alarms.flap_threshold);
+    log("- alarms.flap_window: %d", cconfig->alarms.flap_window);
     log("- telnet.host: %s", cconfig->telnet.host);
     log("- telnet.port: %d", cconfig->telnet.port);
+    log("- trace.file: %s", cconfig->trace.file ? cconfig->trace.file : "");
+    log("- trace.records: %d", cconfig->trace.records);
+    log("- stages.budget: %d", cconfig->stages.budget);
+    log("- stages.log_interval: %d", cconfig->stages.log_interval);
+    log("- stages.socket: %s", cconfig->stages.socket ? cconfig->stages.socket : "");
     log("- info.gnb_du_id: %d", cconfig->info.gnb_du_id);
     log("- info.cell_local_id: %d", cconfig->info.cell_local_id);
     log("- info.node_id: %s", cconfig->info.node_id);
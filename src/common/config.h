@@ -27,6 +27,27 @@
 
 extern int log_level;
 
+typedef struct config_ves_collector {
+    char *name;                 // also names its outbox subdirectory
+    char *url;
+    char *username;
+    char *password;
+} config_ves_collector_t;
+
+typedef struct config_alarm_rule {
+    char *alarm;
+    char *metric;               // load, num-ues, ue-thp-dl or ue-thp-ul
+    char *comparator;           // >, >=, < or <=
+    double raise;               // raised once metric <comparator> raise holds for debounce seconds
+    double clear;               // cleared once metric <comparator> clear no longer holds for debounce seconds
+    int debounce;
+    char *severity;             // as in alarm_severity_to_str(), e.g. WARNING
+    char *type;                 // as in alarm_type_to_str(), e.g. EQUIPMENT_ALARM
+    char *object_instance;      // @node-id@, @gnb-du-id@ and @cell-local-id@ are substituted, @ue-id@ per UE
+    char *scope;                // cell (default): one alarm; ue: one alarm per UE, for ue-thp-dl / ue-thp-ul
+    char *suppressed_by;        // optional alarm (e.g. internalConnectionLoss) that holds back this one's reports while raised
+} config_alarm_rule_t;
+
 typedef struct config_ves {
     struct {
         char *new_alarm;
@@ -35,17 +56,38 @@ typedef struct config_ves {
         char *file_ready;
         char *heartbeat;
         char *pm_data;
+        char *measurement;      // optional, only needed when measurement_interval is set
     } template;
 
     bool pnf_registration;
     int heartbeat_interval;
+    bool sftp_daemon;           // start sshd for the file-ready sftp transfers
 
+    // the primary collector
     char *url;
     char *username;
     char *password;
 
+    config_ves_collector_t *collectors;     // optional additional collectors, all events go to each of them
+    int collectors_len;
+
+    int queue_size;             // events waiting for the sender thread, more are dropped
+    int max_in_flight;          // concurrent requests to the collector
+    int batch_window;           // ms queued events wait to be coalesced into an eventBatch; 0 disables
+    int batch_max_events;
+    char *outbox;               // directory of the on-disk outbox; empty disables it
+    int outbox_max_segments;    // 1 MiB segments kept before the oldest events are given up
+    int breaker_threshold;      // consecutive failed requests before the collector is considered down
+    int breaker_probe_interval; // seconds between two probes of a collector considered down
+    int low_priority_rate;      // low priority (file-ready, measurement) events/s; 0 disables shaping
+    int low_priority_burst;     // low priority events allowed out at once after a quiet period
+    bool compression;           // gzip request bodies (Content-Encoding: gzip)
+    int compression_level;
+
     int file_expiry;
     int pm_data_interval;
+
+    int measurement_interval;   // seconds between measurement domain events; 0 disables them
 } config_ves_t;
 
 typedef struct config {
@@ -64,11 +106,31 @@ typedef struct config {
 
     config_ves_t ves;
 
+    struct {
+        int retention_max_age;          // seconds; 0 disables age based retention
+        long long retention_max_bytes;  // 0 disables size based retention
+
+        bool compression;               // gzip the PM files (.xml.gz)
+        int compression_level;
+
+        char *journal;                  // accumulator journal file; empty keeps it in memory only
+
+        int max_ues;                    // per-UE counters table size; 0 disables per-UE counters
+    } pm_data;
+
     struct {
         int internal_connection_lost_timeout;
 
+        // without rules, these two make up the single loadDownlinkExceededWarning rule
         int load_downlink_exceeded_warning_threshold;
         int load_downlink_exceeded_warning_timeout;
+
+        config_alarm_rule_t *rules;
+        int rules_len;
+
+        int coalesce_window;            // seconds between two reports of an alarm, transitions in between are merged; 0 disables
+        int flap_threshold;             // raises within flap_window that mark an alarm as flapping; 0 disables
+        int flap_window;                // seconds
     } alarms;
 
     struct {
@@ -76,6 +138,17 @@ typedef struct config {
         int port;
     } telnet;
 
+    struct {
+        char *file;                     // binary trace log, see common/trace.h; unset disables tracing
+        int records;                    // the file holds the last records events
+    } trace;
+
+    struct {
+        int budget;                     // ms, main loop ticks taking longer are counted as overruns; 0 disables
+        int log_interval;               // s, stage latencies are logged this often; 0 disables
+        char *socket;                   // unix socket serving stage latencies as JSON; unset disables
+    } stages;
+
     struct {
         int gnb_du_id;
         int cell_local_id;
@@ -0,0 +1,100 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+
+#include "histogram.h"
+
+#include <string.h>
+
+static int histogram_index(uint64_t value);
+static uint64_t histogram_upper(int index);
+
+void histogram_reset(histogram_t *histogram) {
+    memset(histogram, 0, sizeof(histogram_t));
+}
+
+void histogram_record(histogram_t *histogram, uint64_t value) {
+    histogram->counts[histogram_index(value)]++;
+    histogram->count++;
+    histogram->sum += value;
+    if(value > histogram->max) {
+        histogram->max = value;
+    }
+}
+
+void histogram_merge(histogram_t *histogram, const histogram_t *other) {
+    for(int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        histogram->counts[i] += other->counts[i];
+    }
+    histogram->count += other->count;
+    histogram->sum += other->sum;
+    if(other->max > histogram->max) {
+        histogram->max = other->max;
+    }
+}
+
+uint64_t histogram_percentile(const histogram_t *histogram, double p) {
+    if(histogram->count == 0) {
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t)(p / 100.0 * (double)histogram->count + 0.5);
+    if(rank == 0) {
+        rank = 1;
+    }
+    if(rank > histogram->count) {
+        rank = histogram->count;
+    }
+
+    uint64_t seen = 0;
+    for(int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->counts[i];
+        if(seen >= rank) {
+            uint64_t upper = histogram_upper(i);
+            return (upper < histogram->max) ? upper : histogram->max;
+        }
+    }
+
+    return histogram->max;
+}
+
+static int histogram_index(uint64_t value) {
+    if(value < HISTOGRAM_SUB_BUCKETS) {
+        return (int)value;
+    }
+
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - 4;
+    return (msb - 3) * HISTOGRAM_SUB_BUCKETS + (int)((value >> shift) & (HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+static uint64_t histogram_upper(int index) {
+    if(index < HISTOGRAM_SUB_BUCKETS) {
+        return (uint64_t)index;
+    }
+
+    int msb = index / HISTOGRAM_SUB_BUCKETS + 3;
+    int shift = msb - 4;
+    uint64_t sub = (uint64_t)(index % HISTOGRAM_SUB_BUCKETS);
+    return (((uint64_t)HISTOGRAM_SUB_BUCKETS + sub + 1) << shift) - 1;
+}
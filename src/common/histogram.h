@@ -0,0 +1,49 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * log-linear histogram of unsigned values (typically microseconds)
+ *   values below HISTOGRAM_SUB_BUCKETS are counted exactly, larger ones fall into
+ *   HISTOGRAM_SUB_BUCKETS linear buckets per power of two (relative error < 6.25%)
+*/
+#define HISTOGRAM_SUB_BUCKETS       16
+#define HISTOGRAM_BUCKETS           (61 * HISTOGRAM_SUB_BUCKETS)
+
+typedef struct histogram {
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+} histogram_t;
+
+void histogram_reset(histogram_t *histogram);
+void histogram_record(histogram_t *histogram, uint64_t value);
+void histogram_merge(histogram_t *histogram, const histogram_t *other);
+
+// p in [0, 100]; returns the upper bound of the bucket holding the p-th percentile
+uint64_t histogram_percentile(const histogram_t *histogram, double p);
@@ -0,0 +1,304 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+#define _GNU_SOURCE
+#include "log.h"
+#include "timestamp.h"
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LOG_RING_SIZE       256     // records per thread (~140KB), power of two, 25k lines/s at the writer's longest sleep
+#define LOG_MESSAGE_SIZE    512     // longer messages are cut short
+#define LOG_IDLE_SLEEP_MAX  10      // ms the writer sleeps for once there is nothing to write
+
+typedef struct log_record {
+    long int timestamp;             // microseconds since epoch
+    const char *file;               // __FILE__, a literal
+    int line;
+    uint8_t level;
+    bool to_file;
+    char message[LOG_MESSAGE_SIZE];
+} log_record_t;
+
+// single producer (the owning thread), single consumer (the writer thread)
+typedef struct log_ring {
+    _Atomic uint32_t head;
+    _Atomic uint32_t tail;
+    _Atomic unsigned long int dropped;
+    struct log_ring *next;
+    log_record_t records[LOG_RING_SIZE];
+} log_ring_t;
+
+static _Atomic(log_ring_t *) log_rings = 0;
+static atomic_bool log_running = false;
+static _Atomic unsigned long int log_dropped_total = 0;
+static pthread_t log_thread;
+static pthread_mutex_t log_drain_mutex = PTHREAD_MUTEX_INITIALIZER;  // one consumer at a time, the writer or a late producer
+static FILE *log_file = 0;
+
+static __thread log_ring_t *log_thread_ring = 0;
+
+static void *log_thread_routine(void *arg);
+static int log_drain(FILE *file);
+static void log_drain_late(void);
+static void log_emit(const log_record_t *record, FILE *file);
+static void log_format(log_record_t *record, int level, const char *file, int line, const char *format, va_list args);
+static log_ring_t *log_ring_get(void);
+
+void log_backend_init(const char *file, const char *mode) {
+    if(atomic_load(&log_running)) {
+        return;
+    }
+
+    // kept open for the lifetime of the writer
+    if(file) {
+        log_file = fopen(file, mode);
+    }
+
+    atomic_store(&log_running, true);
+    if(pthread_create(&log_thread, 0, log_thread_routine, 0) != 0) {
+        atomic_store(&log_running, false);
+        fprintf(stderr, "log writer thread failed to start, logging synchronously\n");
+    }
+}
+
+void log_backend_free(void) {
+    if(!atomic_exchange(&log_running, false)) {
+        return;
+    }
+
+    // the writer drains whatever is left before it stops
+    pthread_join(log_thread, 0);
+
+    pthread_mutex_lock(&log_drain_mutex);
+    if(log_file) {
+        fclose(log_file);
+        log_file = 0;
+    }
+    pthread_mutex_unlock(&log_drain_mutex);
+}
+
+void log_write(int level, const char *file, int line, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+
+    log_ring_t *ring = atomic_load_explicit(&log_running, memory_order_acquire) ? log_ring_get() : 0;
+    if(ring == 0) {
+        log_record_t record;
+        log_format(&record, level, file, line, format, args);
+        va_end(args);
+
+        FILE *f = 0;
+        if(record.to_file && __log_file) {
+            f = fopen(__log_file, "a");
+        }
+        log_emit(&record, f);
+        if(f) {
+            fclose(f);
+        }
+        return;
+    }
+
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if(head - tail >= LOG_RING_SIZE) {
+        va_end(args);
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    log_format(&ring->records[head & (LOG_RING_SIZE - 1)], level, file, line, format, args);
+    va_end(args);
+
+    // seq_cst on both sides: either the writer's final pass sees this record, or this sees the writer stopping
+    atomic_store(&ring->head, head + 1);
+    if(!atomic_load(&log_running)) {
+        log_drain_late();
+    }
+}
+
+unsigned long int log_dropped(void) {
+    return atomic_load(&log_dropped_total);
+}
+
+// lets a line through unless the site is ahead of its rate by more than its burst
+int log_ratelimit(log_ratelimit_t *ratelimit, unsigned long int *suppressed) {
+    long int now = get_monotonic_microseconds();
+
+    long int tat = atomic_load_explicit(&ratelimit->tat, memory_order_relaxed);
+    do {
+        if(tat - ratelimit->tolerance > now) {
+            atomic_fetch_add_explicit(&ratelimit->suppressed, 1, memory_order_relaxed);
+            return 0;
+        }
+    } while(!atomic_compare_exchange_weak_explicit(&ratelimit->tat, &tat, ((tat > now) ? tat : now) + ratelimit->interval, memory_order_relaxed, memory_order_relaxed));
+
+    *suppressed = atomic_exchange_explicit(&ratelimit->suppressed, 0, memory_order_relaxed);
+    return 1;
+}
+
+static void *log_thread_routine(void *arg) {
+    (void)arg;
+    long int idle = 0;
+
+    while(atomic_load(&log_running)) {
+        pthread_mutex_lock(&log_drain_mutex);
+        int written = log_drain(log_file);
+        pthread_mutex_unlock(&log_drain_mutex);
+        if(written != 0) {
+            idle = 0;
+            continue;
+        }
+
+        // back off up to LOG_IDLE_SLEEP_MAX while quiet, producers never wait on the writer
+        if(idle < LOG_IDLE_SLEEP_MAX) {
+            idle++;
+        }
+        struct timespec ts = {
+            .tv_sec = 0,
+            .tv_nsec = idle * 1000000L,
+        };
+        nanosleep(&ts, 0);
+    }
+
+    pthread_mutex_lock(&log_drain_mutex);
+    while(log_drain(log_file) != 0);
+    pthread_mutex_unlock(&log_drain_mutex);
+
+    return 0;
+}
+
+// writes out every ring once, returns the number of records written; log_drain_mutex held
+static int log_drain(FILE *file) {
+    int written = 0;
+
+    for(log_ring_t *ring = atomic_load(&log_rings); ring; ring = ring->next) {
+        unsigned long int dropped = atomic_exchange_explicit(&ring->dropped, 0, memory_order_relaxed);
+        if(dropped) {
+            atomic_fetch_add(&log_dropped_total, dropped);
+
+            log_record_t record = {
+                .file = __FILE__,
+                .line = __LINE__,
+                .level = LOG_LEVEL_ERROR,
+                .to_file = true,
+            };
+            record.timestamp = timestamp_now_us();
+            snprintf(record.message, sizeof(record.message), "%lu log messages dropped, the ring of a thread was full", dropped);
+            log_emit(&record, file);
+            written++;
+        }
+
+        uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        while(tail != head) {
+            log_emit(&ring->records[tail & (LOG_RING_SIZE - 1)], file);
+            tail++;
+            written++;
+        }
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    }
+
+    if(written) {
+        fflush(stdout);
+        if(file) {
+            fflush(file);
+        }
+    }
+
+    return written;
+}
+
+// a line published after the writer's final pass is written out by its own thread, like the synchronous path
+static void log_drain_late(void) {
+    pthread_mutex_lock(&log_drain_mutex);
+    FILE *f = log_file;
+    if((f == 0) && __log_file) {
+        f = fopen(__log_file, "a");
+    }
+    log_drain(f);
+    if(f && (f != log_file)) {
+        fclose(f);
+    }
+    pthread_mutex_unlock(&log_drain_mutex);
+}
+
+// the prefixes are the same as they always were, only built here instead of at the call site
+static void log_emit(const log_record_t *record, FILE *file) {
+    time_t sec = record->timestamp / 1000000;
+    int msec = (record->timestamp / 1000) % 1000;
+
+    char ctime[TIMESTAMP_SIZE];
+    timestamp_format_human(ctime, record->timestamp);
+
+    if(record->level == LOG_LEVEL_ERROR) {
+        fprintf(stderr, "\033[1;31m[%s.%03d/err][%-20s:%4d]\033[0m %s\n", ctime, msec, record->file, record->line, record->message);
+    }
+    else {
+        fprintf(stdout, "\033[1m[%s.%03d/log][%-20s:%4d]\033[0m %s\n", ctime, msec, record->file, record->line, record->message);
+    }
+
+    if(file && record->to_file) {
+        fprintf(file, "[%lu.%03d/%s][%-20s:%4d] %s\n", (unsigned long int)sec, msec, (record->level == LOG_LEVEL_ERROR) ? "err" : "log", record->file, record->line, record->message);
+    }
+}
+
+// the only work left on the calling thread
+static void log_format(log_record_t *record, int level, const char *file, int line, const char *format, va_list args) {
+    record->timestamp = timestamp_now_us();
+    record->file = file;
+    record->line = line;
+    record->level = level;
+    record->to_file = (level == LOG_LEVEL_ERROR) || (log_level > 2);
+
+    int len = vsnprintf(record->message, sizeof(record->message), format, args);
+    if(len >= (int)sizeof(record->message)) {
+        memcpy(&record->message[sizeof(record->message) - 4], "...", 4);
+    }
+}
+
+// rings live as long as the process, a thread may still be logging while the backend stops
+static log_ring_t *log_ring_get(void) {
+    if(log_thread_ring) {
+        return log_thread_ring;
+    }
+
+    log_ring_t *ring = (log_ring_t *)calloc(1, sizeof(log_ring_t));
+    if(ring == 0) {
+        return 0;
+    }
+
+    ring->next = atomic_load(&log_rings);
+    while(!atomic_compare_exchange_weak(&log_rings, &ring->next, ring));
+
+    log_thread_ring = ring;
+
+    return ring;
+}
@@ -38,67 +38,102 @@
     #error "LOG_START_MESSAGE should be defined"
 #endif
 
-#define __log_init()
-#define __log_log(sec, usec, the_file, format, ...)
-#define __log_error(sec, usec, the_file, format, ...)
 #if defined(LOG_FILE)
-    #undef __log_init
-    #undef __log_log
-    #undef __log_error
-    
-    #define __log_init() { \
-        FILE *f = fopen(LOG_FILE, LOG_MODE); \
-        fclose(f); \
-    }
+    #define __log_file      LOG_FILE
+#else
+    #define __log_file      0
+#endif
 
-    #define __log_log(sec, usec, the_file, format, ...) { \
-        FILE *f = fopen(LOG_FILE, "a"); \
-        fprintf(f, "[%lu.%03d/log][%-20s:%4d] ", sec, usec, the_file, __LINE__); \
-        fprintf(f, format, ##__VA_ARGS__); \
-        fprintf(f, "\n"); \
-        fclose(f); \
-    }
+/**
+ * asynchronous backend, see log.c
+ *   the calling thread only takes a timestamp and formats the message into its own ring,
+ *   the prefixes, the console and the file (kept open) are all handled by a writer thread
+ *   before log_init() and after log_free() lines are written out synchronously
+*/
+#define LOG_LEVEL_LOG       0
+#define LOG_LEVEL_ERROR     1
 
-    #define __log_error(sec, usec, the_file, format, ...) { \
-        FILE *f = fopen(LOG_FILE, "a"); \
-        fprintf(f, "[%lu.%03d/err][%-20s:%4d] ", sec, usec, the_file, __LINE__); \
-        fprintf(f, format, ##__VA_ARGS__); \
-        fprintf(f, "\n"); \
-        fclose(f); \
-    }
+// log_level a site needs, LOG_FILE also gets every line from log_level 3 on
+#define LOG_VERBOSITY_INFO  1       // log()
+#define LOG_VERBOSITY_DEBUG 2       // log_debug()
+#define LOG_VERBOSITY_TRACE 3       // log_trace(), per leaf / per message dumps
+
+// sites above it are compiled out together with their arguments, ./build.sh --release sets it to info
+#if !defined(LOG_MAX_VERBOSITY)
+    #define LOG_MAX_VERBOSITY   LOG_VERBOSITY_TRACE
 #endif
 
+/**
+ * per site rate limit, a GCRA token bucket: per_second on average, bursts of up to burst lines
+ *   the count of lines held back is logged from the same site ahead of the next one let through
+*/
+typedef struct log_ratelimit {
+    _Atomic long int tat;           // theoretical arrival time, monotonic us
+    _Atomic unsigned long int suppressed;
+    long int interval;
+    long int tolerance;
+} log_ratelimit_t;
+
+#define LOG_RATELIMIT_INIT(per_second, burst)   { 0, 0, (long int)(1000000.0 / (per_second)), (long int)(((burst) - 1) * (1000000.0 / (per_second))) }
+
+void log_backend_init(const char *file, const char *mode);
+void log_backend_free(void);
+void log_write(int level, const char *file, int line, const char *format, ...) __attribute__((format(printf, 4, 5)));
+unsigned long int log_dropped(void);
+int log_ratelimit(log_ratelimit_t *ratelimit, unsigned long int *suppressed);
+
 #if defined(LOG_ENABLE)
     #define log_init() { \
-        __log_init(); \
+        log_backend_init(__log_file, LOG_MODE); \
         log(LOG_START_MESSAGE); \
     }
 
+    #define log_free() { \
+        log_backend_free(); \
+    }
+
     #define log_error(format, ...) { \
-        long sec = get_microseconds_since_epoch(); int usec = (sec / 1000 % 1000); sec /= 1000000;\
-        char ctime[128]; if(put_human_timestamp(ctime) != 0) sprintf(ctime, "%ld", sec);\
-        char *the_file = __FILE__;\
-        fprintf(stderr, "\033[1;31m[%s.%03d/err][%-20s:%4d]\033[0m ", ctime, usec, the_file, __LINE__); \
-        fprintf(stderr, format, ##__VA_ARGS__); \
-        fprintf(stderr, "\n"); \
-        __log_error(sec, usec, the_file, format, ##__VA_ARGS__) \
+        log_write(LOG_LEVEL_ERROR, __FILE__, __LINE__, format, ##__VA_ARGS__); \
+    }
+
+    #define log_at(verbosity, format, ...) { \
+        if(((verbosity) <= LOG_MAX_VERBOSITY) && (log_level >= (verbosity))) { \
+            log_write(LOG_LEVEL_LOG, __FILE__, __LINE__, format, ##__VA_ARGS__); \
+        } \
     }
 
-    #define log(format, ...) { \
-        if(log_level > 0) { \
-            long sec = get_microseconds_since_epoch(); int usec = (sec / 1000 % 1000); sec /= 1000000;\
-            char ctime[128]; if(put_human_timestamp(ctime) != 0) sprintf(ctime, "%ld", sec);\
-            char *the_file = __FILE__;\
-            fprintf(stdout, "\033[1m[%s.%03d/log][%-20s:%4d]\033[0m ", ctime, usec, the_file, __LINE__); \
-            fprintf(stdout, format, ##__VA_ARGS__); \
-            fprintf(stdout, "\n"); \
-            if(log_level > 2) { \
-                __log_log(sec, usec, the_file, format, ##__VA_ARGS__) \
+    #define log(format, ...)        log_at(LOG_VERBOSITY_INFO, format, ##__VA_ARGS__)
+    #define log_debug(format, ...)  log_at(LOG_VERBOSITY_DEBUG, format, ##__VA_ARGS__)
+    #define log_trace(format, ...)  log_at(LOG_VERBOSITY_TRACE, format, ##__VA_ARGS__)
+
+    #define __log_ratelimited(level, per_second, burst, format, ...) { \
+        static log_ratelimit_t __log_ratelimit = LOG_RATELIMIT_INIT(per_second, burst); \
+        unsigned long int __log_suppressed = 0; \
+        if(log_ratelimit(&__log_ratelimit, &__log_suppressed)) { \
+            if(__log_suppressed) { \
+                log_write(level, __FILE__, __LINE__, "%lu messages suppressed", __log_suppressed); \
             } \
+            log_write(level, __FILE__, __LINE__, format, ##__VA_ARGS__); \
         } \
     }
+
+    #define log_ratelimited(per_second, burst, format, ...) { \
+        if(log_level >= LOG_VERBOSITY_INFO) { \
+            __log_ratelimited(LOG_LEVEL_LOG, per_second, burst, format, ##__VA_ARGS__); \
+        } \
+    }
+
+    #define log_error_ratelimited(per_second, burst, format, ...) { \
+        __log_ratelimited(LOG_LEVEL_ERROR, per_second, burst, format, ##__VA_ARGS__); \
+    }
 #else
     #define log_init()
+    #define log_free()
     #define log_error(format, args...)
+    #define log_at(verbosity, format, args...)
     #define log(format, args...)
+    #define log_debug(format, args...)
+    #define log_trace(format, args...)
+    #define log_ratelimited(per_second, burst, format, args...)
+    #define log_error_ratelimited(per_second, burst, format, args...)
 #endif
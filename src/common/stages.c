@@ -0,0 +1,269 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+#define _GNU_SOURCE
+#include "stages.h"
+#include "histogram.h"
+#include "log.h"
+#include "utils.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define STAGES_JSON_SIZE    4096
+
+typedef struct stages_stage {
+    histogram_t window;             // since the last log line
+    histogram_t total;              // since start, without the window
+} stages_stage_t;
+
+static const char *stages_names[STAGES_COUNT] = {
+#define STAGE_NAME(stage, name) [stage] = name,
+    STAGES(STAGE_NAME)
+#undef STAGE_NAME
+};
+
+static stages_stage_t stages[STAGES_COUNT];
+static unsigned long int stages_overruns = 0;
+static unsigned long int stages_window_overruns = 0;
+static pthread_mutex_t stages_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static long int stages_budget = 0;          // us, 0 disables the overrun count
+static long int stages_log_interval = 0;    // us, 0 disables the log lines
+static long int stages_log_next = 0;
+static long int stages_started = 0;
+
+static int stages_socket = -1;
+static char *stages_socket_path = 0;
+static pthread_t stages_thread;
+
+static void *stages_thread_routine(void *arg);
+static int stages_render(char *buffer, int size);
+
+int stages_init(const config_t *config) {
+    if(config == 0) {
+        log_error("config is null");
+        goto failed;
+    }
+
+    for(int i = 0; i < STAGES_COUNT; i++) {
+        histogram_reset(&stages[i].window);
+        histogram_reset(&stages[i].total);
+    }
+    stages_overruns = 0;
+    stages_window_overruns = 0;
+
+    stages_budget = config->stages.budget * 1000L;
+    stages_log_interval = config->stages.log_interval * 1000000L;
+    stages_started = get_monotonic_microseconds();
+    stages_log_next = stages_started + stages_log_interval;
+
+    if(config->stages.socket) {
+        struct sockaddr_un address = {
+            .sun_family = AF_UNIX,
+        };
+        if(strlen(config->stages.socket) >= sizeof(address.sun_path)) {
+            log_error("stages socket path too long: %s", config->stages.socket);
+            goto failed;
+        }
+        strcpy(address.sun_path, config->stages.socket);
+
+        stages_socket_path = strdup(config->stages.socket);
+        if(stages_socket_path == 0) {
+            log_error("strdup failed");
+            goto failed;
+        }
+
+        // a socket left behind by an earlier run
+        unlink(stages_socket_path);
+
+        stages_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(stages_socket < 0) {
+            log_error("socket() failed: %s", strerror(errno));
+            goto failed;
+        }
+
+        if((bind(stages_socket, (struct sockaddr *)&address, sizeof(address)) != 0) || (listen(stages_socket, 4) != 0)) {
+            log_error("unable to listen on %s: %s", stages_socket_path, strerror(errno));
+            goto failed;
+        }
+
+        if(pthread_create(&stages_thread, 0, stages_thread_routine, 0) != 0) {
+            log_error("pthread_create() failed");
+            goto failed;
+        }
+    }
+
+    return 0;
+
+failed:
+    if(stages_socket >= 0) {
+        close(stages_socket);
+        stages_socket = -1;
+    }
+    free(stages_socket_path);
+    stages_socket_path = 0;
+
+    return 1;
+}
+
+void stages_free(void) {
+    if(stages_socket >= 0) {
+        // wakes the query thread out of accept()
+        shutdown(stages_socket, SHUT_RDWR);
+        pthread_join(stages_thread, 0);
+        close(stages_socket);
+        stages_socket = -1;
+
+        unlink(stages_socket_path);
+    }
+
+    free(stages_socket_path);
+    stages_socket_path = 0;
+}
+
+void stages_loop(void) {
+    if(stages_log_interval == 0) {
+        return;
+    }
+
+    long int now = get_monotonic_microseconds();
+    if(now < stages_log_next) {
+        return;
+    }
+    stages_log_next = now + stages_log_interval;
+
+    pthread_mutex_lock(&stages_mutex);
+    for(int i = 0; i < STAGES_COUNT; i++) {
+        histogram_t *window = &stages[i].window;
+        if(window->count) {
+            log("stage %s: count %lu, mean %lu us, p50 %lu us, p99 %lu us, max %lu us", stages_names[i],
+                (unsigned long int)window->count, (unsigned long int)(window->sum / window->count),
+                (unsigned long int)histogram_percentile(window, 50), (unsigned long int)histogram_percentile(window, 99), (unsigned long int)window->max);
+        }
+
+        histogram_merge(&stages[i].total, window);
+        histogram_reset(window);
+    }
+
+    if(stages_window_overruns) {
+        log("stage tick: %lu overruns of the %ld ms budget", stages_window_overruns, stages_budget / 1000);
+    }
+    stages_window_overruns = 0;
+    pthread_mutex_unlock(&stages_mutex);
+}
+
+long int stages_start(void) {
+    return get_monotonic_microseconds();
+}
+
+void stages_record(stage_t stage, long int start) {
+    long int elapsed = get_monotonic_microseconds() - start;
+
+    pthread_mutex_lock(&stages_mutex);
+    histogram_record(&stages[stage].window, (elapsed > 0) ? (uint64_t)elapsed : 0);
+    pthread_mutex_unlock(&stages_mutex);
+}
+
+void stages_tick(long int start) {
+    long int elapsed = get_monotonic_microseconds() - start;
+
+    pthread_mutex_lock(&stages_mutex);
+    histogram_record(&stages[STAGE_TICK].window, (elapsed > 0) ? (uint64_t)elapsed : 0);
+    bool overrun = (stages_budget > 0) && (elapsed > stages_budget);
+    if(overrun) {
+        stages_overruns++;
+        stages_window_overruns++;
+    }
+    pthread_mutex_unlock(&stages_mutex);
+
+    if(overrun) {
+        log_error_ratelimited(1.0 / 60, 1, "tick took %ld ms, over its %ld ms budget", elapsed / 1000, stages_budget / 1000);
+    }
+}
+
+// one JSON snapshot per connection, then the connection is closed
+static void *stages_thread_routine(void *arg) {
+    (void)arg;
+    char buffer[STAGES_JSON_SIZE];
+
+    while(1) {
+        int client = accept4(stages_socket, 0, 0, SOCK_CLOEXEC);
+        if(client < 0) {
+            if(errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            // shut down by stages_free()
+            break;
+        }
+
+        int len = stages_render(buffer, sizeof(buffer));
+        int sent = 0;
+        while(sent < len) {
+            ssize_t rc = send(client, buffer + sent, len - sent, MSG_NOSIGNAL);
+            if(rc <= 0) {
+                break;
+            }
+            sent += rc;
+        }
+        close(client);
+    }
+
+    return 0;
+}
+
+static int stages_render(char *buffer, int size) {
+    histogram_t histogram;
+    int len = 0;
+
+    pthread_mutex_lock(&stages_mutex);
+    len += snprintf(buffer + len, size - len, "{\"uptime\":%ld,\"budget-ms\":%ld,\"overruns\":%lu,\"stages\":{",
+        (get_monotonic_microseconds() - stages_started) / 1000000, stages_budget / 1000, stages_overruns);
+    for(int i = 0; (i < STAGES_COUNT) && (len < size); i++) {
+        memcpy(&histogram, &stages[i].total, sizeof(histogram_t));
+        histogram_merge(&histogram, &stages[i].window);
+
+        len += snprintf(buffer + len, size - len, "%s\"%s\":{\"count\":%lu,\"mean-us\":%lu,\"p50-us\":%lu,\"p90-us\":%lu,\"p99-us\":%lu,\"max-us\":%lu}",
+            i ? "," : "", stages_names[i], (unsigned long int)histogram.count, (unsigned long int)(histogram.count ? histogram.sum / histogram.count : 0),
+            (unsigned long int)histogram_percentile(&histogram, 50), (unsigned long int)histogram_percentile(&histogram, 90),
+            (unsigned long int)histogram_percentile(&histogram, 99), (unsigned long int)histogram.max);
+    }
+    pthread_mutex_unlock(&stages_mutex);
+
+    if(len < size) {
+        len += snprintf(buffer + len, size - len, "}}\n");
+    }
+    if(len >= size) {
+        log_error("stages snapshot cut short");
+        len = size - 1;
+    }
+
+    return len;
+}
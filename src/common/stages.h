@@ -0,0 +1,63 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+
+#pragma once
+
+#include "config.h"
+
+/**
+ * per stage latency histograms (microseconds, common/histogram.h) and the main loop tick budget
+ *   probes: long int start = stages_start(); ...; stages_record(STAGE_..., start);
+ *   the window since the last log line is logged every log_interval, totals since start are
+ *   served as JSON to whoever connects to the unix socket, e.g. socat - UNIX-CONNECT:<socket>
+*/
+
+// stage, name
+#define STAGES(X) \
+    X(STAGE_TELNET,             "telnet") \
+    X(STAGE_PARSE,              "parse") \
+    X(STAGE_FEED,               "feed") \
+    X(STAGE_SYSREPO_COMMIT,     "sysrepo-commit") \
+    X(STAGE_VES_EXECUTE,        "ves-execute")      /* render and hand-off to the sender */ \
+    X(STAGE_VES_ACK,            "ves-ack")          /* enqueue to collector acknowledgement, sender thread */ \
+    X(STAGE_PM_WRITE,           "pm-write")         /* file write and rename, writer thread */ \
+    X(STAGE_TICK,               "tick")
+
+typedef enum stage {
+#define STAGE_ENUM(stage, name) stage,
+    STAGES(STAGE_ENUM)
+#undef STAGE_ENUM
+
+    STAGES_COUNT,
+} stage_t;
+
+int stages_init(const config_t *config);
+void stages_free(void);
+// logs the window once log_interval has passed, from the main loop
+void stages_loop(void);
+
+long int stages_start(void);
+void stages_record(stage_t stage, long int start);
+// records STAGE_TICK and counts an overrun when it went past the budget
+void stages_tick(long int start);
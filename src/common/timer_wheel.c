@@ -0,0 +1,191 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+#include "timer_wheel.h"
+#include "utils.h"
+
+#define TIMER_WHEEL_LEVEL_BITS      6
+#define TIMER_WHEEL_SLOTS           (1 << TIMER_WHEEL_LEVEL_BITS)
+#define TIMER_WHEEL_SLOT_MASK       (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS          5       // 2^30 ms, about 12 days; longer timers cascade again
+#define TIMER_WHEEL_MAX_DELTA       ((1L << (TIMER_WHEEL_LEVEL_BITS * TIMER_WHEEL_LEVELS)) - 1)
+
+static timer_wheel_timer_t *timer_wheel_slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+static timer_wheel_timer_t *timer_wheel_expired = 0;   // due, waiting for their callback
+static long int timer_wheel_current = 0;                // next tick to be processed, 0 until first use
+static int timer_wheel_count = 0;                       // pending timers still in the slots
+
+static void timer_wheel_link(timer_wheel_timer_t **head, timer_wheel_timer_t *timer);
+static void timer_wheel_unlink(timer_wheel_timer_t *timer);
+static void timer_wheel_insert(timer_wheel_timer_t *timer);
+static int timer_wheel_cascade(int level);
+
+void timer_wheel_timer_init(timer_wheel_timer_t *timer, timer_wheel_callback_t callback, void *arg) {
+    timer->next = 0;
+    timer->pprev = 0;
+    timer->expires = 0;
+    timer->callback = callback;
+    timer->arg = arg;
+}
+
+void timer_wheel_add(timer_wheel_timer_t *timer, long int delay_ms) {
+    if(delay_ms < 0) {
+        delay_ms = 0;
+    }
+
+    timer_wheel_add_at(timer, get_monotonic_milliseconds() + delay_ms);
+}
+
+void timer_wheel_add_at(timer_wheel_timer_t *timer, long int expires) {
+    if(timer_wheel_current == 0) {
+        timer_wheel_current = get_monotonic_milliseconds();
+    }
+
+    timer_wheel_unlink(timer);
+    timer->expires = expires;
+    if(expires < timer_wheel_current) {
+        // its tick has been processed already, the next timer_wheel_run() fires it
+        timer_wheel_link(&timer_wheel_expired, timer);
+    }
+    else {
+        timer_wheel_insert(timer);
+    }
+}
+
+void timer_wheel_cancel(timer_wheel_timer_t *timer) {
+    timer_wheel_unlink(timer);
+}
+
+bool timer_wheel_pending(const timer_wheel_timer_t *timer) {
+    return (timer->pprev != 0);
+}
+
+void timer_wheel_run() {
+    long int now = get_monotonic_milliseconds();
+
+    if(timer_wheel_current == 0) {
+        timer_wheel_current = now;
+    }
+
+    if(timer_wheel_count == 0) {
+        // nothing to cascade, skip the idle ticks
+        if(timer_wheel_current <= now) {
+            timer_wheel_current = now + 1;
+        }
+    }
+
+    while(timer_wheel_current <= now) {
+        int index = timer_wheel_current & TIMER_WHEEL_SLOT_MASK;
+        if(index == 0) {
+            for(int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+                if(timer_wheel_cascade(level) != 0) {
+                    break;
+                }
+            }
+        }
+
+        timer_wheel_timer_t *timer = timer_wheel_slots[0][index];
+        while(timer) {
+            timer_wheel_timer_t *next = timer->next;
+            timer_wheel_unlink(timer);
+            timer_wheel_link(&timer_wheel_expired, timer);
+            timer = next;
+        }
+
+        timer_wheel_current++;
+    }
+
+    // callbacks run one at a time, off every list, so they can re-arm or cancel any timer
+    while(timer_wheel_expired) {
+        timer_wheel_timer_t *timer = timer_wheel_expired;
+        timer_wheel_unlink(timer);
+        timer->callback(timer->arg);
+    }
+}
+
+static void timer_wheel_link(timer_wheel_timer_t **head, timer_wheel_timer_t *timer) {
+    timer->next = *head;
+    if(timer->next) {
+        timer->next->pprev = &timer->next;
+    }
+    timer->pprev = head;
+    *head = timer;
+
+    if(head != &timer_wheel_expired) {
+        timer_wheel_count++;
+    }
+}
+
+static void timer_wheel_unlink(timer_wheel_timer_t *timer) {
+    if(timer->pprev == 0) {
+        return;
+    }
+
+    if(timer->pprev != &timer_wheel_expired) {
+        timer_wheel_count--;
+    }
+
+    *timer->pprev = timer->next;
+    if(timer->next) {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->next = 0;
+    timer->pprev = 0;
+}
+
+// the slot is picked by how far away the expiry is, each level is 64 times coarser than the one below
+static void timer_wheel_insert(timer_wheel_timer_t *timer) {
+    long int expires = timer->expires;
+    if(expires < timer_wheel_current) {
+        expires = timer_wheel_current;
+    }
+
+    long int delta = expires - timer_wheel_current;
+    if(delta > TIMER_WHEEL_MAX_DELTA) {
+        expires = timer_wheel_current + TIMER_WHEEL_MAX_DELTA;
+        delta = TIMER_WHEEL_MAX_DELTA;
+    }
+
+    int level = 0;
+    while((level < TIMER_WHEEL_LEVELS - 1) && (delta >= (1L << (TIMER_WHEEL_LEVEL_BITS * (level + 1))))) {
+        level++;
+    }
+
+    int index = (expires >> (TIMER_WHEEL_LEVEL_BITS * level)) & TIMER_WHEEL_SLOT_MASK;
+    timer_wheel_link(&timer_wheel_slots[level][index], timer);
+}
+
+// redistributes the current slot of a level over the finer ones; returns the slot index so 0 cascades further up
+static int timer_wheel_cascade(int level) {
+    int index = (timer_wheel_current >> (TIMER_WHEEL_LEVEL_BITS * level)) & TIMER_WHEEL_SLOT_MASK;
+
+    timer_wheel_timer_t *timer = timer_wheel_slots[level][index];
+    while(timer) {
+        timer_wheel_timer_t *next = timer->next;
+        timer_wheel_unlink(timer);
+        timer_wheel_insert(timer);
+        timer = next;
+    }
+
+    return index;
+}
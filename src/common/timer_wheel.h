@@ -0,0 +1,53 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+#pragma once
+
+#include <stdbool.h>
+
+/**
+ * hierarchical hashed timing wheel on the monotonic clock, millisecond ticks
+ *   insert and cancel are O(1), expiry is O(1) per tick plus the occasional cascade
+ *   of a coarser slot; timers are owned by the caller and may be re-armed from their callback
+ *   not thread safe: timers are armed, cancelled and run from the main loop only
+*/
+typedef void (*timer_wheel_callback_t)(void *arg);
+
+typedef struct timer_wheel_timer {
+    struct timer_wheel_timer *next;
+    struct timer_wheel_timer **pprev;   // null while not pending
+    long int expires;                   // get_monotonic_milliseconds()
+    timer_wheel_callback_t callback;
+    void *arg;
+} timer_wheel_timer_t;
+
+void timer_wheel_timer_init(timer_wheel_timer_t *timer, timer_wheel_callback_t callback, void *arg);
+
+// (re)arms the timer; a pending timer is moved to the new expiry
+void timer_wheel_add(timer_wheel_timer_t *timer, long int delay_ms);
+void timer_wheel_add_at(timer_wheel_timer_t *timer, long int expires);
+void timer_wheel_cancel(timer_wheel_timer_t *timer);
+bool timer_wheel_pending(const timer_wheel_timer_t *timer);
+
+// runs the callbacks of every timer that expired by now, from the calling thread
+void timer_wheel_run();
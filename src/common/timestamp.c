@@ -0,0 +1,80 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+
+#include "timestamp.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define TIMESTAMP_SECONDS_LEN   19  // "2024-01-31T12:34:56"
+
+static __thread long int timestamp_cached_second = -1;
+static __thread char timestamp_cached[TIMESTAMP_SECONDS_LEN + 1];
+
+static const char *timestamp_seconds(long int us);
+
+long int timestamp_now_us(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+int timestamp_format_human(char *buffer, long int us) {
+    memcpy(buffer, timestamp_seconds(us), TIMESTAMP_SECONDS_LEN + 1);
+
+    return TIMESTAMP_SECONDS_LEN;
+}
+
+int timestamp_format_netconf(char *buffer, long int us) {
+    int ms = (us / 1000) % 1000;
+
+    memcpy(buffer, timestamp_seconds(us), TIMESTAMP_SECONDS_LEN);
+    char *p = buffer + TIMESTAMP_SECONDS_LEN;
+    *p++ = '.';
+    *p++ = '0' + ms / 100;
+    *p++ = '0' + ms / 10 % 10;
+    *p++ = '0' + ms % 10;
+    *p++ = 'Z';
+    *p = 0;
+
+    return p - buffer;
+}
+
+// gmtime_r only runs once the second changes
+static const char *timestamp_seconds(long int us) {
+    long int second = us / 1000000;
+
+    if(second != timestamp_cached_second) {
+        time_t t = second;
+        struct tm tm;
+        if((gmtime_r(&t, &tm) == 0) || (strftime(timestamp_cached, sizeof(timestamp_cached), "%Y-%m-%dT%H:%M:%S", &tm) != TIMESTAMP_SECONDS_LEN)) {
+            snprintf(timestamp_cached, sizeof(timestamp_cached), "%019ld", second);
+        }
+        timestamp_cached_second = second;
+    }
+
+    return timestamp_cached;
+}
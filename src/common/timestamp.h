@@ -0,0 +1,40 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+
+#pragma once
+
+/**
+ * wall clock reads and timestamp formatting without allocation
+ *   the clock is read with clock_gettime(CLOCK_REALTIME), served from the vDSO
+ *   every thread caches the formatted seconds of the last second it formatted, timestamps
+ *   within that second only get their sub-second digits written
+*/
+#define TIMESTAMP_SIZE      32      // fits every format below, terminator included
+
+long int timestamp_now_us(void);
+
+// "2024-01-31T12:34:56", returns the length written
+int timestamp_format_human(char *buffer, long int us);
+// "2024-01-31T12:34:56.789Z"
+int timestamp_format_netconf(char *buffer, long int us);
@@ -0,0 +1,144 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+#define _GNU_SOURCE
+#include "trace.h"
+#include "log.h"
+#include "timestamp.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static trace_header_t *trace_header = 0;
+static trace_record_t *trace_records = 0;
+static uint64_t trace_mask = 0;
+static size_t trace_size = 0;
+static atomic_uint_fast16_t trace_threads = 0;
+
+static __thread uint16_t trace_thread = 0;
+
+int trace_init(const char *file, int records) {
+    int fd = -1;
+
+    if(trace_header) {
+        log_error("trace already initialized");
+        goto failed;
+    }
+
+    uint64_t slots = 1024;
+    while(slots < (uint64_t)records) {
+        slots *= 2;
+    }
+
+    // the recording of the run before, most likely the one that crashed, is kept aside
+    char *previous = 0;
+    if(asprintf(&previous, "%s.prev", file) < 0) {
+        log_error("asprintf() failed");
+        goto failed;
+    }
+    if((rename(file, previous) != 0) && (errno != ENOENT)) {
+        log_error("rename(%s, %s) failed: %s", file, previous, strerror(errno));
+    }
+    free(previous);
+
+    trace_size = sizeof(trace_header_t) + slots * sizeof(trace_record_t);
+    fd = open(file, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) {
+        log_error("open(%s) failed", file);
+        goto failed;
+    }
+
+    if(ftruncate(fd, trace_size) != 0) {
+        log_error("ftruncate(%s) failed", file);
+        goto failed;
+    }
+
+    void *map = mmap(0, trace_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(map == MAP_FAILED) {
+        log_error("mmap(%s) failed", file);
+        goto failed;
+    }
+    close(fd);
+
+    trace_records = (trace_record_t *)((char *)map + sizeof(trace_header_t));
+    trace_mask = slots - 1;
+
+    trace_header_t *header = (trace_header_t *)map;
+    header->magic = TRACE_MAGIC;
+    header->version = TRACE_VERSION;
+    header->record_size = sizeof(trace_record_t);
+    header->records = slots;
+    atomic_store(&header->head, 0);
+    trace_header = header;
+
+    log("tracing to %s, last %lu events", file, (unsigned long int)slots);
+
+    return 0;
+
+failed:
+    if(fd >= 0) {
+        close(fd);
+    }
+    trace_size = 0;
+    return 1;
+}
+
+void trace_free(void) {
+    trace_header_t *header = trace_header;
+    if(header == 0) {
+        return;
+    }
+
+    trace_header = 0;
+    trace_records = 0;
+    munmap(header, trace_size);
+    trace_size = 0;
+}
+
+void trace_event(trace_site_t site, int64_t arg0, int64_t arg1) {
+    if(trace_header == 0) {
+        return;
+    }
+
+    if(trace_thread == 0) {
+        trace_thread = atomic_fetch_add(&trace_threads, 1) + 1;
+    }
+
+    uint64_t position = atomic_fetch_add_explicit(&trace_header->head, 1, memory_order_relaxed);
+    trace_record_t *record = &trace_records[position & trace_mask];
+
+    atomic_store_explicit(&record->sequence, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    record->timestamp = timestamp_now_us();
+    record->site = site;
+    record->thread = trace_thread;
+    record->reserved = 0;
+    record->args[0] = arg0;
+    record->args[1] = arg1;
+    atomic_store_explicit(&record->sequence, position + 1, memory_order_release);
+}
@@ -0,0 +1,80 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+/**
+ * binary trace log, a flight recorder for the hot paths
+ *   fixed size records in a memory mapped ring file: writing one is an atomic increment and
+ *   a few stores, no formatting and no system call; the file outlives a crash of the adapter,
+ *   and the next start moves it to <file>.prev before it records again
+ *   render it with tools/trace_decode (./build.sh --tools)
+*/
+#define TRACE_MAGIC         0x4543415254314f41ULL      // "AO1TRACE" on little endian
+#define TRACE_VERSION       1
+
+// site, name, names of its two arguments ("" when unused)
+#define TRACE_SITES(X) \
+    X(TRACE_TELNET_COMMAND,     "telnet-command",   "bytes",        "") \
+    X(TRACE_TELNET_RESPONSE,    "telnet-response",  "bytes",        "us") \
+    X(TRACE_OAI_PARSED,         "oai-parsed",       "bytes",        "us") \
+    X(TRACE_SYSREPO_COMMIT,     "sysrepo-commit",   "operational",  "us") \
+    X(TRACE_VES_SEND,           "ves-send",         "events",       "bytes") \
+    X(TRACE_VES_ACK,            "ves-ack",          "http-code",    "us") \
+    X(TRACE_PM_FLUSH,           "pm-flush",         "samples",      "seconds")
+
+typedef enum trace_site {
+#define TRACE_SITE_ENUM(site, name, arg0, arg1) site,
+    TRACE_SITES(TRACE_SITE_ENUM)
+#undef TRACE_SITE_ENUM
+
+    TRACE_SITES_COUNT,
+} trace_site_t;
+
+// file layout: the header, then records slots; the record at position p is in slot p % records
+typedef struct trace_header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t records;               // slots, a power of two
+    _Atomic uint64_t head;          // positions handed out so far, the oldest one kept is head - records
+} trace_header_t;
+
+typedef struct trace_record {
+    _Atomic uint64_t sequence;      // position + 1, stored last; anything else means a torn or overwritten slot
+    uint64_t timestamp;             // us since epoch
+    uint16_t site;
+    uint16_t thread;                // small per process id, in order of the first event of a thread
+    uint32_t reserved;
+    int64_t args[2];
+} trace_record_t;
+
+int trace_init(const char *file, int records);
+void trace_free(void);
+
+// does nothing unless trace_init() succeeded
+void trace_event(trace_site_t site, int64_t arg0, int64_t arg1);
@@ -24,6 +24,7 @@
 #define _GNU_SOURCE
 
 #include "utils.h"
+#include "timestamp.h"
 #include <time.h>
 #include <sys/time.h>
 #include <sys/stat.h>
@@ -39,82 +40,27 @@ long int get_seconds_since_epoch(void) {
 }
 
 long int get_microseconds_since_epoch(void) {
-    time_t t = time(0);
-    struct timeval tv;
-    long int useconds;
-
-    gettimeofday(&tv, 0);
-    useconds = t*1000000 + tv.tv_usec; //add the microseconds to the seconds
-
-    return useconds;
+    return timestamp_now_us();
 }
 
-char *get_netconf_timestamp(void) {
-    time_t rawtime = time(0);
-    char *nctime = 0;
+// unaffected by wall clock steps, only meaningful as a difference
+long int get_monotonic_milliseconds(void) {
+    struct timespec ts;
 
-    if (rawtime == -1) {
-        log_error("time() failed");
-        return 0;
-    }
-    else {
-        struct tm *ptm = gmtime(&rawtime);
-        if (ptm == 0) {
-            log_error("gmtime failed");
-        }
-        else {
-            asprintf(&nctime, "%04d-%02d-%02dT%02d:%02d:%02d.0Z", ptm->tm_year + 1900, ptm->tm_mon + 1,
-                    ptm->tm_mday, ptm->tm_hour, ptm->tm_min, ptm->tm_sec);
-        }
-    }
-
-    return nctime;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 }
 
-char *get_netconf_timestamp_with_miliseconds(int addSeconds) {
-    time_t rawtime = time(0);
-    char *nctime = 0;
+long int get_monotonic_microseconds(void) {
+    struct timespec ts;
 
-    if (rawtime == -1) {
-        log_error("time() failed");
-        return 0;
-    }
-    else {
-        struct tm *ptm = gmtime(&rawtime);
-        if (ptm == 0) {
-            log_error("gmtime failed");
-        }
-        else {
-            struct timeval tv;
-            ptm->tm_sec += addSeconds;
-            mktime(ptm);
-            gettimeofday(&tv, 0);
-            asprintf(&nctime, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", ptm->tm_year + 1900, ptm->tm_mon + 1,
-                    ptm->tm_mday, ptm->tm_hour, ptm->tm_min, ptm->tm_sec, (int)(tv.tv_usec / 1000));
-        }
-    }
-
-    return nctime;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 }
 
+// nctime has to hold TIMESTAMP_SIZE
 int put_human_timestamp(char *nctime) {
-    time_t rawtime = time(0);
-
-    if (rawtime == -1) {
-        log_error("time() failed");
-        return 1;
-    }
-    else {
-        struct tm *ptm = gmtime(&rawtime);
-        if (ptm == 0) {
-            log_error("gmtime failed");
-            return 1;
-        }
-        else {
-            sprintf(nctime, "%04d-%02d-%02dT%02d:%02d:%02d", ptm->tm_year + 1900, ptm->tm_mon + 1,
-                    ptm->tm_mday, ptm->tm_hour, ptm->tm_min, ptm->tm_sec);
-        }
-    }
+    timestamp_format_human(nctime, timestamp_now_us());
 
     return 0;
 }
@@ -27,6 +27,9 @@
 #include "alarms/alarms.h"
 #include "common/config.h"
 #include "common/log.h"
+#include "common/stages.h"
+#include "common/timer_wheel.h"
+#include "common/trace.h"
 #include "common/utils.h"
 #include "netconf/netconf.h"
 #include "netconf/netconf_data.h"
@@ -74,6 +77,7 @@ int main(int argc, char **argv) {
                 printf("OAI-NETCONF adapter:\n");
                 printf(" --help                         displays help\n");
                 printf(" -c/--config [config_file]      changes default config file path\n");
+                log_free();
                 exit(0);
             }
             else {
@@ -99,6 +103,21 @@ int main(int argc, char **argv) {
 
     config_print(config);
 
+    // diagnostics only, the adapter runs on without them
+    if(config->trace.file) {
+        log("initializing trace...");
+        rc = trace_init(config->trace.file, config->trace.records);
+        if(rc) {
+            log_error("trace init error");
+        }
+    }
+
+    log("initializing stages...");
+    rc = stages_init(config);
+    if(rc) {
+        log_error("stages init error");
+    }
+
     log("initializing telnet client...");
     rc = telnet_local_init();
     if(rc) {
@@ -156,10 +175,13 @@ int main(int argc, char **argv) {
 
     log("starting main loop");
     while(1) {
+        long int tick_start = stages_start();
+
         // check telnet connection
 	//
        if(!telnet_local_is_connected()) {
-            log("telnet connecting...");
+            // once a minute while the gNB is away
+            log_ratelimited(1.0 / 60, 1, "telnet connecting...");
             if(telnet_local_connect(config->telnet.host, config->telnet.port) == 0) {
                 if(telnet_local_wait_for_prompt() != 0) {
                     log_error("telnet prompt failure");
@@ -169,19 +191,26 @@ int main(int argc, char **argv) {
         }
 
         if(telnet_local_is_connected()) do {
+            long int telnet_start = stages_start();
             char *json = telnet_get_o1_stats();
+            stages_record(STAGE_TELNET, telnet_start);
             if(json == 0) {
                 log_error("telnet_get_o1_stats() failed")
                 break;
             }
+            long int parse_start = stages_start();
             oai_data_t *oai_data = oai_data_parse_json(json);
+            stages_record(STAGE_PARSE, parse_start);
+            trace_event(TRACE_OAI_PARSED, strlen(json), stages_start() - parse_start);
             free(json);
             if(oai_data == 0) {
                 log_error("oai_data_parse_json() failed")
                 break;
             }
 
+            long int feed_start = stages_start();
             rc = oai_data_feed(oai_data);
+            stages_record(STAGE_FEED, feed_start);
             if(rc != 0) {
                 log_error("oai_data_feed() error");
                 break;
@@ -192,13 +221,16 @@ int main(int argc, char **argv) {
             }
         } while(0); 
 
-        log("Calling alarms_loop");
-        alarms_loop();
-        log("Calling pm_data_loop");
+        log_debug("Calling timer_wheel_run");
+        timer_wheel_run();
+        log_debug("Calling pm_data_loop");
         pm_data_loop();
-        log("Calling ves_loop");
+        log_debug("Calling ves_loop");
         ves_loop();
 
+        stages_tick(tick_start);
+        stages_loop();
+
         fflush(stdout);
         sleep(1);
     }
@@ -209,12 +241,12 @@ int main(int argc, char **argv) {
     log("freeing alarms...");
     alarms_free();
 
-    log("freeing ves...");
-    ves_free();
-
     log("freeing pm_data...");
     pm_data_free();
 
+    log("freeing ves...");
+    ves_free();
+
     log("freeing netconf_data...");
     netconf_data_free();
 
@@ -224,11 +256,18 @@ int main(int argc, char **argv) {
     log("freeing telnet...");
     telnet_local_free();
 
+    log("freeing stages...");
+    stages_free();
+
+    log("freeing trace...");
+    trace_free();
+
     log("freeing config...");
     config_free(config);
 
     log("OAI-NETCONF clean finish...");
     log("main thread finished [%lu]", pthread_self());
+    log_free();
 
     return 0;
 
@@ -236,5 +275,6 @@ failure:
     config_free(config);
     log_error("exiting with failure");
     log("main thread failed [%lu]", pthread_self());
+    log_free();
     return 1;
 }
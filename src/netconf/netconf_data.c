@@ -25,7 +25,12 @@
 #include "netconf_data.h"
 #include "netconf.h"
 #include "common/log.h"
+#include "common/stages.h"
+#include "common/utils.h"
+#include "common/timestamp.h"
+#include "common/trace.h"
 #include "netconf_session.h"
+#include "alarms/alarms_inventory.h"
 #include "telnet/telnet.h"
 
 #include <sysrepo.h>
@@ -33,6 +38,10 @@
 
 #define MAX_XPATH_ENTRIES 200
 
+// alarmRecords are not kept in the datastore, they are built from the alarm inventory on every get
+#define ALARM_RECORDS_XPATH "/_3gpp-common-managed-element:ManagedElement/_3gpp-common-managed-element:AlarmList/attributes/alarmRecords"
+#define ALARM_NOTIFICATION_MODULE "o1-adapter-alarms"
+
 static char *xpath_running[MAX_XPATH_ENTRIES] = {0};
 static char *values_running[MAX_XPATH_ENTRIES] = {0};
 
@@ -48,16 +57,16 @@ static const char *ENERGY_SAVING_XPATH = 0;
 static const char *ANTENNA_PORTS = 0;
 static const char *NRCELLDU_XPATH = 0;
 static const char *NPNIDENTITYLIST_XPATH = 0;
-static const char *ALARMLIST_XPATH = 0;
-static const char **ALARM_XPATH = 0;
-static const char **ALARM_XPATH_OPER = 0;
 
 static const config_t *netconf_config = 0;
-static const alarm_t **netconf_alarms = 0;
 static sr_subscription_ctx_t *netconf_data_subscription = 0;
+static sr_subscription_ctx_t *netconf_data_alarm_subscription = 0;
 
 static int netconf_data_register_callbacks();
 static int netconf_data_unregister_callbacks();
+static int netconf_data_alarm_records_callback(sr_session_ctx_t *session, uint32_t sub_id, const char *module_name, const char *path, const char *request_xpath, uint32_t request_id, struct lyd_node **parent, void *private_data);
+static int netconf_data_alarm_record(const alarm_t *alarm, void *arg);
+static int netconf_data_apply(sr_session_ctx_t *session);
 static int netconf_data_edit_callback(sr_session_ctx_t *session, uint32_t sub_id, const char *module_name, const char *xpath_running, sr_event_t event, uint32_t request_id, void *private_data);
 static int netconf_data_edit_callback_ietf_es(sr_session_ctx_t *session, uint32_t sub_id, const char *module_name, const char *xpath_running, sr_event_t event, uint32_t request_id, void *private_data);
 
@@ -68,7 +77,6 @@ int netconf_data_init(const config_t *config) {
     }
 
     netconf_config = config;
-    netconf_alarms = 0;
     netconf_data_subscription = 0;
 
     MANAGED_ELEMENT_XPATH = 0;
@@ -78,51 +86,17 @@ int netconf_data_init(const config_t *config) {
     BWP_UPLINK_XPATH = 0;
     NRCELLDU_XPATH = 0;
     NPNIDENTITYLIST_XPATH = 0;
-    ALARM_XPATH = 0;
-    ALARM_XPATH_OPER = 0;
-
-    return 0;
-
-failure:
-    return 1;
-}
-
-int netconf_data_alarms_init(const alarm_t **alarms) {
-    int alarms_no = 0;
-    netconf_alarms = alarms;
-    while(*netconf_alarms) {
-        netconf_alarms++;
-        alarms_no++;
-    }
 
-    netconf_alarms = alarms;
-
-    ALARM_XPATH = (const char**)malloc(sizeof(char *) * alarms_no);
-    if(ALARM_XPATH == 0) {
-        log_error("malloc failed");
-        goto failed;
-   }
-
-    for(int i = 0; i < alarms_no; i++) {
-        ALARM_XPATH[i] = 0;
-    }
-
-    ALARM_XPATH_OPER = (const char**)malloc(sizeof(char *) * alarms_no);
-    if(ALARM_XPATH_OPER == 0) {
-        log_error("malloc failed");
-        goto failed;
-    }
-
-    for(int i = 0; i < alarms_no; i++) {
-        ALARM_XPATH_OPER[i] = 0;
+    // stays for the lifetime of the adapter, unlike the edit callbacks it does not get in the way of our own writes
+    int rc = sr_oper_get_subscribe(netconf_session_operational, "_3gpp-common-managed-element", ALARM_RECORDS_XPATH, netconf_data_alarm_records_callback, NULL, 0, &netconf_data_alarm_subscription);
+    if(rc != SR_ERR_OK) {
+        log_error("sr_oper_get_subscribe() failed");
+        goto failure;
     }
 
     return 0;
-failed:
-    free(ALARM_XPATH);
-    ALARM_XPATH = 0;
-    free(ALARM_XPATH_OPER);
-    ALARM_XPATH_OPER = 0;
+
+failure:
     return 1;
 }
 
@@ -139,12 +113,6 @@ int netconf_data_free() {
         values_operational[i] = 0;
     }
 
-    free(ALARM_XPATH);
-    ALARM_XPATH = 0;
-
-    free(ALARM_XPATH_OPER);
-    ALARM_XPATH_OPER = 0;
-
     MANAGED_ELEMENT_XPATH = 0;
     MANAGED_ELEMENT_XPATH_OPER = 0;
     GNBDU_FUNCTION_XPATH = 0;
@@ -152,10 +120,14 @@ int netconf_data_free() {
     BWP_UPLINK_XPATH = 0;
     NRCELLDU_XPATH = 0;
     NPNIDENTITYLIST_XPATH = 0;
-    ALARMLIST_XPATH = 0;
 
     netconf_data_unregister_callbacks();
 
+    if(netconf_data_alarm_subscription) {
+        sr_unsubscribe(netconf_data_alarm_subscription);
+        netconf_data_alarm_subscription = 0;
+    }
+
     return 0;
 }
 
@@ -175,7 +147,7 @@ int netconf_data_update_full(const oai_data_t *oai) {
             goto failure;
         }
 
-        rc = sr_apply_changes(netconf_session_running, 0);
+        rc = netconf_data_apply(netconf_session_running);
         if(rc != SR_ERR_OK) {
             log_error("sr_apply_changes failed");
             goto failure;
@@ -201,7 +173,6 @@ int netconf_data_update_full(const oai_data_t *oai) {
     BWP_UPLINK_XPATH = 0;
     NRCELLDU_XPATH = 0;
     NPNIDENTITYLIST_XPATH = 0;
-    ALARMLIST_XPATH = 0;
 
     int k_running = 0, k_operational = 0;
 
@@ -1006,7 +977,6 @@ int netconf_data_update_full(const oai_data_t *oai) {
             log_error("asprintf failed");
             goto failure;
         }
-        ALARMLIST_XPATH = xpath_running[k_running];
         k_running++;
 
         asprintf(&xpath_operational[k_operational], "%s/_3gpp-common-managed-element:AlarmList[id='ManagedElement=%s,AlarmList=1']", MANAGED_ELEMENT_XPATH, netconf_config->info.node_id);
@@ -1016,107 +986,10 @@ int netconf_data_update_full(const oai_data_t *oai) {
         }
         k_operational++;
 
-
-        const alarm_t **alarm = netconf_alarms;
-        int i = 0;
-        while(*alarm) {
-            asprintf(&xpath_running[k_running], "%s/attributes/alarmRecords[alarmId='%s-%s']", ALARMLIST_XPATH, (*alarm)->object_instance, (*alarm)->alarm);
-            if(xpath_running[k_running] == 0) {
-                log_error("asprintf failed");
-                goto failure;
-            }
-            ALARM_XPATH[i] = xpath_running[k_running];
-            k_running++;
-
-                alarm_severity_t severity = ALARM_SEVERITY_CLEARED;
-                if((*alarm)->state != ALARM_STATE_CLEARED) {
-                    severity = (*alarm)->severity;
-                }
-
-                values_running[k_running] = strdup(alarm_severity_to_str(severity));
-                if(values_running[k_running] == 0) {
-                    log_error("strdup failed");
-                    goto failure;
-                }
-                asprintf(&xpath_running[k_running], "%s/perceivedSeverity", ALARM_XPATH[i]);
-                if(xpath_running[k_running] == 0) {
-                    log_error("asprintf failed");
-                    goto failure;
-                }
-                k_running++;
-
-            asprintf(&xpath_operational[k_operational], "%s/attributes/alarmRecords[alarmId='%s-%s']", ALARMLIST_XPATH, (*alarm)->object_instance, (*alarm)->alarm);
-            if(xpath_operational[k_operational] == 0) {
-                log_error("asprintf failed");
-                goto failure;
-            }
-            ALARM_XPATH_OPER[i] = xpath_operational[k_operational];
-            k_operational++;
-
-                values_operational[k_operational] = strdup((*alarm)->object_instance);
-                if(values_operational[k_operational] == 0) {
-                    log_error("strdup failed");
-                    goto failure;
-                }
-                asprintf(&xpath_operational[k_operational], "%s/objectInstance", ALARM_XPATH_OPER[i]);
-                if(xpath_operational[k_operational] == 0) {
-                    log_error("asprintf failed");
-                    goto failure;
-                }
-                k_operational++;
-
-                asprintf(&values_operational[k_operational], "0");
-                if(values_operational[k_operational] == 0) {
-                    log_error("asprintf failed");
-                    goto failure;
-                }
-                asprintf(&xpath_operational[k_operational], "%s/notificationId", ALARM_XPATH_OPER[i]);
-                if(xpath_operational[k_operational] == 0) {
-                    log_error("asprintf failed");
-                    goto failure;
-                }
-                k_operational++;
-
-                values_operational[k_operational] = strdup(alarm_type_to_str((*alarm)->type));
-                if(values_operational[k_operational] == 0) {
-                    log_error("asprintf failed");
-                    goto failure;
-                }
-                asprintf(&xpath_operational[k_operational], "%s/alarmType", ALARM_XPATH_OPER[i]);
-                if(xpath_operational[k_operational] == 0) {
-                    log_error("asprintf failed");
-                    goto failure;
-                }
-                k_operational++;
-
-                values_operational[k_operational] = strdup("unset");
-                if(values_operational[k_operational] == 0) {
-                    log_error("asprintf failed");
-                    goto failure;
-                }
-                asprintf(&xpath_operational[k_operational], "%s/probableCause", ALARM_XPATH_OPER[i]);
-                if(xpath_operational[k_operational] == 0) {
-                    log_error("asprintf failed");
-                    goto failure;
-                }
-                k_operational++;
-
-                // alarmChangedTime - not set until data is available
-                k_operational++;
-                // alarmRaisedTime - not set until data is available
-                k_operational++;
-                // alarmClearedTime - not set until data is available
-                k_operational++;
-
-
-            i++;
-            alarm++;
-        }
-
     if(k_running) {
         for (int i = 0; i < k_running; i++) {
             if(xpath_running[i]) {
-                log("[runn] populating %s with %s.. ", xpath_running[i], values_running[i]);
+                log_trace("[runn] populating %s with %s.. ", xpath_running[i], values_running[i]);
                 rc = sr_set_item_str(netconf_session_running, xpath_running[i], values_running[i], 0, 0);
                 if(rc != SR_ERR_OK) {
                     log_error("sr_set_item_str failed");
@@ -1125,7 +998,7 @@ int netconf_data_update_full(const oai_data_t *oai) {
             }
         }
 
-        rc = sr_apply_changes(netconf_session_running, 0);
+        rc = netconf_data_apply(netconf_session_running);
         if(rc != SR_ERR_OK) {
             log_error("sr_apply_changes failed");
             goto failure;
@@ -1135,7 +1008,7 @@ int netconf_data_update_full(const oai_data_t *oai) {
     if(k_operational) {
         for (int i = 0; i < k_operational; i++) {
             if(xpath_operational[i]) {
-                log("[oper] populating %s with %s.. ", xpath_operational[i], values_operational[i]);
+                log_trace("[oper] populating %s with %s.. ", xpath_operational[i], values_operational[i]);
                 rc = sr_set_item_str(netconf_session_operational, xpath_operational[i], values_operational[i], 0, 0);
                 if(rc != SR_ERR_OK) {
                     log_error("sr_set_item_str failed");
@@ -1144,7 +1017,7 @@ int netconf_data_update_full(const oai_data_t *oai) {
             }
         }
 
-        rc = sr_apply_changes(netconf_session_operational, 0);
+        rc = netconf_data_apply(netconf_session_operational);
         if(rc != SR_ERR_OK) {
             log_error("sr_apply_changes failed");
             goto failure;
@@ -1180,7 +1053,6 @@ failure:
     BWP_UPLINK_XPATH = 0;
     NRCELLDU_XPATH = 0;
     NPNIDENTITYLIST_XPATH = 0;
-    ALARMLIST_XPATH = 0;
 
     rc = netconf_data_unregister_callbacks();
     if(rc != 0) {
@@ -1236,7 +1108,7 @@ int netconf_data_update_bwp_dl(const oai_data_t *oai) {
         goto failure;
     }
 
-    rc = sr_apply_changes(netconf_session_running, 0);
+    rc = netconf_data_apply(netconf_session_running);
     if(rc != SR_ERR_OK) {
         log_error("sr_apply_changes failed");
         goto failure;
@@ -1343,7 +1215,7 @@ int netconf_data_update_bwp_dl(const oai_data_t *oai) {
 
     for (int i = start_k_running; i < stop_k_running; i++) {
         if(xpath_running[i]) {
-            log("[runn] populating %s with %s.. ", xpath_running[i], values_running[i]);
+            log_trace("[runn] populating %s with %s.. ", xpath_running[i], values_running[i]);
             rc = sr_set_item_str(netconf_session_running, xpath_running[i], values_running[i], 0, 0);
             if(rc != SR_ERR_OK) {
                 log_error("sr_set_item_str failed");
@@ -1352,7 +1224,7 @@ int netconf_data_update_bwp_dl(const oai_data_t *oai) {
         }
     }
 
-    rc = sr_apply_changes(netconf_session_running, 0);
+    rc = netconf_data_apply(netconf_session_running);
     if(rc != SR_ERR_OK) {
         log_error("sr_apply_changes failed");
         goto failure;
@@ -1421,7 +1293,7 @@ int netconf_data_update_bwp_ul(const oai_data_t *oai) {
         goto failure;
     }
 
-    rc = sr_apply_changes(netconf_session_running, 0);
+    rc = netconf_data_apply(netconf_session_running);
     if(rc != SR_ERR_OK) {
         log_error("sr_apply_changes failed");
         goto failure;
@@ -1528,7 +1400,7 @@ int netconf_data_update_bwp_ul(const oai_data_t *oai) {
 
     for (int i = start_k_running; i < stop_k_running; i++) {
         if(xpath_running[i]) {
-            log("[runn] populating %s with %s.. ", xpath_running[i], values_running[i]);
+            log_trace("[runn] populating %s with %s.. ", xpath_running[i], values_running[i]);
             rc = sr_set_item_str(netconf_session_running, xpath_running[i], values_running[i], 0, 0);
             if(rc != SR_ERR_OK) {
                 log_error("sr_set_item_str failed");
@@ -1537,7 +1409,7 @@ int netconf_data_update_bwp_ul(const oai_data_t *oai) {
         }
     }
 
-    rc = sr_apply_changes(netconf_session_running, 0);
+    rc = netconf_data_apply(netconf_session_running);
     if(rc != SR_ERR_OK) {
         log_error("sr_apply_changes failed");
         goto failure;
@@ -1606,7 +1478,7 @@ int netconf_data_update_nrcelldu(const oai_data_t *oai) {
         goto failure;
     }
 
-    rc = sr_apply_changes(netconf_session_running, 0);
+    rc = netconf_data_apply(netconf_session_running);
     if(rc != SR_ERR_OK) {
         log_error("sr_apply_changes failed");
         goto failure;
@@ -1950,7 +1822,7 @@ int netconf_data_update_nrcelldu(const oai_data_t *oai) {
     
     for (int i = start_k_running; i < stop_k_running; i++) {
         if(xpath_running[i]) {
-            log("[runn] populating %s with %s.. ", xpath_running[i], values_running[i]);
+            log_trace("[runn] populating %s with %s.. ", xpath_running[i], values_running[i]);
             rc = sr_set_item_str(netconf_session_running, xpath_running[i], values_running[i], 0, 0);
             if(rc != SR_ERR_OK) {
                 log_error("sr_set_item_str failed");
@@ -1959,7 +1831,7 @@ int netconf_data_update_nrcelldu(const oai_data_t *oai) {
         }
     }
 
-    rc = sr_apply_changes(netconf_session_running, 0);
+    rc = netconf_data_apply(netconf_session_running);
     if(rc != SR_ERR_OK) {
         log_error("sr_apply_changes failed");
         goto failure;
@@ -1983,306 +1855,186 @@ failure:
     return 1;
 }
 
-int netconf_data_update_alarm(const alarm_t *alarm, int notification_id) {
+// previous is the state reported before this one, it tells a new alarm from a changed one
+int netconf_data_notify_alarm(const alarm_t *alarm, alarm_state_t previous) {
+    struct lyd_node *notif = 0;
+    char *xpath = 0;
     int rc = 0;
-    char *now = get_netconf_timestamp();
-    if(now == 0) {
-        log_error("get_netconf_timestamp() error");
-        goto failure;
-    }
-
-    rc = netconf_data_unregister_callbacks();
-    if(rc != 0) {
-        log_error("netconf_data_unregister_callbacks");
-        goto failure;
-    }
 
     if(alarm == 0) {
         log_error("alarm is null");
         goto failure;
     }
 
-    alarm_t **alarms = (alarm_t **)netconf_alarms;
-    int i = 0;
-    while(*alarms) {
-        if(strcmp(alarm->alarm, (*alarms)->alarm) == 0) {
-            break;
-        }
-
-        alarms++;
-        i++;
+    const char *notification = "notifyChangedAlarm";
+    if(alarm->reported == ALARM_STATE_CLEARED) {
+        notification = "notifyClearedAlarm";
     }
-
-    if(*alarms == 0) {
-        log_error("alarm not found in list");
-        goto failure;
+    else if(previous == ALARM_STATE_CLEARED) {
+        notification = "notifyNewAlarm";
     }
 
-    if(ALARM_XPATH[i] == 0) {
-        log_error("ALARM_XPATH not found");
+    asprintf(&xpath, "/%s:%s", ALARM_NOTIFICATION_MODULE, notification);
+    if(xpath == 0) {
+        log_error("asprintf failed");
         goto failure;
     }
 
-    // find k_running
-    int k_running = 0;
-    while(k_running < MAX_XPATH_ENTRIES) {
-        if(xpath_running[k_running] == ALARM_XPATH[i]) {
-            break;
-        }
-        k_running++;
-    }
-    
-    if(k_running >= MAX_XPATH_ENTRIES) {
-        log_error("ALARM_XPATH[i] not found among running xpaths");
+    rc = lyd_new_path(0, netconf_session_context, xpath, 0, 0, &notif);
+    if(rc != LY_SUCCESS) {
+        log_error("lyd_new_path(%s) failed", xpath);
         goto failure;
     }
 
-    int start_k_running = k_running;
-    int stop_k_running = k_running;
-    while(xpath_running[stop_k_running] && strstr(xpath_running[stop_k_running], ALARM_XPATH[i]) == xpath_running[stop_k_running]) {
-        stop_k_running++;
-    }
+    char alarm_id[256];
+    snprintf(alarm_id, sizeof(alarm_id), "%s-%s", alarm->object_instance, alarm->alarm);
+    char notification_id[16];
+    sprintf(notification_id, "%d", alarm->notification_id);
+    char event_time[TIMESTAMP_SIZE];
+    timestamp_format_netconf(event_time, alarm->changed_time * 1000);
 
-    rc = sr_delete_item(netconf_session_running, ALARM_XPATH[i], SR_EDIT_STRICT);
-    if(rc != SR_ERR_OK) {
-        log_error("sr_delete_item failure");
-        goto failure;
-    }
-
-    rc = sr_apply_changes(netconf_session_running, 0);
-    if(rc != SR_ERR_OK) {
-        log_error("sr_apply_changes failed");
-        goto failure;
-    }
+    const char *leaves[][2] = {
+        {"alarmId", alarm_id},
+        {"objectInstance", alarm->object_instance},
+        {"notificationId", notification_id},
+        {"alarmType", alarm_type_to_str(alarm->type)},
+        {"probableCause", "unset"},
+        {"perceivedSeverity", (alarm->reported == ALARM_STATE_CLEARED) ? alarm_severity_to_str(ALARM_SEVERITY_CLEARED) : alarm_severity_to_str(alarm->reported_severity)},
+        {"eventTime", event_time},
+    };
 
-    for (int i = start_k_running; i < stop_k_running; i++) {
-        free(values_running[i]);
-        free(xpath_running[i]);
-        values_running[i] = 0;
-        xpath_running[i] = 0;
+    for(int i = 0; i < sizeof(leaves) / sizeof(leaves[0]); i++) {
+        rc = lyd_new_path(notif, 0, leaves[i][0], leaves[i][1], 0, 0);
+        if(rc != LY_SUCCESS) {
+            log_error("lyd_new_path(%s) failed", leaves[i][0]);
+            goto failure;
+        }
     }
 
-    asprintf(&xpath_running[k_running], "%s/attributes/alarmRecords[alarmId='%s-%s']", ALARMLIST_XPATH, alarm->object_instance, alarm->alarm);
-    if(xpath_running[k_running] == 0) {
-        log_error("asprintf failed");
+    log("[notif] sending %s for %s", notification, alarm_id);
+    rc = sr_notif_send_tree(netconf_session_running, notif, 0, 0);
+    if(rc != SR_ERR_OK) {
+        log_error("sr_notif_send_tree failed");
         goto failure;
     }
-    ALARM_XPATH[i] = xpath_running[k_running];
-    k_running++;
 
-        alarm_severity_t severity = ALARM_SEVERITY_CLEARED;
-        if(alarm->state != ALARM_STATE_CLEARED) {
-            severity = alarm->severity;
-        }
+    lyd_free_all(notif);
+    free(xpath);
 
-        values_running[k_running] = strdup(alarm_severity_to_str(severity));
-        if(values_running[k_running] == 0) {
-            log_error("strdup failed");
-            goto failure;
-        }
-        asprintf(&xpath_running[k_running], "%s/perceivedSeverity", ALARM_XPATH[i]);
-        if(xpath_running[k_running] == 0) {
-            log_error("asprintf failed");
-            goto failure;
-        }
-        k_running++;
+    return 0;
 
-    stop_k_running = k_running;
+failure:
+    lyd_free_all(notif);
+    free(xpath);
 
+    return 1;
+}
 
+// fills in the alarmRecords below the AlarmList being read
+static int netconf_data_alarm_records_callback(sr_session_ctx_t *session, uint32_t sub_id, const char *module_name, const char *path, const char *request_xpath, uint32_t request_id, struct lyd_node **parent, void *private_data) {
+    (void)session;
+    (void)sub_id;
+    (void)module_name;
+    (void)path;
+    (void)request_xpath;
+    (void)request_id;
+    (void)private_data;
 
-    // find k_operational
-    int k_operational = 0;
-    while(k_operational < MAX_XPATH_ENTRIES) {
-        if(xpath_operational[k_operational] == ALARM_XPATH_OPER[i]) {
-            break;
-        }
-        k_operational++;
-    }
-    
-    if(k_operational >= MAX_XPATH_ENTRIES) {
-        log_error("ALARM_XPATH_OPER[i] not found among operational xpaths");
-        goto failure;
+    if(*parent == 0) {
+        log_error("no AlarmList attributes to fill");
+        return SR_ERR_INTERNAL;
     }
 
-    int start_k_operational = k_operational;
-    int stop_k_operational = k_operational;
-    while(xpath_operational[stop_k_operational] && strstr(xpath_operational[stop_k_operational], ALARM_XPATH_OPER[i]) == xpath_operational[stop_k_operational]) {
-        stop_k_operational++;
+    if(alarms_inventory_foreach(netconf_data_alarm_record, *parent) != 0) {
+        log_error("netconf_data_alarm_record failed");
+        return SR_ERR_INTERNAL;
     }
 
-    for (int i = start_k_operational; i < stop_k_operational; i++) {
-        free(values_operational[i]);
-        free(xpath_operational[i]);
-        values_operational[i] = 0;
-        xpath_operational[i] = 0;
+    return SR_ERR_OK;
+}
+
+// per-UE alarms drop out once cleared, thousands of them would pile up
+static int netconf_data_alarm_record(const alarm_t *alarm, void *arg) {
+    struct lyd_node *parent = (struct lyd_node *)arg;
+    char *xpath = 0;
+    char *item = 0;
+
+    if(alarm->transient && (alarm->reported == ALARM_STATE_CLEARED)) {
+        return 0;
     }
 
-    asprintf(&xpath_operational[k_operational], "%s/attributes/alarmRecords[alarmId='%s-%s']", ALARMLIST_XPATH, alarm->object_instance, alarm->alarm);
-    if(xpath_operational[k_operational] == 0) {
+    asprintf(&xpath, "alarmRecords[alarmId='%s-%s']", alarm->object_instance, alarm->alarm);
+    if(xpath == 0) {
         log_error("asprintf failed");
         goto failure;
     }
-    ALARM_XPATH_OPER[i] = xpath_operational[k_operational];
-    k_operational++;
 
-        values_operational[k_operational] = strdup(alarm->object_instance);
-        if(values_operational[k_operational] == 0) {
-            log_error("strdup failed");
-            goto failure;
-        }
-        asprintf(&xpath_operational[k_operational], "%s/objectInstance", ALARM_XPATH_OPER[i]);
-        if(xpath_operational[k_operational] == 0) {
-            log_error("asprintf failed");
-            goto failure;
-        }
-        k_operational++;
+    alarm_severity_t severity = ALARM_SEVERITY_CLEARED;
+    if(alarm->reported != ALARM_STATE_CLEARED) {
+        severity = alarm->reported_severity;
+    }
 
-        asprintf(&values_operational[k_operational], "%d", notification_id);
-        if(values_operational[k_operational] == 0) {
-            log_error("asprintf failed");
-            goto failure;
-        }
-        asprintf(&xpath_operational[k_operational], "%s/notificationId", ALARM_XPATH_OPER[i]);
-        if(xpath_operational[k_operational] == 0) {
-            log_error("asprintf failed");
-            goto failure;
-        }
-        k_operational++;
+    char notification_id[16];
+    sprintf(notification_id, "%d", alarm->notification_id);
+    char changed_time[TIMESTAMP_SIZE];
+    timestamp_format_netconf(changed_time, alarm->changed_time * 1000);
+    char raised_time[TIMESTAMP_SIZE];
+    timestamp_format_netconf(raised_time, alarm->raised_time * 1000);
+    char cleared_time[TIMESTAMP_SIZE];
+    timestamp_format_netconf(cleared_time, alarm->cleared_time * 1000);
 
-        values_operational[k_operational] = strdup(alarm_type_to_str(alarm->type));
-        if(values_operational[k_operational] == 0) {
-            log_error("asprintf failed");
-            goto failure;
-        }
-        asprintf(&xpath_operational[k_operational], "%s/alarmType", ALARM_XPATH_OPER[i]);
-        if(xpath_operational[k_operational] == 0) {
-            log_error("asprintf failed");
-            goto failure;
-        }
-        k_operational++;
+    const char *leaves[][2] = {
+        {"perceivedSeverity", alarm_severity_to_str(severity)},
+        {"objectInstance", alarm->object_instance},
+        {"notificationId", notification_id},
+        {"alarmType", alarm_type_to_str(alarm->type)},
+        {"probableCause", "unset"},
+        {"alarmChangedTime", alarm->changed_time ? changed_time : 0},
+        {"alarmRaisedTime", alarm->raised_time ? raised_time : 0},
+        {"alarmClearedTime", alarm->cleared_time ? cleared_time : 0},
+    };
 
-        values_operational[k_operational] = strdup("unset");
-        if(values_operational[k_operational] == 0) {
-            log_error("asprintf failed");
-            goto failure;
-        }
-        asprintf(&xpath_operational[k_operational], "%s/probableCause", ALARM_XPATH_OPER[i]);
-        if(xpath_operational[k_operational] == 0) {
-            log_error("asprintf failed");
-            goto failure;
+    for(int i = 0; i < sizeof(leaves) / sizeof(leaves[0]); i++) {
+        if(leaves[i][1] == 0) {
+            // not set until the alarm was reported
+            continue;
         }
-        k_operational++;
 
-        // alarmChangedTime - not set until data is available
-        values_operational[k_operational] = strdup(now);
-        if(values_operational[k_operational] == 0) {
-            log_error("asprintf failed");
-            goto failure;
-        }
-        asprintf(&xpath_operational[k_operational], "%s/alarmChangedTime", ALARM_XPATH_OPER[i]);
-        if(xpath_operational[k_operational] == 0) {
+        asprintf(&item, "%s/%s", xpath, leaves[i][0]);
+        if(item == 0) {
             log_error("asprintf failed");
             goto failure;
         }
-        k_operational++;
 
-        if(alarm->state == ALARM_STATE_CLEARED) {
-            // alarmRaisedTime - not set until data is available
-            k_operational++;
-
-            // alarmClearedTime - not set until data is available
-            values_operational[k_operational] = strdup(now);
-            if(values_operational[k_operational] == 0) {
-                log_error("asprintf failed");
-                goto failure;
-            }
-            asprintf(&xpath_operational[k_operational], "%s/alarmClearedTime", ALARM_XPATH_OPER[i]);
-            if(xpath_operational[k_operational] == 0) {
-                log_error("asprintf failed");
-                goto failure;
-            }
-            k_operational++;
-        }
-        else {
-            // alarmRaisedTime - not set until data is available
-            values_operational[k_operational] = strdup(now);
-            if(values_operational[k_operational] == 0) {
-                log_error("asprintf failed");
-                goto failure;
-            }
-            asprintf(&xpath_operational[k_operational], "%s/alarmRaisedTime", ALARM_XPATH_OPER[i]);
-            if(xpath_operational[k_operational] == 0) {
-                log_error("asprintf failed");
-                goto failure;
-            }
-            k_operational++;
-
-            // alarmClearedTime - not set until data is available
-            k_operational++;
-        }
-
-    stop_k_operational = k_operational;
-
-
-
-
-    for (int i = start_k_running; i < stop_k_running; i++) {
-        if(xpath_running[i]) {
-            log("[runn] populating %s with %s.. ", xpath_running[i], values_running[i]);
-            rc = sr_set_item_str(netconf_session_running, xpath_running[i], values_running[i], 0, 0);
-            if(rc != SR_ERR_OK) {
-                log_error("sr_set_item_str failed");
-                goto failure;
-            }
-        }
-    }
-
-    rc = sr_apply_changes(netconf_session_running, 0);
-    if(rc != SR_ERR_OK) {
-        log_error("sr_apply_changes failed");
-        goto failure;
-    }
-
-    for (int i = start_k_operational; i < stop_k_operational; i++) {
-        if(xpath_operational[i]) {
-            log("[oper] populating %s with %s.. ", xpath_operational[i], values_operational[i]);
-            rc = sr_set_item_str(netconf_session_operational, xpath_operational[i], values_operational[i], 0, 0);
-            if(rc != SR_ERR_OK) {
-                log_error("sr_set_item_str failed");
-                goto failure;
-            }
+        if(lyd_new_path(parent, 0, item, leaves[i][1], 0, 0) != LY_SUCCESS) {
+            log_error("lyd_new_path(%s) failed", item);
+            goto failure;
         }
+        free(item);
+        item = 0;
     }
 
-    rc = sr_apply_changes(netconf_session_operational, 0);
-    if(rc != SR_ERR_OK) {
-        log_error("sr_apply_changes failed");
-        goto failure;
-    }
-
-    rc = netconf_data_register_callbacks();
-    if(rc != 0) {
-        log_error("netconf_data_register_callbacks");
-        goto failure;
-    }
-
-    free(now);
+    free(xpath);
 
     return 0;
 
 failure:
-    rc = netconf_data_unregister_callbacks();
-    if(rc != 0) {
-        log_error("netconf_data_unregister_callbacks");
-        goto failure;
-    }
-
-    free(now);
+    free(item);
+    free(xpath);
 
     return 1;
 }
 
+// sr_apply_changes() with its commit time traced
+static int netconf_data_apply(sr_session_ctx_t *session) {
+    long int start = stages_start();
+
+    int rc = sr_apply_changes(session, 0);
+    stages_record(STAGE_SYSREPO_COMMIT, start);
+    trace_event(TRACE_SYSREPO_COMMIT, session == netconf_session_operational, stages_start() - start);
+
+    return rc;
+}
 
 static int netconf_data_register_callbacks() {
     if(MANAGED_ELEMENT_XPATH == 0) {
@@ -2359,11 +2111,11 @@ static int netconf_data_edit_callback_ietf_es(sr_session_ctx_t *session, uint32_
 
         while ((rc = sr_get_change_next(session, it, &oper, &old_value, &new_value)) == SR_ERR_OK) {
             if(oper != SR_OP_MODIFIED) {
-                printf("***oper %d SR_OP_MODIFIED %d old %d new %d \n ", oper, SR_OP_MODIFIED, old_value, new_value);
+                log_debug("oper %d is not SR_OP_MODIFIED (%d)", oper, SR_OP_MODIFIED);
                 invalidEdit = 1;
                 invalidEditReason = strdup("invalid operation (only MODIFY enabled)");
                 goto checkInvalidEdit;
-		printf("****checkInvalidEdit****\n");
+		log_debug("checkInvalidEdit");
             }
 
             if(strstr(new_value->xpath, "power-state")) {
@@ -2392,12 +2144,12 @@ checkInvalidEdit:
         if(invalidEdit) {
             log_error("invalid edit data detected: %s", invalidEditReason);
             free(invalidEditReason);
-            printf("***check failed_validation**\n");
+            log_debug("check failed_validation");
             goto failed_validation;
         }
 
                 // send command
-                printf("******telnet_change_power_state*****\n");
+                log_debug("telnet_change_power_state");
                 int rc = telnet_change_power_state(power_state);
                 if(rc != 0) {
                     log_error("telnet_change_power_state failed");
@@ -2492,11 +2244,11 @@ static int netconf_data_edit_callback(sr_session_ctx_t *session, uint32_t sub_id
 
         while ((rc = sr_get_change_next(session, it, &oper, &old_value, &new_value)) == SR_ERR_OK) {
             if(oper != SR_OP_MODIFIED) {
-                printf("***oper %d SR_OP_MODIFIED %d old %d new %d \n ", oper, SR_OP_MODIFIED, old_value, new_value);
+                log_debug("oper %d is not SR_OP_MODIFIED (%d)", oper, SR_OP_MODIFIED);
                 invalidEdit = 1;
                 invalidEditReason = strdup("invalid operation (only MODIFY enabled)");
                 goto checkInvalidEdit;
-		printf("****checkInvalidEdit****\n");
+		log_debug("checkInvalidEdit");
             }
 
             // here we can develop more complete xpath instead of "bSChannelBwDL" if needed
@@ -2527,20 +2279,20 @@ checkInvalidEdit:
         if(invalidEdit) {
             log_error("invalid edit data detected: %s", invalidEditReason);
             free(invalidEditReason);
-            printf("***check failed_validation**\n");
+            log_debug("check failed_validation");
             goto failed_validation;
         }
 
         if((bSChannelBwDL != -1) || (bSChannelBwUL != -1)) {
             if(bSChannelBwDL != bSChannelBwUL) {
                 log_error("bSChannelBwDL (%d) != bSChannelBwUL (%d)", bSChannelBwDL, bSChannelBwUL);
-                printf("****INVALID_bsChannelBwDLUL****");
+                log_debug("INVALID_bsChannelBwDLUL");
                 goto failed_validation;
             }
             else {
                 // send command
                 int rc = telnet_change_bandwidth(bSChannelBwDL);
-                printf("******telnet_change_bandwidth(bSChannelBwDL)*****");
+                log_debug("telnet_change_bandwidth(bSChannelBwDL)");
                 if(rc != 0) {
                     log_error("telnet_change_bandwidth failed");
                     goto failed_validation;
@@ -27,11 +27,10 @@
 #include "alarms/alarms.h"
 
 int netconf_data_init(const config_t *config);
-int netconf_data_alarms_init(const alarm_t **alarms);
 int netconf_data_free();
 
 int netconf_data_update_full(const oai_data_t *oai);
 int netconf_data_update_bwp_dl(const oai_data_t *oai);
 int netconf_data_update_bwp_ul(const oai_data_t *oai);
 int netconf_data_update_nrcelldu(const oai_data_t *oai);
-int netconf_data_update_alarm(const alarm_t *alarm, int notification_id);
+int netconf_data_notify_alarm(const alarm_t *alarm, alarm_state_t previous);
@@ -214,6 +214,10 @@ int oai_data_feed(const oai_data_t *data) {
         .load = data->additional_data.load,
         .ue_thp_dl_sum = ue_thp_dl,
         .ue_thp_ul_sum = ue_thp_ul,
+        .ues_thp = data->additional_data.ues_thp,
+        .ues_thp_len = data->additional_data.numUes,
+        .sst = data->nrcelldu.sst,
+        .sd = data->nrcelldu.sd,
     };
 
     rc = pm_data_feed(&pm_data);
@@ -222,11 +226,33 @@ int oai_data_feed(const oai_data_t *data) {
         goto failure;
     }
 
+    alarms_ue_data_t *alarms_ues = 0;
+    if(data->additional_data.numUes > 0) {
+        alarms_ues = (alarms_ue_data_t *)calloc(data->additional_data.numUes, sizeof(alarms_ue_data_t));
+        if(alarms_ues == 0) {
+            log_error("calloc failed");
+            goto failure;
+        }
+    }
+    for(int i = 0; i < data->additional_data.numUes; i++) {
+        alarms_ues[i].id = data->additional_data.ues_thp[i].rnti;
+        alarms_ues[i].metrics[ALARMS_METRIC_UE_THP_DL] = data->additional_data.ues_thp[i].dl;
+        alarms_ues[i].metrics[ALARMS_METRIC_UE_THP_UL] = data->additional_data.ues_thp[i].ul;
+    }
+
     alarms_data_t alarms_data = {
-        .load = data->additional_data.load,
+        .metrics = {
+            [ALARMS_METRIC_LOAD] = data->additional_data.load,
+            [ALARMS_METRIC_NUM_UES] = data->additional_data.numUes,
+            [ALARMS_METRIC_UE_THP_DL] = ue_thp_dl,
+            [ALARMS_METRIC_UE_THP_UL] = ue_thp_ul,
+        },
+        .ues = alarms_ues,
+        .ues_len = data->additional_data.numUes,
     };
 
     rc = alarms_data_feed(&alarms_data);
+    free(alarms_ues);
     if(rc) {
         log_error("alarms_data_feed failed");
         goto failure;
@@ -24,8 +24,14 @@
 #define _GNU_SOURCE
 
 #include "pm_data.h"
+#include "pm_data_journal.h"
+#include "pm_data_retention.h"
+#include "pm_data_ue.h"
+#include "pm_data_writer.h"
 #include "common/config.h"
 #include "common/log.h"
+#include "common/timer_wheel.h"
+#include "common/trace.h"
 #include "common/utils.h"
 #include "ves/ves.h"
 
@@ -35,23 +41,22 @@
 
 #define PM_DATA_PATH            "/ftp"
 
-// pm data log rotate command; 1440 min = 24 h rotation
-#define PM_DATA_ROLL_COMMAND    "find "PM_DATA_PATH" -mindepth 1 -mmin +1440 -delete"
-
-static int pm_data_feed_period = 1;
 static int pm_data_feed_log_period = 15*60; // default 900 sec
-static int pm_data_accumulator_size = 1;
 
 static char *ves_template_pm_data = 0;
 
 static pm_data_info_t pm_data_info = {0};
 
-static pm_data_t *pm_data_accumulator = 0;
-static int pm_data_accumulator_len = 0;
-static time_t pm_data_start_time = 0;
-
+// accumulator, period start time and notification id live in the journal
 static const config_t *pm_data_config = 0;
-static int pm_data_notification_id = 1;
+static timer_wheel_timer_t pm_data_period_timer;
+static bool pm_data_period_due = false;         // the period boundary passed, flush with the next samples
+
+// VES measurement streaming keeps its own, shorter lived accumulator in memory
+static pm_data_aggregate_t pm_data_measurement_aggregate = {0};
+static long int pm_data_measurement_start_time = 0;          // microseconds
+static bool pm_data_measurement_enabled = false;
+static timer_wheel_timer_t pm_data_measurement_timer;
 
 typedef struct pm_write_data {
     long int start_time;
@@ -62,29 +67,57 @@ typedef struct pm_write_data {
     int loadAvg;
     long int ue_thp_dl;
     long int ue_thp_ul;
+    const char *additional_meas_values;
 } pm_write_data_t;
 
 static int pm_data_write(pm_write_data_t *data);
+static void pm_data_collect_written();
+static void pm_data_aggregate_add(pm_data_aggregate_t *aggregate, const pm_data_t *pm_data);
+static void pm_data_period_schedule(time_t start_time, time_t now);
+static void pm_data_period_expired(void *arg);
+static void pm_data_measurement_expired(void *arg);
 
 int pm_data_init(const config_t *config) {
+    bool recovered = false;
+
     pm_data_feed_log_period = config->ves.pm_data_interval;
-    pm_data_accumulator_size = pm_data_feed_log_period / pm_data_feed_period + 1;
-    pm_data_accumulator = (pm_data_t *)malloc(sizeof(pm_data_t) * pm_data_accumulator_size);
-    if(pm_data_accumulator == 0) {
-        log_error("malloc failed");
+
+    time_t now = time(0);
+    if(now == -1) {
+        log_error("time failed");
         goto failure;
     }
 
+    pm_data_config = config;
 
-    pm_data_accumulator_len = 0;
-    pm_data_start_time = time(0);
-    if(pm_data_start_time == -1) {
-        log_error("time failed");
+    if(pm_data_journal_init(config->pm_data.journal, &recovered) != 0) {
+        log_error("pm_data_journal_init failed");
         goto failure;
     }
 
-    pm_data_config = config;
-    pm_data_notification_id = 1;
+    const pm_data_journal_state_t *current = pm_data_journal_current();
+    if(recovered && (current->log_period == pm_data_feed_log_period) && (current->start_time > 0) && (current->start_time <= now)) {
+        // a period that already ended is flushed by the next pm_data_loop()
+        log("pm_data resuming period started at %ld with %ld samples, notification id %d", (long)current->start_time, (long)current->aggregate.samples, current->notification_id);
+    }
+    else {
+        pm_data_journal_state_t *state = pm_data_journal_begin();
+        memset(state, 0, sizeof(pm_data_journal_state_t));
+        state->start_time = now;
+        state->notification_id = 1;
+        state->log_period = pm_data_feed_log_period;
+        pm_data_journal_commit();
+    }
+
+    timer_wheel_timer_init(&pm_data_period_timer, pm_data_period_expired, 0);
+    pm_data_period_due = false;
+    pm_data_period_schedule(pm_data_journal_current()->start_time, now);
+
+    // per-UE and per-slice counters are not journaled, a restart loses them for the current period
+    if(pm_data_ue_init(config->pm_data.max_ues) != 0) {
+        log_error("pm_data_ue_init failed");
+        goto failure;
+    }
 
     ves_template_pm_data = file_read_content(config->ves.template.pm_data);
     if(ves_template_pm_data == 0) {
@@ -92,11 +125,33 @@ int pm_data_init(const config_t *config) {
         goto failure;
     }
 
+    if(pm_data_retention_init(PM_DATA_PATH, config->pm_data.retention_max_age, config->pm_data.retention_max_bytes) != 0) {
+        log_error("pm_data_retention_init failed");
+        goto failure;
+    }
+
+    // expire whatever outlived its retention while we were down
+    pm_data_retention_run(now);
+
+    if(pm_data_writer_init(config->pm_data.compression, config->pm_data.compression_level) != 0) {
+        log_error("pm_data_writer_init failed");
+        goto failure;
+    }
+
+    memset(&pm_data_measurement_aggregate, 0, sizeof(pm_data_aggregate_t));
+    timer_wheel_timer_init(&pm_data_measurement_timer, pm_data_measurement_expired, 0);
+    pm_data_measurement_enabled = (config->ves.measurement_interval > 0);
+    if(pm_data_measurement_enabled) {
+        pm_data_measurement_start_time = get_microseconds_since_epoch();
+        timer_wheel_add(&pm_data_measurement_timer, config->ves.measurement_interval * 1000L);
+    }
+
     return 0;
 
 failure:
-    free(pm_data_accumulator);
-    pm_data_accumulator = 0;
+    timer_wheel_cancel(&pm_data_period_timer);
+    pm_data_journal_free();
+    pm_data_ue_free();
 
     free(ves_template_pm_data);
     ves_template_pm_data = 0;
@@ -119,66 +174,59 @@ failure:
 }
 
 int pm_data_free() {
-    free(pm_data_accumulator);
-    pm_data_accumulator = 0;
+    timer_wheel_cancel(&pm_data_period_timer);
+    timer_wheel_cancel(&pm_data_measurement_timer);
+    pm_data_measurement_enabled = false;
+
+    // the files still being written are announced and tracked like any other, ves is freed after pm_data
+    pm_data_writer_flush();
+    pm_data_collect_written();
+    pm_data_writer_free();
+
     free(ves_template_pm_data);
     ves_template_pm_data = 0;
     free(pm_data_info.vendor);
     pm_data_info.vendor = 0;
 
-    pm_data_accumulator_len = 0;
+    pm_data_journal_free();
+    pm_data_retention_free();
+    pm_data_ue_free();
 
     return 0;
 }
 
 void pm_data_loop() {
     time_t timestamp = time(0);
-    
-    log("###Entered pm_data_loop");
-   //log_error("###Entered pm_data_loop");
-
     if(timestamp == -1) {
         return;
     }
-  // log("##### %s", pm_data_info.vendor);
+
     if(!(pm_data_info.vendor)) {
-        log("Returning from pm_data_loop vendor error ");
         log_error("Returning from pm_data_loop vendor error ");
         return;
     }
 
-    log("Calling if pm_data_loop pm_data_accumulator_len %d %ld %ld", pm_data_accumulator_len, 
+    pm_data_collect_written();
+
+    const pm_data_journal_state_t *current = pm_data_journal_current();
+    time_t pm_data_start_time = current->start_time;
+    const pm_data_aggregate_t *aggregate = &current->aggregate;
+
+    log_debug("Calling if pm_data_loop samples %ld %ld %ld", (long)aggregate->samples,
                                                timestamp / pm_data_feed_log_period, pm_data_start_time / pm_data_feed_log_period);
 
 
-    if((pm_data_accumulator_len) && ((timestamp / pm_data_feed_log_period) != (pm_data_start_time / pm_data_feed_log_period))) {
+    // the wall clock check keeps file names on the boundary should it disagree with the monotonic timer
+    if(pm_data_period_due && (aggregate->samples) && ((timestamp / pm_data_feed_log_period) != (pm_data_start_time / pm_data_feed_log_period))) {
         int rc;
         char *filename = 0;
-        char *full_path = 0;
-
-        long int meanActiveUeAccum = 0;
-        int maxActiveUe = 0;
-        int loadAvgAccum = 0;
-        long int ue_thp_dl_accum = 0;
-        long int ue_thp_ul_accum = 0;
-
-   // log("****pm_data_loop if!!!!");
-   // log_error("****pm_data_loop if!!!!");
-
-        for(int i = 0; i < pm_data_accumulator_len; i++) {
-            meanActiveUeAccum += pm_data_accumulator[i].numUes;
-            if(pm_data_accumulator[i].numUes > maxActiveUe) {
-                maxActiveUe = pm_data_accumulator[i].numUes;
-            }
-            loadAvgAccum += pm_data_accumulator[i].load;
-
-            ue_thp_dl_accum += pm_data_accumulator[i].ue_thp_dl_sum;
-            ue_thp_ul_accum += pm_data_accumulator[i].ue_thp_ul_sum;
-        }
-        int meanActiveUe = meanActiveUeAccum / pm_data_accumulator_len;
-        int loadAvg = loadAvgAccum / pm_data_accumulator_len;
-        long int ue_thp_dl = ue_thp_dl_accum / pm_data_accumulator_len;
-        long int ue_thp_ul = ue_thp_ul_accum / pm_data_accumulator_len;
+        char *additional_meas_values = 0;
+
+        int meanActiveUe = aggregate->num_ues_sum / aggregate->samples;
+        int maxActiveUe = aggregate->num_ues_max;
+        int loadAvg = aggregate->load_sum / aggregate->samples;
+        long int ue_thp_dl = aggregate->ue_thp_dl_sum / aggregate->samples;
+        long int ue_thp_ul = aggregate->ue_thp_ul_sum / aggregate->samples;
         
         struct tm *ptm = gmtime(&pm_data_start_time);
         if(ptm == 0) {
@@ -205,21 +253,22 @@ void pm_data_loop() {
             goto failure_loop;
         }
 
-        asprintf(&full_path, "%s/%s", PM_DATA_PATH, filename);
-        if(full_path == 0) {
-            log_error("asprintf error");
+        additional_meas_values = pm_data_ue_render(pm_data_config->info.gnb_du_id, pm_data_config->info.cell_local_id);
+        if(additional_meas_values == 0) {
+            log_error("pm_data_ue_render error");
             goto failure_loop;
         }
 
         pm_write_data_t data = {
             .start_time = pm_data_start_time,
             .end_time = timestamp,
-            .filename = full_path,
+            .filename = filename,
             .meanActiveUe = meanActiveUe,
             .maxActiveUe = maxActiveUe,
             .loadAvg = loadAvg,
             .ue_thp_dl = ue_thp_dl,
             .ue_thp_ul = ue_thp_ul,
+            .additional_meas_values = additional_meas_values,
         };
 
         rc = pm_data_write(&data);
@@ -227,36 +276,21 @@ void pm_data_loop() {
             log_error("pm_data_write error");
             goto failure_loop;
         }
+        trace_event(TRACE_PM_FLUSH, aggregate->samples, timestamp - pm_data_start_time);
         
-        // cleanup
-        pm_data_start_time = timestamp;
-        pm_data_accumulator_len = 0;
-        rc = system(PM_DATA_ROLL_COMMAND);
-        if(rc != 0) {
-            log_error("system error");
-            goto failure_loop;
-        }
+        // cleanup; the file-ready notification follows once the writer is done
+        pm_data_journal_state_t *state = pm_data_journal_begin();
+        state->start_time = timestamp;
+        memset(&state->aggregate, 0, sizeof(pm_data_aggregate_t));
+        pm_data_journal_commit();
+        pm_data_journal_sync();
 
-        // send ves message
-        ves_file_ready_t file_ready = {
-            .file_location = full_path,
-            .file_size = get_file_size(full_path),
-            .notification_id = pm_data_notification_id,
-        };
-	
-	//log("***send ves message %s %d %d", file_ready.file_location, file_ready.file_size, file_ready.notification_id);
-        rc = ves_fileready_execute(&file_ready);
-	log("###Return code: %d\n", rc);
-        if(rc != 0) {
-            log_error("ves_fileready_execute error");
-            goto failure_loop;
-        }
-
-        pm_data_notification_id++;
+        pm_data_period_due = false;
+        pm_data_period_schedule(timestamp, timestamp);
 
 failure_loop:
-        free(full_path);
         free(filename);
+        free(additional_meas_values);
     }
 }
 
@@ -266,12 +300,16 @@ int pm_data_feed(const pm_data_t *pm_data) {
         goto failure;
     }
 
-    memcpy(&pm_data_accumulator[pm_data_accumulator_len], pm_data, sizeof(pm_data_t));
-    pm_data_accumulator_len++;
-    if(pm_data_accumulator_len >= pm_data_accumulator_size) {
-        pm_data_accumulator_len = 0;
+    pm_data_journal_state_t *state = pm_data_journal_begin();
+    pm_data_aggregate_add(&state->aggregate, pm_data);
+    pm_data_journal_commit();
+
+    if(pm_data_measurement_enabled) {
+        pm_data_aggregate_add(&pm_data_measurement_aggregate, pm_data);
     }
 
+    pm_data_ue_feed(pm_data->ues_thp, pm_data->ues_thp_len, pm_data->sst, pm_data->sd);
+
     return 0;
 
 failure:
@@ -280,13 +318,6 @@ failure:
 
 static int pm_data_write(pm_write_data_t *data) {
     char *content = 0;
-    FILE *f = 0;
-
-    f = fopen(data->filename, "w");
-    if(f == 0) {
-        log_error("fopen failed");
-        goto failure;
-    }
 
     content = strdup(ves_template_pm_data);
     if(content == 0) {
@@ -420,24 +451,113 @@ static int pm_data_write(pm_write_data_t *data) {
         goto failure;
     }
 
-    //printf("!!!!In pm_data_write!!!! fie name : %s\n", data->filename);
-   // printf("***** In pm_data_write **** :  %s\n", content);
-
-    fprintf(f, "%s", content);
-    fclose(f);
+    content = str_replace_inplace(content, "@additional-meas-values@", data->additional_meas_values);
+    if(content == 0) {
+        log_error("str_replace_inplace() failed");
+        goto failure;
+    }
 
-    free(content);
+    // the writer takes ownership of content
+    int rc = pm_data_writer_submit(PM_DATA_PATH, data->filename, content);
     content = 0;
+    if(rc != 0) {
+        log_error("pm_data_writer_submit() failed");
+        goto failure;
+    }
 
     return 0;
 
 failure:
-    if(f) {
-        fclose(f);
-    }
-
     free(content);
     content = 0;
 
     return 1;
 }
+
+static void pm_data_collect_written() {
+    pm_data_writer_result_t result;
+    int rc;
+
+    while(pm_data_writer_poll(&result)) {
+        if(result.rc != 0) {
+            log_error("pm_data_writer failed for %s", result.full_path ? result.full_path : "(null)");
+            pm_data_writer_result_free(&result);
+            continue;
+        }
+
+        rc = pm_data_retention_add(result.full_path, result.mtime, result.size);
+        if(rc != 0) {
+            log_error("pm_data_retention_add error");
+        }
+
+        rc = pm_data_retention_run(time(0));
+        if(rc != 0) {
+            log_error("pm_data_retention_run error");
+        }
+
+        // send ves message
+        ves_file_ready_t file_ready = {
+            .file_location = result.full_path,
+            .file_size = result.size,
+            .file_compression = result.compressed ? "gzip" : "no",
+            .notification_id = pm_data_journal_current()->notification_id,
+        };
+
+        rc = ves_fileready_execute(&file_ready);
+        if(rc != 0) {
+            log_error("ves_fileready_execute error");
+        }
+        else {
+            pm_data_journal_begin()->notification_id++;
+            pm_data_journal_commit();
+        }
+
+        pm_data_writer_result_free(&result);
+    }
+}
+
+static void pm_data_aggregate_add(pm_data_aggregate_t *aggregate, const pm_data_t *pm_data) {
+    aggregate->samples++;
+    aggregate->num_ues_sum += pm_data->numUes;
+    if(pm_data->numUes > aggregate->num_ues_max) {
+        aggregate->num_ues_max = pm_data->numUes;
+    }
+    aggregate->load_sum += pm_data->load;
+    aggregate->ue_thp_dl_sum += pm_data->ue_thp_dl_sum;
+    aggregate->ue_thp_ul_sum += pm_data->ue_thp_ul_sum;
+}
+
+// arms the period timer for the first wall clock multiple of the log period after start_time
+static void pm_data_period_schedule(time_t start_time, time_t now) {
+    time_t boundary = (start_time / pm_data_feed_log_period + 1) * pm_data_feed_log_period;
+    timer_wheel_add(&pm_data_period_timer, (boundary - now) * 1000L);
+}
+
+static void pm_data_period_expired(void *arg) {
+    pm_data_period_due = true;
+}
+
+static void pm_data_measurement_expired(void *arg) {
+    timer_wheel_add(&pm_data_measurement_timer, pm_data_config->ves.measurement_interval * 1000L);
+
+    const pm_data_aggregate_t *aggregate = &pm_data_measurement_aggregate;
+    if(aggregate->samples) {
+        ves_measurement_t measurement = {
+            .start_epoch_microsec = pm_data_measurement_start_time,
+            .interval = pm_data_config->ves.measurement_interval,
+            .mean_active_ue = aggregate->num_ues_sum / aggregate->samples,
+            .max_active_ue = aggregate->num_ues_max,
+            .load_avg = aggregate->load_sum / aggregate->samples,
+            .ue_thp_dl = aggregate->ue_thp_dl_sum / aggregate->samples,
+            .ue_thp_ul = aggregate->ue_thp_ul_sum / aggregate->samples,
+        };
+
+        int rc = ves_measurement_execute(&measurement);
+        if(rc != 0) {
+            log_error("ves_measurement_execute error");
+        }
+    }
+
+    memset(&pm_data_measurement_aggregate, 0, sizeof(pm_data_aggregate_t));
+    pm_data_measurement_start_time = get_microseconds_since_epoch();
+}
@@ -24,12 +24,19 @@
 #pragma once
 
 #include "common/config.h"
+#include "oai/oai_data.h"
 
 typedef struct pm_data {
     int numUes;
     int load;
     long int ue_thp_dl_sum;
     long int ue_thp_ul_sum;
+
+    // per-UE throughput of this sample and the cell's slice, for the per-UE / per-slice counters
+    const oai_ues_thp_t *ues_thp;
+    int ues_thp_len;
+    uint32_t sst;
+    uint32_t sd;
 } pm_data_t;
 
 typedef struct pm_data_info {
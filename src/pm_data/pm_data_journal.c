@@ -0,0 +1,140 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+
+#define _GNU_SOURCE
+
+#include "pm_data_journal.h"
+#include "common/log.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PM_DATA_JOURNAL_MAGIC       0x504d4a31  // "PMJ1"
+#define PM_DATA_JOURNAL_VERSION     1
+
+typedef struct pm_data_journal {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    uint32_t active;
+    pm_data_journal_state_t slot[2];
+} pm_data_journal_t;
+
+static pm_data_journal_t *pm_data_journal = 0;
+static bool pm_data_journal_file_backed = false;
+
+int pm_data_journal_init(const char *path, bool *recovered) {
+    int fd = -1;
+
+    *recovered = false;
+    pm_data_journal_file_backed = (path != 0) && (path[0] != 0);
+
+    if(pm_data_journal_file_backed) {
+        fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if(fd == -1) {
+            log_error("open(%s) failed: %s", path, strerror(errno));
+            goto failure;
+        }
+
+        struct stat st;
+        if(fstat(fd, &st) != 0) {
+            log_error("fstat() failed: %s", strerror(errno));
+            goto failure;
+        }
+
+        if((st.st_size != sizeof(pm_data_journal_t)) && (ftruncate(fd, sizeof(pm_data_journal_t)) != 0)) {
+            log_error("ftruncate() failed: %s", strerror(errno));
+            goto failure;
+        }
+
+        pm_data_journal = (pm_data_journal_t *)mmap(0, sizeof(pm_data_journal_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        fd = -1;
+    }
+    else {
+        pm_data_journal = (pm_data_journal_t *)mmap(0, sizeof(pm_data_journal_t), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+
+    if(pm_data_journal == MAP_FAILED) {
+        pm_data_journal = 0;
+        log_error("mmap() failed: %s", strerror(errno));
+        goto failure;
+    }
+
+    if((pm_data_journal->magic == PM_DATA_JOURNAL_MAGIC) && (pm_data_journal->version == PM_DATA_JOURNAL_VERSION) &&
+        (pm_data_journal->size == sizeof(pm_data_journal_t)) && (pm_data_journal->active < 2)) {
+        *recovered = true;
+    }
+    else {
+        memset(pm_data_journal, 0, sizeof(pm_data_journal_t));
+        pm_data_journal->magic = PM_DATA_JOURNAL_MAGIC;
+        pm_data_journal->version = PM_DATA_JOURNAL_VERSION;
+        pm_data_journal->size = sizeof(pm_data_journal_t);
+    }
+
+    return 0;
+
+failure:
+    if(fd != -1) {
+        close(fd);
+    }
+    return 1;
+}
+
+int pm_data_journal_free() {
+    if(pm_data_journal) {
+        pm_data_journal_sync();
+        munmap(pm_data_journal, sizeof(pm_data_journal_t));
+        pm_data_journal = 0;
+    }
+
+    return 0;
+}
+
+const pm_data_journal_state_t *pm_data_journal_current() {
+    return &pm_data_journal->slot[pm_data_journal->active];
+}
+
+pm_data_journal_state_t *pm_data_journal_begin() {
+    uint32_t active = pm_data_journal->active;
+    pm_data_journal_state_t *next = &pm_data_journal->slot[active ^ 1];
+
+    *next = pm_data_journal->slot[active];
+    return next;
+}
+
+void pm_data_journal_commit() {
+    // the slot contents must be stored before the index that publishes them
+    __atomic_store_n(&pm_data_journal->active, pm_data_journal->active ^ 1, __ATOMIC_RELEASE);
+}
+
+void pm_data_journal_sync() {
+    if(pm_data_journal_file_backed && pm_data_journal) {
+        msync(pm_data_journal, sizeof(pm_data_journal_t), MS_ASYNC);
+    }
+}
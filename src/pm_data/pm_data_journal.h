@@ -0,0 +1,66 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * crash-safe PM accumulator journal
+ *   the running aggregates of the current granularity period live in a small
+ *   memory-mapped file holding two slots; updates are done on the inactive
+ *   slot and committed by flipping the active index, so a sample costs a
+ *   couple of cache lines and no syscalls
+ *   with no path the same structure is mapped anonymously (no persistence)
+*/
+
+typedef struct pm_data_aggregate {
+    int64_t samples;
+    int64_t num_ues_sum;
+    int64_t num_ues_max;
+    int64_t load_sum;
+    int64_t ue_thp_dl_sum;
+    int64_t ue_thp_ul_sum;
+} pm_data_aggregate_t;
+
+typedef struct pm_data_journal_state {
+    int64_t start_time;
+    int32_t notification_id;
+    int32_t log_period;
+    pm_data_aggregate_t aggregate;
+} pm_data_journal_state_t;
+
+// returns 0 on success; *recovered tells whether a valid state was found on disk
+int pm_data_journal_init(const char *path, bool *recovered);
+int pm_data_journal_free();
+
+const pm_data_journal_state_t *pm_data_journal_current();
+
+// returns a writable copy of the current state, made visible by pm_data_journal_commit()
+pm_data_journal_state_t *pm_data_journal_begin();
+void pm_data_journal_commit();
+
+// asks the kernel to write the journal back, used at period boundaries
+void pm_data_journal_sync();
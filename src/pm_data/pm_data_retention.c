@@ -0,0 +1,273 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+
+#define _GNU_SOURCE
+
+#include "pm_data_retention.h"
+#include "common/log.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct pm_data_retention_file {
+    char *name;
+    time_t mtime;
+    off_t size;
+} pm_data_retention_file_t;
+
+// files are kept sorted by mtime in [head, len), oldest at head
+static pm_data_retention_file_t *pm_data_retention_files = 0;
+static int pm_data_retention_head = 0;
+static int pm_data_retention_len = 0;
+static int pm_data_retention_capacity = 0;
+static long long pm_data_retention_total_bytes = 0;
+
+static int pm_data_retention_dirfd = -1;
+static int pm_data_retention_max_age = 0;
+static long long pm_data_retention_max_bytes = 0;
+
+static int pm_data_retention_compare(const void *a, const void *b);
+static int pm_data_retention_reserve();
+
+int pm_data_retention_init(const char *path, int max_age, long long max_bytes) {
+    DIR *dir = 0;
+    int fd = -1;
+
+    pm_data_retention_max_age = max_age;
+    pm_data_retention_max_bytes = max_bytes;
+    pm_data_retention_head = 0;
+    pm_data_retention_len = 0;
+    pm_data_retention_total_bytes = 0;
+
+    pm_data_retention_dirfd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(pm_data_retention_dirfd == -1) {
+        log_error("open(%s) failed: %s", path, strerror(errno));
+        goto failure;
+    }
+
+    // fdopendir() takes ownership of the fd, keep our own for unlinkat()
+    fd = dup(pm_data_retention_dirfd);
+    if(fd == -1) {
+        log_error("dup() failed: %s", strerror(errno));
+        goto failure;
+    }
+
+    dir = fdopendir(fd);
+    if(dir == 0) {
+        log_error("fdopendir() failed: %s", strerror(errno));
+        close(fd);
+        goto failure;
+    }
+
+    struct dirent *entry;
+    while((entry = readdir(dir)) != 0) {
+        // skips ".", ".." and in-progress (hidden) files
+        if(entry->d_name[0] == '.') {
+            continue;
+        }
+
+        struct stat st;
+        if(fstatat(pm_data_retention_dirfd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            continue;
+        }
+
+        if(!S_ISREG(st.st_mode)) {
+            continue;
+        }
+
+        if(pm_data_retention_reserve() != 0) {
+            goto failure;
+        }
+
+        pm_data_retention_file_t *file = &pm_data_retention_files[pm_data_retention_len];
+        file->name = strdup(entry->d_name);
+        if(file->name == 0) {
+            log_error("strdup failed");
+            goto failure;
+        }
+        file->mtime = st.st_mtime;
+        file->size = st.st_size;
+        pm_data_retention_len++;
+        pm_data_retention_total_bytes += st.st_size;
+    }
+
+    closedir(dir);
+    dir = 0;
+
+    qsort(pm_data_retention_files, pm_data_retention_len, sizeof(pm_data_retention_file_t), pm_data_retention_compare);
+    log("pm_data_retention indexed %d files (%lld bytes) in %s", pm_data_retention_len, pm_data_retention_total_bytes, path);
+
+    return 0;
+
+failure:
+    if(dir) {
+        closedir(dir);
+    }
+    pm_data_retention_free();
+    return 1;
+}
+
+int pm_data_retention_free() {
+    for(int i = pm_data_retention_head; i < pm_data_retention_len; i++) {
+        free(pm_data_retention_files[i].name);
+    }
+    free(pm_data_retention_files);
+    pm_data_retention_files = 0;
+    pm_data_retention_head = 0;
+    pm_data_retention_len = 0;
+    pm_data_retention_capacity = 0;
+    pm_data_retention_total_bytes = 0;
+
+    if(pm_data_retention_dirfd != -1) {
+        close(pm_data_retention_dirfd);
+        pm_data_retention_dirfd = -1;
+    }
+
+    return 0;
+}
+
+int pm_data_retention_add(const char *filename, time_t mtime, off_t size) {
+    if(filename == 0) {
+        log_error("filename is null");
+        goto failure;
+    }
+
+    // accept both full paths and bare names, the index works relative to the directory
+    const char *name = strrchr(filename, '/');
+    name = name ? name + 1 : filename;
+
+    if(pm_data_retention_reserve() != 0) {
+        goto failure;
+    }
+
+    char *dup_name = strdup(name);
+    if(dup_name == 0) {
+        log_error("strdup failed");
+        goto failure;
+    }
+
+    // files are produced in time order, so this is an append in practice
+    int i = pm_data_retention_len;
+    while((i > pm_data_retention_head) && (pm_data_retention_files[i - 1].mtime > mtime)) {
+        pm_data_retention_files[i] = pm_data_retention_files[i - 1];
+        i--;
+    }
+
+    pm_data_retention_files[i].name = dup_name;
+    pm_data_retention_files[i].mtime = mtime;
+    pm_data_retention_files[i].size = size;
+    pm_data_retention_len++;
+    pm_data_retention_total_bytes += size;
+
+    return 0;
+
+failure:
+    return 1;
+}
+
+int pm_data_retention_run(time_t now) {
+    int removed = 0;
+
+    if(pm_data_retention_dirfd == -1) {
+        log_error("pm_data_retention not initialized");
+        return 1;
+    }
+
+    while(pm_data_retention_head < pm_data_retention_len) {
+        pm_data_retention_file_t *file = &pm_data_retention_files[pm_data_retention_head];
+
+        bool expired = (pm_data_retention_max_age > 0) && (file->mtime + pm_data_retention_max_age < now);
+        // the newest file is never evicted for size, its file-ready is sent after this run
+        bool over_budget = (pm_data_retention_max_bytes > 0) && (pm_data_retention_total_bytes > pm_data_retention_max_bytes) &&
+            (pm_data_retention_head < pm_data_retention_len - 1);
+        if(!expired && !over_budget) {
+            break;
+        }
+
+        if((unlinkat(pm_data_retention_dirfd, file->name, 0) != 0) && (errno != ENOENT)) {
+            log_error("unlinkat(%s) failed: %s", file->name, strerror(errno));
+        }
+
+        pm_data_retention_total_bytes -= file->size;
+        free(file->name);
+        file->name = 0;
+        pm_data_retention_head++;
+        removed++;
+    }
+
+    if(pm_data_retention_head == pm_data_retention_len) {
+        pm_data_retention_head = 0;
+        pm_data_retention_len = 0;
+    }
+
+    if(removed) {
+        log("pm_data_retention removed %d files, %d remaining (%lld bytes)", removed, pm_data_retention_len - pm_data_retention_head, pm_data_retention_total_bytes);
+    }
+
+    return 0;
+}
+
+static int pm_data_retention_compare(const void *a, const void *b) {
+    const pm_data_retention_file_t *fa = (const pm_data_retention_file_t *)a;
+    const pm_data_retention_file_t *fb = (const pm_data_retention_file_t *)b;
+
+    if(fa->mtime < fb->mtime) {
+        return -1;
+    }
+    if(fa->mtime > fb->mtime) {
+        return 1;
+    }
+    return strcmp(fa->name, fb->name);
+}
+
+static int pm_data_retention_reserve() {
+    if(pm_data_retention_len < pm_data_retention_capacity) {
+        return 0;
+    }
+
+    // reuse the space of already expired entries before growing
+    if(pm_data_retention_head > 0) {
+        memmove(pm_data_retention_files, &pm_data_retention_files[pm_data_retention_head], sizeof(pm_data_retention_file_t) * (pm_data_retention_len - pm_data_retention_head));
+        pm_data_retention_len -= pm_data_retention_head;
+        pm_data_retention_head = 0;
+        return 0;
+    }
+
+    int capacity = pm_data_retention_capacity ? pm_data_retention_capacity * 2 : 64;
+    pm_data_retention_file_t *files = (pm_data_retention_file_t *)realloc(pm_data_retention_files, sizeof(pm_data_retention_file_t) * capacity);
+    if(files == 0) {
+        log_error("realloc failed");
+        return 1;
+    }
+
+    pm_data_retention_files = files;
+    pm_data_retention_capacity = capacity;
+    return 0;
+}
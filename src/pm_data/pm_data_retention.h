@@ -0,0 +1,42 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+
+#pragma once
+
+#include <time.h>
+#include <sys/types.h>
+
+/**
+ * in-memory index of the PM files present in the PM data directory
+ *   rebuilt once from a directory scan on init
+ *   files are kept in modification time order, so expiring them is O(expired)
+ *   max_age is in seconds, 0 disables age based retention
+ *   max_bytes is the total size budget, 0 disables size based retention; the newest file is
+ *   always kept, even when it alone exceeds the budget, as its file-ready is still to be sent
+*/
+int pm_data_retention_init(const char *path, int max_age, long long max_bytes);
+int pm_data_retention_free();
+
+int pm_data_retention_add(const char *filename, time_t mtime, off_t size);
+int pm_data_retention_run(time_t now);
@@ -0,0 +1,340 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+
+#define _GNU_SOURCE
+
+#include "pm_data_ue.h"
+#include "common/log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PM_DATA_UE_MAX_SLICES   8
+#define PM_DATA_UE_NONE         -1
+
+typedef struct pm_data_ue_entry {
+    int rnti;
+    uint64_t last_seen;
+
+    int64_t samples;
+    int64_t dl_sum;
+    int64_t ul_sum;
+
+    // LRU list (most recently seen first), doubles as free list via next
+    int prev;
+    int next;
+} pm_data_ue_entry_t;
+
+typedef struct pm_data_slice_entry {
+    uint32_t sst;
+    uint32_t sd;
+
+    int64_t samples;
+    int64_t dl_sum;
+    int64_t ul_sum;
+} pm_data_slice_entry_t;
+
+static int pm_data_ue_max = 0;
+static pm_data_ue_entry_t *pm_data_ue_entries = 0;
+static int *pm_data_ue_table = 0;       // entry index per slot, PM_DATA_UE_NONE when empty
+static uint32_t pm_data_ue_table_mask = 0;
+static int pm_data_ue_lru_head = PM_DATA_UE_NONE;
+static int pm_data_ue_lru_tail = PM_DATA_UE_NONE;
+static int pm_data_ue_free_head = PM_DATA_UE_NONE;
+static uint64_t pm_data_ue_tick = 0;
+static long int pm_data_ue_overflow = 0;
+
+static pm_data_slice_entry_t pm_data_slices[PM_DATA_UE_MAX_SLICES];
+static int pm_data_slices_len = 0;
+
+static uint32_t pm_data_ue_hash(int rnti);
+static uint32_t pm_data_ue_lookup(int rnti);
+static void pm_data_ue_remove(int index);
+static void pm_data_ue_lru_unlink(int index);
+static void pm_data_ue_lru_push_front(int index);
+
+int pm_data_ue_init(int max_ues) {
+    pm_data_ue_max = max_ues;
+    pm_data_ue_lru_head = PM_DATA_UE_NONE;
+    pm_data_ue_lru_tail = PM_DATA_UE_NONE;
+    pm_data_ue_free_head = PM_DATA_UE_NONE;
+    pm_data_ue_tick = 0;
+    pm_data_ue_overflow = 0;
+    pm_data_slices_len = 0;
+
+    if(pm_data_ue_max <= 0) {
+        pm_data_ue_max = 0;
+        return 0;
+    }
+
+    // keep the load factor at or below 50%
+    uint32_t table_size = 4;
+    while(table_size < (uint32_t)pm_data_ue_max * 2) {
+        table_size <<= 1;
+    }
+    pm_data_ue_table_mask = table_size - 1;
+
+    pm_data_ue_entries = (pm_data_ue_entry_t *)malloc(sizeof(pm_data_ue_entry_t) * pm_data_ue_max);
+    pm_data_ue_table = (int *)malloc(sizeof(int) * table_size);
+    if((pm_data_ue_entries == 0) || (pm_data_ue_table == 0)) {
+        log_error("malloc failed");
+        goto failure;
+    }
+
+    for(uint32_t i = 0; i < table_size; i++) {
+        pm_data_ue_table[i] = PM_DATA_UE_NONE;
+    }
+
+    for(int i = pm_data_ue_max - 1; i >= 0; i--) {
+        pm_data_ue_entries[i].next = pm_data_ue_free_head;
+        pm_data_ue_free_head = i;
+    }
+
+    return 0;
+
+failure:
+    pm_data_ue_free();
+    return 1;
+}
+
+void pm_data_ue_free() {
+    free(pm_data_ue_entries);
+    pm_data_ue_entries = 0;
+    free(pm_data_ue_table);
+    pm_data_ue_table = 0;
+    pm_data_ue_max = 0;
+    pm_data_slices_len = 0;
+}
+
+void pm_data_ue_feed(const oai_ues_thp_t *ues, int ues_len, uint32_t sst, uint32_t sd) {
+    int64_t dl_sum = 0;
+    int64_t ul_sum = 0;
+
+    pm_data_ue_tick++;
+
+    for(int i = 0; i < ues_len; i++) {
+        dl_sum += ues[i].dl;
+        ul_sum += ues[i].ul;
+
+        if(pm_data_ue_max == 0) {
+            continue;
+        }
+
+        uint32_t slot = pm_data_ue_lookup(ues[i].rnti);
+        int index = pm_data_ue_table[slot];
+        if(index == PM_DATA_UE_NONE) {
+            if(pm_data_ue_free_head == PM_DATA_UE_NONE) {
+                // only evict UEs which departed, never one present in this sample
+                int victim = pm_data_ue_lru_tail;
+                if(pm_data_ue_entries[victim].last_seen == pm_data_ue_tick) {
+                    pm_data_ue_overflow++;
+                    continue;
+                }
+
+                pm_data_ue_remove(victim);
+                slot = pm_data_ue_lookup(ues[i].rnti);
+            }
+
+            index = pm_data_ue_free_head;
+            pm_data_ue_free_head = pm_data_ue_entries[index].next;
+
+            memset(&pm_data_ue_entries[index], 0, sizeof(pm_data_ue_entry_t));
+            pm_data_ue_entries[index].rnti = ues[i].rnti;
+            pm_data_ue_table[slot] = index;
+        }
+        else {
+            pm_data_ue_lru_unlink(index);
+        }
+
+        pm_data_ue_entry_t *entry = &pm_data_ue_entries[index];
+        entry->last_seen = pm_data_ue_tick;
+        entry->samples++;
+        entry->dl_sum += ues[i].dl;
+        entry->ul_sum += ues[i].ul;
+        pm_data_ue_lru_push_front(index);
+    }
+
+    pm_data_slice_entry_t *slice = 0;
+    for(int i = 0; i < pm_data_slices_len; i++) {
+        if((pm_data_slices[i].sst == sst) && (pm_data_slices[i].sd == sd)) {
+            slice = &pm_data_slices[i];
+            break;
+        }
+    }
+
+    if((slice == 0) && (pm_data_slices_len < PM_DATA_UE_MAX_SLICES)) {
+        slice = &pm_data_slices[pm_data_slices_len];
+        memset(slice, 0, sizeof(pm_data_slice_entry_t));
+        slice->sst = sst;
+        slice->sd = sd;
+        pm_data_slices_len++;
+    }
+
+    if(slice) {
+        slice->samples++;
+        slice->dl_sum += dl_sum;
+        slice->ul_sum += ul_sum;
+    }
+}
+
+char *pm_data_ue_render(int du_id, int cell_id) {
+    char *content = 0;
+    size_t content_size = 0;
+
+    FILE *f = open_memstream(&content, &content_size);
+    if(f == 0) {
+        log_error("open_memstream failed");
+        return 0;
+    }
+
+    for(int index = pm_data_ue_lru_head; index != PM_DATA_UE_NONE; index = pm_data_ue_entries[index].next) {
+        const pm_data_ue_entry_t *entry = &pm_data_ue_entries[index];
+        if(entry->samples == 0) {
+            continue;
+        }
+
+        fprintf(f, "\n\t\t\t<measValue measObjLdn=\"DuFunction=%d,CellId=%d,UeId=%d\">", du_id, cell_id, entry->rnti);
+        fprintf(f, "\n\t\t\t\t<r p=\"6\">%ld</r>", (long)(entry->dl_sum / entry->samples));
+        fprintf(f, "\n\t\t\t\t<r p=\"7\">%ld</r>", (long)(entry->ul_sum / entry->samples));
+        fprintf(f, "\n\t\t\t</measValue>");
+    }
+
+    for(int i = 0; i < pm_data_slices_len; i++) {
+        const pm_data_slice_entry_t *slice = &pm_data_slices[i];
+        if(slice->samples == 0) {
+            continue;
+        }
+
+        fprintf(f, "\n\t\t\t<measValue measObjLdn=\"DuFunction=%d,CellId=%d,SNSSAI=%u-%06x\">", du_id, cell_id, slice->sst, slice->sd);
+        fprintf(f, "\n\t\t\t\t<r p=\"6\">%ld</r>", (long)(slice->dl_sum / slice->samples));
+        fprintf(f, "\n\t\t\t\t<r p=\"7\">%ld</r>", (long)(slice->ul_sum / slice->samples));
+        fprintf(f, "\n\t\t\t</measValue>");
+    }
+
+    if(fclose(f) != 0) {
+        log_error("fclose failed");
+        free(content);
+        return 0;
+    }
+
+    if(pm_data_ue_overflow) {
+        log_error("pm_data_ue table full, %ld UE samples not accounted", pm_data_ue_overflow);
+        pm_data_ue_overflow = 0;
+    }
+
+    // new period: departed UEs are dropped, the others start over
+    int index = pm_data_ue_lru_head;
+    while(index != PM_DATA_UE_NONE) {
+        int next = pm_data_ue_entries[index].next;
+        if(pm_data_ue_entries[index].samples == 0) {
+            pm_data_ue_remove(index);
+        }
+        else {
+            pm_data_ue_entries[index].samples = 0;
+            pm_data_ue_entries[index].dl_sum = 0;
+            pm_data_ue_entries[index].ul_sum = 0;
+        }
+        index = next;
+    }
+
+    pm_data_slices_len = 0;
+
+    return content;
+}
+
+static uint32_t pm_data_ue_hash(int rnti) {
+    return ((uint32_t)rnti * 2654435761u) & pm_data_ue_table_mask;
+}
+
+// returns the slot holding rnti, or the empty slot where it belongs
+static uint32_t pm_data_ue_lookup(int rnti) {
+    uint32_t slot = pm_data_ue_hash(rnti);
+    while((pm_data_ue_table[slot] != PM_DATA_UE_NONE) && (pm_data_ue_entries[pm_data_ue_table[slot]].rnti != rnti)) {
+        slot = (slot + 1) & pm_data_ue_table_mask;
+    }
+
+    return slot;
+}
+
+static void pm_data_ue_remove(int index) {
+    uint32_t hole = pm_data_ue_lookup(pm_data_ue_entries[index].rnti);
+    pm_data_ue_table[hole] = PM_DATA_UE_NONE;
+
+    // backward shift deletion keeps linear probing chains intact without tombstones
+    uint32_t slot = hole;
+    while(1) {
+        slot = (slot + 1) & pm_data_ue_table_mask;
+        if(pm_data_ue_table[slot] == PM_DATA_UE_NONE) {
+            break;
+        }
+
+        uint32_t home = pm_data_ue_hash(pm_data_ue_entries[pm_data_ue_table[slot]].rnti);
+        if(((slot - home) & pm_data_ue_table_mask) >= ((slot - hole) & pm_data_ue_table_mask)) {
+            pm_data_ue_table[hole] = pm_data_ue_table[slot];
+            pm_data_ue_table[slot] = PM_DATA_UE_NONE;
+            hole = slot;
+        }
+    }
+
+    pm_data_ue_lru_unlink(index);
+    pm_data_ue_entries[index].next = pm_data_ue_free_head;
+    pm_data_ue_free_head = index;
+}
+
+static void pm_data_ue_lru_unlink(int index) {
+    pm_data_ue_entry_t *entry = &pm_data_ue_entries[index];
+
+    if(entry->prev != PM_DATA_UE_NONE) {
+        pm_data_ue_entries[entry->prev].next = entry->next;
+    }
+    else {
+        pm_data_ue_lru_head = entry->next;
+    }
+
+    if(entry->next != PM_DATA_UE_NONE) {
+        pm_data_ue_entries[entry->next].prev = entry->prev;
+    }
+    else {
+        pm_data_ue_lru_tail = entry->prev;
+    }
+
+    entry->prev = PM_DATA_UE_NONE;
+    entry->next = PM_DATA_UE_NONE;
+}
+
+static void pm_data_ue_lru_push_front(int index) {
+    pm_data_ue_entry_t *entry = &pm_data_ue_entries[index];
+
+    entry->prev = PM_DATA_UE_NONE;
+    entry->next = pm_data_ue_lru_head;
+    if(pm_data_ue_lru_head != PM_DATA_UE_NONE) {
+        pm_data_ue_entries[pm_data_ue_lru_head].prev = index;
+    }
+    pm_data_ue_lru_head = index;
+
+    if(pm_data_ue_lru_tail == PM_DATA_UE_NONE) {
+        pm_data_ue_lru_tail = index;
+    }
+}
@@ -0,0 +1,42 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+#include "oai/oai_data.h"
+
+/**
+ * per-UE (RNTI) and per-slice (S-NSSAI) PM aggregates
+ *   UEs are kept in a bounded open addressing hash table, when full the least
+ *   recently seen (departed) UE is evicted; UEs not seen during a whole
+ *   granularity period are dropped when the period is rendered
+*/
+int pm_data_ue_init(int max_ues);
+void pm_data_ue_free();
+
+void pm_data_ue_feed(const oai_ues_thp_t *ues, int ues_len, uint32_t sst, uint32_t sd);
+
+// renders the period's additional measValue objects and starts a new period
+char *pm_data_ue_render(int du_id, int cell_id);
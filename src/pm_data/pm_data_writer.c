@@ -0,0 +1,379 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+
+#define _GNU_SOURCE
+
+#include "pm_data_writer.h"
+#include "common/log.h"
+#include "common/stages.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#define PM_DATA_WRITER_CHUNK    16384
+
+typedef struct pm_data_writer_job {
+    char *directory;
+    char *filename;
+    char *content;
+    struct pm_data_writer_job *next;
+} pm_data_writer_job_t;
+
+typedef struct pm_data_writer_node {
+    pm_data_writer_result_t result;
+    struct pm_data_writer_node *next;
+} pm_data_writer_node_t;
+
+static pthread_t pm_data_writer_thread;
+static bool pm_data_writer_running = false;
+static bool pm_data_writer_stop = false;
+static pthread_mutex_t pm_data_writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pm_data_writer_cv = PTHREAD_COND_INITIALIZER;
+
+// FIFO of pending jobs and of completed results
+static pm_data_writer_job_t *pm_data_writer_jobs_head = 0;
+static pm_data_writer_job_t *pm_data_writer_jobs_tail = 0;
+static pm_data_writer_node_t *pm_data_writer_results_head = 0;
+static pm_data_writer_node_t *pm_data_writer_results_tail = 0;
+
+// zlib stream is only touched by the writer thread and reused across files
+static bool pm_data_writer_compression = false;
+static z_stream pm_data_writer_zstream;
+
+static void *pm_data_writer_routine(void *arg);
+static int pm_data_writer_process(const pm_data_writer_job_t *job, pm_data_writer_result_t *result);
+static int pm_data_writer_write_all(int fd, const char *buffer, size_t size);
+static int pm_data_writer_deflate(int fd, const char *content, size_t size);
+static void pm_data_writer_job_free(pm_data_writer_job_t *job);
+
+int pm_data_writer_init(bool compression, int compression_level) {
+    pm_data_writer_compression = compression;
+    pm_data_writer_stop = false;
+
+    if(pm_data_writer_compression) {
+        memset(&pm_data_writer_zstream, 0, sizeof(z_stream));
+        // 15 + 16 selects the gzip wrapper instead of raw zlib
+        if(deflateInit2(&pm_data_writer_zstream, compression_level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            log_error("deflateInit2() failed");
+            goto failure;
+        }
+    }
+
+    if(pthread_create(&pm_data_writer_thread, 0, pm_data_writer_routine, 0) != 0) {
+        log_error("pthread_create() failed");
+        goto failure;
+    }
+    pm_data_writer_running = true;
+
+    return 0;
+
+failure:
+    if(pm_data_writer_compression) {
+        deflateEnd(&pm_data_writer_zstream);
+        pm_data_writer_compression = false;
+    }
+    return 1;
+}
+
+void pm_data_writer_flush() {
+    if(pm_data_writer_running) {
+        // pending jobs are still written before the thread exits
+        pthread_mutex_lock(&pm_data_writer_mutex);
+        pm_data_writer_stop = true;
+        pthread_cond_signal(&pm_data_writer_cv);
+        pthread_mutex_unlock(&pm_data_writer_mutex);
+
+        pthread_join(pm_data_writer_thread, 0);
+        pm_data_writer_running = false;
+    }
+}
+
+int pm_data_writer_free() {
+    pm_data_writer_flush();
+
+    pm_data_writer_result_t result;
+    while(pm_data_writer_poll(&result)) {
+        pm_data_writer_result_free(&result);
+    }
+
+    if(pm_data_writer_compression) {
+        deflateEnd(&pm_data_writer_zstream);
+        pm_data_writer_compression = false;
+    }
+
+    return 0;
+}
+
+int pm_data_writer_submit(const char *directory, const char *filename, char *content) {
+    pm_data_writer_job_t *job = (pm_data_writer_job_t *)malloc(sizeof(pm_data_writer_job_t));
+    if(job == 0) {
+        log_error("malloc failed");
+        free(content);
+        goto failure;
+    }
+
+    job->content = content;
+    job->next = 0;
+    job->directory = strdup(directory);
+    job->filename = strdup(filename);
+    if((job->directory == 0) || (job->filename == 0)) {
+        log_error("strdup failed");
+        pm_data_writer_job_free(job);
+        goto failure;
+    }
+
+    pthread_mutex_lock(&pm_data_writer_mutex);
+    if(pm_data_writer_jobs_tail) {
+        pm_data_writer_jobs_tail->next = job;
+    }
+    else {
+        pm_data_writer_jobs_head = job;
+    }
+    pm_data_writer_jobs_tail = job;
+    pthread_cond_signal(&pm_data_writer_cv);
+    pthread_mutex_unlock(&pm_data_writer_mutex);
+
+    return 0;
+
+failure:
+    return 1;
+}
+
+int pm_data_writer_poll(pm_data_writer_result_t *result) {
+    pm_data_writer_node_t *node = 0;
+
+    pthread_mutex_lock(&pm_data_writer_mutex);
+    node = pm_data_writer_results_head;
+    if(node) {
+        pm_data_writer_results_head = node->next;
+        if(pm_data_writer_results_head == 0) {
+            pm_data_writer_results_tail = 0;
+        }
+    }
+    pthread_mutex_unlock(&pm_data_writer_mutex);
+
+    if(node == 0) {
+        return 0;
+    }
+
+    *result = node->result;
+    free(node);
+    return 1;
+}
+
+void pm_data_writer_result_free(pm_data_writer_result_t *result) {
+    free(result->full_path);
+    result->full_path = 0;
+}
+
+static void *pm_data_writer_routine(void *arg) {
+    (void)arg;
+
+    while(1) {
+        pthread_mutex_lock(&pm_data_writer_mutex);
+        while((pm_data_writer_jobs_head == 0) && !pm_data_writer_stop) {
+            pthread_cond_wait(&pm_data_writer_cv, &pm_data_writer_mutex);
+        }
+
+        pm_data_writer_job_t *job = pm_data_writer_jobs_head;
+        if(job == 0) {
+            // stop requested and queue drained
+            pthread_mutex_unlock(&pm_data_writer_mutex);
+            break;
+        }
+        pm_data_writer_jobs_head = job->next;
+        if(pm_data_writer_jobs_head == 0) {
+            pm_data_writer_jobs_tail = 0;
+        }
+        pthread_mutex_unlock(&pm_data_writer_mutex);
+
+        pm_data_writer_node_t *node = (pm_data_writer_node_t *)malloc(sizeof(pm_data_writer_node_t));
+        if(node == 0) {
+            log_error("malloc failed");
+            pm_data_writer_job_free(job);
+            continue;
+        }
+        memset(node, 0, sizeof(pm_data_writer_node_t));
+
+        long int start = stages_start();
+        node->result.rc = pm_data_writer_process(job, &node->result);
+        stages_record(STAGE_PM_WRITE, start);
+        pm_data_writer_job_free(job);
+
+        pthread_mutex_lock(&pm_data_writer_mutex);
+        if(pm_data_writer_results_tail) {
+            pm_data_writer_results_tail->next = node;
+        }
+        else {
+            pm_data_writer_results_head = node;
+        }
+        pm_data_writer_results_tail = node;
+        pthread_mutex_unlock(&pm_data_writer_mutex);
+    }
+
+    return 0;
+}
+
+static int pm_data_writer_process(const pm_data_writer_job_t *job, pm_data_writer_result_t *result) {
+    char *temp_path = 0;
+    int fd = -1;
+    const char *extension = pm_data_writer_compression ? ".gz" : "";
+
+    result->compressed = pm_data_writer_compression;
+
+    asprintf(&result->full_path, "%s/%s%s", job->directory, job->filename, extension);
+    if(result->full_path == 0) {
+        log_error("asprintf error");
+        goto failure;
+    }
+
+    // hidden name keeps the file out of the retention index and of SFTP listings
+    asprintf(&temp_path, "%s/.%s%s.tmp", job->directory, job->filename, extension);
+    if(temp_path == 0) {
+        log_error("asprintf error");
+        goto failure;
+    }
+
+    fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd == -1) {
+        log_error("open(%s) failed: %s", temp_path, strerror(errno));
+        goto failure;
+    }
+
+    size_t size = strlen(job->content);
+    int rc;
+    if(pm_data_writer_compression) {
+        rc = pm_data_writer_deflate(fd, job->content, size);
+    }
+    else {
+        rc = pm_data_writer_write_all(fd, job->content, size);
+    }
+    if(rc != 0) {
+        log_error("writing %s failed", temp_path);
+        goto failure;
+    }
+
+    if(fdatasync(fd) != 0) {
+        log_error("fdatasync() failed: %s", strerror(errno));
+        goto failure;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        log_error("fstat() failed: %s", strerror(errno));
+        goto failure;
+    }
+    result->size = st.st_size;
+    result->mtime = st.st_mtime;
+
+    close(fd);
+    fd = -1;
+
+    if(rename(temp_path, result->full_path) != 0) {
+        log_error("rename(%s) failed: %s", result->full_path, strerror(errno));
+        goto failure;
+    }
+
+    // persist the rename itself
+    int dirfd = open(job->directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(dirfd != -1) {
+        fsync(dirfd);
+        close(dirfd);
+    }
+
+    free(temp_path);
+    return 0;
+
+failure:
+    if(fd != -1) {
+        close(fd);
+    }
+    if(temp_path) {
+        unlink(temp_path);
+    }
+    free(temp_path);
+    return 1;
+}
+
+static int pm_data_writer_write_all(int fd, const char *buffer, size_t size) {
+    while(size) {
+        ssize_t written = write(fd, buffer, size);
+        if(written < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            log_error("write() failed: %s", strerror(errno));
+            return 1;
+        }
+
+        buffer += written;
+        size -= written;
+    }
+
+    return 0;
+}
+
+static int pm_data_writer_deflate(int fd, const char *content, size_t size) {
+    unsigned char out[PM_DATA_WRITER_CHUNK];
+    int rc;
+
+    if(deflateReset(&pm_data_writer_zstream) != Z_OK) {
+        log_error("deflateReset() failed");
+        return 1;
+    }
+
+    pm_data_writer_zstream.next_in = (Bytef *)content;
+    pm_data_writer_zstream.avail_in = size;
+
+    do {
+        pm_data_writer_zstream.next_out = out;
+        pm_data_writer_zstream.avail_out = sizeof(out);
+
+        rc = deflate(&pm_data_writer_zstream, Z_FINISH);
+        if(rc == Z_STREAM_ERROR) {
+            log_error("deflate() failed");
+            return 1;
+        }
+
+        if(pm_data_writer_write_all(fd, (const char *)out, sizeof(out) - pm_data_writer_zstream.avail_out) != 0) {
+            return 1;
+        }
+    } while(rc != Z_STREAM_END);
+
+    return 0;
+}
+
+static void pm_data_writer_job_free(pm_data_writer_job_t *job) {
+    free(job->directory);
+    free(job->filename);
+    free(job->content);
+    free(job);
+}
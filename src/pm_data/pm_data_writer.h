@@ -0,0 +1,58 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <time.h>
+#include <sys/types.h>
+
+/**
+ * background PM file writer
+ *   content is written into a hidden temp file in the target directory,
+ *   optionally gzip compressed, fdatasync'ed and then atomically renamed,
+ *   so SFTP clients never see a partially written file
+ *   completed jobs are collected from the main loop with pm_data_writer_poll()
+*/
+
+typedef struct pm_data_writer_result {
+    char *full_path;        // final path, ".gz" appended when compressed
+    off_t size;             // on-disk (compressed) size
+    time_t mtime;
+    bool compressed;
+    int rc;                 // 0 on success
+} pm_data_writer_result_t;
+
+int pm_data_writer_init(bool compression, int compression_level);
+// writes every pending job and stops the thread, the results are left for pm_data_writer_poll()
+void pm_data_writer_flush();
+// results nobody polled are dropped
+int pm_data_writer_free();
+
+// takes ownership of content
+int pm_data_writer_submit(const char *directory, const char *filename, char *content);
+
+// returns 1 when a result was collected, 0 when nothing is pending
+int pm_data_writer_poll(pm_data_writer_result_t *result);
+void pm_data_writer_result_free(pm_data_writer_result_t *result);
@@ -25,6 +25,7 @@
 
 #include "telnet.h"
 #include "common/log.h"
+#include "common/trace.h"
 
 #include <libtelnet.h>
 #include <stdio.h>
@@ -495,15 +496,17 @@ static int telnet_write(const char *s, int timeout, const char **tokens, char **
 		}
 
 		if(pos) {
-			log("telnet_write('%.*s')", (int)(pos-s), s);
+			log_debug("telnet_write('%.*s')", (int)(pos-s), s);
 		}
 
+		trace_event(TRACE_TELNET_COMMAND, len, 0);
 		rc = write(telnet_sendPipe[1], s, len);
 		if(rc < 0) {
 			log_error("telnet write() failed");
 			goto failed;
 		}
 	}
+	long int sent = get_monotonic_microseconds();
 
 	int found_token = 0;
 	long int max_wait = get_seconds_since_epoch() + timeout;
@@ -526,6 +529,7 @@ static int telnet_write(const char *s, int timeout, const char **tokens, char **
 			}
 		}		
 	} while((max_wait >= get_seconds_since_epoch()) && !found_token);
+	trace_event(TRACE_TELNET_RESPONSE, rlen - 1, get_monotonic_microseconds() - sent);
 	if(timeout == 0) {
 		log_error("telnet_write(%s) timed out", s);
 		goto failed;
@@ -607,7 +611,7 @@ char *telnet_get_o1_stats() {
 		log_error("telnet_write failed");
 		goto failed;
 	}
-	printf("*****Response: %s", response);
+	log_trace("telnet response: %s", response);
 	start = strchr(response, '{');
 	stop = strrchr(response, '}');
 	if(stop == 0) {
@@ -0,0 +1,168 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+/**
+ * renders a binary trace log (common/trace.h) as text, or as JSON with one object per line
+ *   trace-decode [--json] trace.bin
+ * events come out oldest first; slots a crash left half written are counted and skipped
+*/
+
+#include "common/trace.h"
+#include "common/timestamp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct trace_decode_site {
+    const char *name;
+    const char *args[2];
+} trace_decode_site_t;
+
+static const trace_decode_site_t trace_decode_sites[TRACE_SITES_COUNT] = {
+#define TRACE_SITE_NAME(site, name, arg0, arg1) [site] = {name, {arg0, arg1}},
+    TRACE_SITES(TRACE_SITE_NAME)
+#undef TRACE_SITE_NAME
+};
+
+static void trace_decode_text(const trace_record_t *record);
+static void trace_decode_json(const trace_record_t *record);
+
+int main(int argc, char **argv) {
+    int json = 0;
+    const char *file = 0;
+    FILE *f = 0;
+    trace_record_t *records = 0;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        }
+        else if(file == 0) {
+            file = argv[i];
+        }
+        else {
+            file = 0;
+            break;
+        }
+    }
+
+    if(file == 0) {
+        fprintf(stderr, "usage: %s [--json] trace.bin\n", argv[0]);
+        return 2;
+    }
+
+    f = fopen(file, "rb");
+    if(f == 0) {
+        fprintf(stderr, "unable to open %s\n", file);
+        goto failed;
+    }
+
+    trace_header_t header;
+    if(fread(&header, sizeof(header), 1, f) != 1) {
+        fprintf(stderr, "%s: short header\n", file);
+        goto failed;
+    }
+
+    if((header.magic != TRACE_MAGIC) || (header.version != TRACE_VERSION) || (header.record_size != sizeof(trace_record_t))) {
+        fprintf(stderr, "%s: not a version %d trace log\n", file, TRACE_VERSION);
+        goto failed;
+    }
+
+    if((header.records == 0) || (header.records & (header.records - 1))) {
+        fprintf(stderr, "%s: bad slot count %lu\n", file, (unsigned long int)header.records);
+        goto failed;
+    }
+
+    records = (trace_record_t *)malloc(header.records * sizeof(trace_record_t));
+    if(records == 0) {
+        fprintf(stderr, "malloc failed\n");
+        goto failed;
+    }
+
+    if(fread(records, sizeof(trace_record_t), header.records, f) != header.records) {
+        fprintf(stderr, "%s: short file\n", file);
+        goto failed;
+    }
+
+    uint64_t head = header.head;
+    uint64_t first = (head > header.records) ? (head - header.records) : 0;
+    unsigned long int skipped = 0;
+    for(uint64_t position = first; position < head; position++) {
+        const trace_record_t *record = &records[position & (header.records - 1)];
+        if((record->sequence != position + 1) || (record->site >= TRACE_SITES_COUNT)) {
+            skipped++;
+            continue;
+        }
+
+        if(json) {
+            trace_decode_json(record);
+        }
+        else {
+            trace_decode_text(record);
+        }
+    }
+
+    fprintf(stderr, "%lu events written, %lu kept, %lu torn\n", (unsigned long int)head, (unsigned long int)(head - first), skipped);
+
+    free(records);
+    fclose(f);
+
+    return 0;
+
+failed:
+    free(records);
+    if(f) {
+        fclose(f);
+    }
+
+    return 1;
+}
+
+static void trace_decode_text(const trace_record_t *record) {
+    const trace_decode_site_t *site = &trace_decode_sites[record->site];
+    char time[TIMESTAMP_SIZE];
+
+    timestamp_format_netconf(time, record->timestamp);
+    printf("%s [%3u] %-16s", time, record->thread, site->name);
+    for(int i = 0; i < 2; i++) {
+        if(site->args[i][0]) {
+            printf(" %s=%lld", site->args[i], (long long)record->args[i]);
+        }
+    }
+    printf("\n");
+}
+
+static void trace_decode_json(const trace_record_t *record) {
+    const trace_decode_site_t *site = &trace_decode_sites[record->site];
+    char time[TIMESTAMP_SIZE];
+
+    timestamp_format_netconf(time, record->timestamp);
+    printf("{\"time\":\"%s\",\"timestamp\":%llu,\"thread\":%u,\"site\":\"%s\"", time, (unsigned long long)record->timestamp, record->thread, site->name);
+    for(int i = 0; i < 2; i++) {
+        if(site->args[i][0]) {
+            printf(",\"%s\":%lld", site->args[i], (long long)record->args[i]);
+        }
+    }
+    printf("}\n");
+}
@@ -25,21 +25,42 @@
 
 #include "ves.h"
 #include "ves_internal.h"
+#include "ves_sender.h"
 
 #include "common/utils.h"
 #include "common/log.h"
+#include "common/timer_wheel.h"
+#include "common/timestamp.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+// commonEventHeader priorities, they also select the sender queue
+#define VES_PRIORITY_ALARM          "High"
+#define VES_PRIORITY_HEARTBEAT      "Normal"
+#define VES_PRIORITY_FILE_READY     "Low"
+#define VES_PRIORITY_MEASUREMENT    "Low"
+
 static char *ves_template_new_alarm = 0;
 static char *ves_template_clear_alarm = 0;
 static char *ves_template_pnf_registration = 0;
 static char *ves_template_file_ready = 0;
 static char *ves_template_heartbeat = 0;
+static char *ves_template_measurement = 0;
+
+// templates with everything but the per-event fields already substituted, rebuilt when ves_set_info() changes something
+static ves_template_t *ves_compiled_new_alarm = 0;
+static ves_template_t *ves_compiled_clear_alarm = 0;
+static ves_template_t *ves_compiled_file_ready = 0;
+static ves_template_t *ves_compiled_heartbeat = 0;
+static ves_template_t *ves_compiled_measurement = 0;
 
 static bool ves_pnf_registration_sent = false;
-static long int ves_heartbeat_trigger_timestamp = -1;
+static timer_wheel_timer_t ves_heartbeat_timer;
+
+static int ves_compile_templates(void);
+static void ves_free_compiled_templates(void);
+static void ves_heartbeat_expired(void *arg);
 
 
 /**
@@ -68,12 +89,26 @@ int ves_init(const config_t *config) {
     //     goto failed;
     // }
 
-    rc = ves_sftp_daemon_init();
+    rc = ves_http_init();
+    if(rc != 0) {
+        log_error("ves_http_init() failed");
+        goto failed;
+    }
+
+    rc = ves_sender_init(config);
     if(rc != 0) {
-        log_error("sftp_daemon_init() failed");
+        log_error("ves_sender_init() failed");
         goto failed;
     }
 
+    if(config->ves.sftp_daemon) {
+        rc = ves_sftp_daemon_init();
+        if(rc != 0) {
+            log_error("sftp_daemon_init() failed");
+            goto failed;
+        }
+    }
+
     ves_template_new_alarm = file_read_content(config->ves.template.new_alarm);
     if(ves_template_new_alarm == 0) {
         log_error("ves_template_new_alarm failed");
@@ -104,8 +139,17 @@ int ves_init(const config_t *config) {
         goto failed;
     }
 
+    if(config->ves.template.measurement) {
+        ves_template_measurement = file_read_content(config->ves.template.measurement);
+        if(ves_template_measurement == 0) {
+            log_error("ves_template_measurement failed");
+            goto failed;
+        }
+    }
+
+    timer_wheel_timer_init(&ves_heartbeat_timer, ves_heartbeat_expired, 0);
     if(config->ves.heartbeat_interval != -1) {
-        ves_heartbeat_trigger_timestamp = get_seconds_since_epoch() + config->ves.heartbeat_interval;
+        timer_wheel_add(&ves_heartbeat_timer, config->ves.heartbeat_interval * 1000L);
     }
 
     return 0;
@@ -117,7 +161,10 @@ failed:
 }
 
 int ves_set_info(const ves_info_t *info) {
-    if(info->managed_element_id) {
+    bool changed = false;
+
+    if(info->managed_element_id && !(ves_common_header.info.managed_element_id && (strcmp(info->managed_element_id, ves_common_header.info.managed_element_id) == 0))) {
+        changed = true;
         free(ves_common_header.info.managed_element_id);
         ves_common_header.info.managed_element_id = strdup(info->managed_element_id);
         if(ves_common_header.info.managed_element_id == 0) {
@@ -126,7 +173,8 @@ int ves_set_info(const ves_info_t *info) {
         }
     }
 
-    if(info->vendor) {
+    if(info->vendor && !(ves_common_header.info.vendor && (strcmp(info->vendor, ves_common_header.info.vendor) == 0))) {
+        changed = true;
         free(ves_common_header.info.vendor);
         ves_common_header.info.vendor = strdup(info->vendor);
         if(ves_common_header.info.vendor == 0) {
@@ -135,6 +183,13 @@ int ves_set_info(const ves_info_t *info) {
         }
     }
 
+    if(changed && ves_common_header.info.vendor && ves_common_header.info.managed_element_id) {
+        if(ves_compile_templates() != 0) {
+            log_error("ves_compile_templates() failed");
+            goto failure;
+        }
+    }
+
     return 0;
 failure:
     return 1;
@@ -142,7 +197,12 @@ failure:
 
 void ves_free() {
     // ves_vsftp_daemon_deinit();
-    ves_sftp_daemon_deinit();
+    if(ves_config && ves_config->ves.sftp_daemon) {
+        ves_sftp_daemon_deinit();
+    }
+    timer_wheel_cancel(&ves_heartbeat_timer);
+    ves_sender_free();
+    ves_http_free();
 
     free(ves_common_header.info.managed_element_id);
     ves_common_header.info.managed_element_id = 0;
@@ -161,6 +221,9 @@ void ves_free() {
     ves_template_file_ready = 0;
     free(ves_template_heartbeat);
     ves_template_heartbeat = 0;
+    free(ves_template_measurement);
+    ves_template_measurement = 0;
+    ves_free_compiled_templates();
 
     ves_config = 0;
 }
@@ -182,19 +245,6 @@ void ves_loop() {
             }
             ves_pnf_registration_sent = true;
         }
-
-        // heartbeat
-        if(ves_heartbeat_trigger_timestamp != -1) {
-            long int current_timestamp = get_seconds_since_epoch();
-
-            if(current_timestamp >= ves_heartbeat_trigger_timestamp) {
-                ves_heartbeat_trigger_timestamp = current_timestamp + ves_config->ves.heartbeat_interval;
-                rc = ves_heartbeat_execute();
-                if(rc != 0) {
-                    log_error("ves_heartbeat_execute() failed");
-                }
-            }
-        } 
 	}
 }
 
@@ -283,7 +333,6 @@ int ves_pnf_registration_execute(const ves_pnf_registration_data_t *data) {
         }
     }
 
-   log("*********ves_execute****%s %s %s %s", content, domain, event_type, priority);
     rc = ves_execute(content, domain, event_type, priority);
     if(rc != 0) {
         log_error("ves_execute() failed");
@@ -301,293 +350,282 @@ failed:
 }
 
 int ves_fileready_execute(const ves_file_ready_t *data) {
-    char *fileExpiry = 0;
-    char *content = 0;
     int rc;
+
     if(data == 0) {
         log_error("data is null");
-        goto failed;
+        return 1;
     }
 
     if(!(ves_common_header.info.vendor && ves_common_header.info.managed_element_id)) {
         log_error("unset VES information");
-        goto failed;
+        return 1;
     }
 
     char *domain = "stndDefined";
-    char *event_type = "OAI_FileReady";
-    char *priority = "Low";
-    fileExpiry = get_netconf_timestamp_with_miliseconds(ves_config->ves.file_expiry);
-
-    content = strdup(ves_template_file_ready);
-    if(content == 0) {
-        log_error("strdup failed");
-        goto failed;
-    }
+    char fileExpiry[TIMESTAMP_SIZE];
+    timestamp_format_netconf(fileExpiry, timestamp_now_us() + ves_config->ves.file_expiry * 1000000L);
 
-    content = str_replace_inplace(content, "@model@", ves_config->info.model);
-    if(content == 0) {
-        log_error("str_replace_inplace() failed");
-        goto failed;
-    }
+    char file_size[32];
+    sprintf(file_size, "%d", data->file_size);
 
-    content = str_replace_inplace(content, "@fileExpiry@", fileExpiry);
-    if(content == 0) {
-        log_error("str_replace_inplace() failed");
-        goto failed;
-    }
+    char notification_id[16];
+    sprintf(notification_id, "%d", data->notification_id);
 
-    content = str_replace_inplace(content, "@fileLocation@", data->file_location);
-    if(content == 0) {
-        log_error("str_replace_inplace() failed");
-        goto failed;
-    }
+    ves_template_field_t fields[] = {
+        {"fileExpiry", fileExpiry},
+        {"fileLocation", data->file_location},
+        {"fileSize", file_size},
+        {"fileCompression", data->file_compression ? data->file_compression : "no"},
+        {"notification-id", notification_id},
+    };
 
-    char file_size[32];
-    sprintf(file_size, "%d", data->file_size);
-    content = str_replace_inplace(content, "@fileSize@", file_size);
-    if(content == 0) {
-        log_error("str_replace_inplace() failed");
-        goto failed;
+    rc = ves_execute_template(ves_compiled_file_ready, fields, sizeof(fields) / sizeof(fields[0]), domain, VES_PRIORITY_FILE_READY);
+    if(rc != 0) {
+        log_error("ves_execute_template() failed");
+        return 1;
     }
 
-    content = str_replace_inplace(content, "@oamIp@", ves_config->network.host);
-    if(content == 0) {
-        log_error("str_replace_inplace() failed");
-        goto failed;
-    }
+    return 0;
+}
 
-    char portstr[8];
-    sprintf(portstr, "%d", ves_config->network.sftp_port);
-    content = str_replace_inplace(content, "@port@", portstr);
-    if(content == 0) {
-        log_error("str_replace_inplace() failed");
-        goto failed;
+int ves_alarm_new_execute(const ves_alarm_t *data) {
+    if(data == 0) {
+        log_error("data is null");
+        return 1;
     }
 
-    content = str_replace_inplace(content, "@username@", ves_config->network.username);
-    if(content == 0) {
-        log_error("str_replace_inplace() failed");
-        goto failed;
+    if(!(ves_common_header.info.vendor && ves_common_header.info.managed_element_id)) {
+        log_error("unset VES information");
+        return 1;
     }
 
-    content = str_replace_inplace(content, "@password@", ves_config->network.password);
-    if(content == 0) {
-        log_error("str_replace_inplace() failed");
-        goto failed;
-    }
+    char *domain = "stndDefined";
 
-    char notification_id[8];
+    char notification_id[16];
     sprintf(notification_id, "%d", data->notification_id);
-    content = str_replace_inplace(content, "@notification-id@", notification_id);
-    if(content == 0) {
-        log_error("str_replace_inplace() failed");
-        goto failed;
-    }
-    //log("*****VES_FILE_READY**** %s %s %s %s:", content, domain, event_type, priority); 
-    rc = ves_execute(content, domain, event_type, priority);
+
+    ves_template_field_t fields[] = {
+        {"alarm", data->alarm},
+        {"severity", data->severity},
+        {"alarm-type", data->type},
+        {"object-instance", data->object_instance},
+        {"notification-id", notification_id},
+    };
+
+    int rc = ves_execute_template(ves_compiled_new_alarm, fields, sizeof(fields) / sizeof(fields[0]), domain, VES_PRIORITY_ALARM);
     if(rc != 0) {
-        log_error("ves_execute() failed");
-        goto failed;
+        log_error("ves_execute_template() failed");
+        return 1;
     }
 
-    free(content);
-    content = 0;
-    free(fileExpiry);
-    fileExpiry = 0;
-    
-    return rc;
-
-failed:
-    free(fileExpiry);
-    free(content);
-    return 1;
+    return 0;
 }
 
-int ves_alarm_new_execute(const ves_alarm_t *data) {
-    char *content = 0;
-    int rc;
-
+int ves_alarm_clear_execute(const ves_alarm_t *data) {
     if(data == 0) {
         log_error("data is null");
-        goto failed;
+        return 1;
     }
 
     if(!(ves_common_header.info.vendor && ves_common_header.info.managed_element_id)) {
         log_error("unset VES information");
-        goto failed;
+        return 1;
     }
 
     char *domain = "stndDefined";
-    char *event_type = "OAI_Alarm";
-    char *priority = "Low";
 
-    content = strdup(ves_template_new_alarm);
-    if(content == 0) {
-        log_error("strdup failed");
-        goto failed;
-    }
+    char notification_id[16];
+    sprintf(notification_id, "%d", data->notification_id);
 
-    content = str_replace_inplace(content, "@alarm@", data->alarm);
-    if(content == 0) {
-        log_error("str_replace_inplace() failed");
-        goto failed;
-    }
+    ves_template_field_t fields[] = {
+        {"alarm", data->alarm},
+        {"severity", data->severity},
+        {"alarm-type", data->type},
+        {"object-instance", data->object_instance},
+        {"notification-id", notification_id},
+    };
 
-    content = str_replace_inplace(content, "@severity@", data->severity);
-    if(content == 0) {
-        log_error("str_replace_inplace() failed");
-        goto failed;
+    int rc = ves_execute_template(ves_compiled_clear_alarm, fields, sizeof(fields) / sizeof(fields[0]), domain, VES_PRIORITY_ALARM);
+    if(rc != 0) {
+        log_error("ves_execute_template() failed");
+        return 1;
     }
 
-    content = str_replace_inplace(content, "@alarm-type@", data->type);
-    if(content == 0) {
-        log_error("str_replace_inplace() failed");
-        goto failed;
-    }
+    return 0;
+}
 
-    content = str_replace_inplace(content, "@object-instance@", data->object_instance);
-    if(content == 0) {
-        log_error("str_replace_inplace() failed");
-        goto failed;
+int ves_heartbeat_execute() {
+    if(!(ves_common_header.info.vendor && ves_common_header.info.managed_element_id)) {
+        log_error("unset VES information");
+        return 1;
     }
 
-    char notification_id[8];
-    sprintf(notification_id, "%d", data->notification_id);
-    content = str_replace_inplace(content, "@notification-id@", notification_id);
-    if(content == 0) {
-        log_error("str_replace_inplace() failed");
-        goto failed;
-    }
-    
-    log("ves_execute %s %s %s %s", content, domain, event_type, priority);
-    rc = ves_execute(content, domain, event_type, priority);
+    char *domain = "heartbeat";
+
+    int rc = ves_execute_template(ves_compiled_heartbeat, 0, 0, domain, VES_PRIORITY_HEARTBEAT);
     if(rc != 0) {
-        log_error("ves_execute() failed");
-        goto failed;
+        log_error("ves_execute_template() failed");
+        return 1;
     }
 
-    free(content);
-    content = 0;
-    
-    return rc;
-
-failed:
-    free(content);
-    return 1;
+    return 0;
 }
 
-int ves_alarm_clear_execute(const ves_alarm_t *data) {
-    char *content = 0;
-    int rc;
-
+int ves_measurement_execute(const ves_measurement_t *data) {
     if(data == 0) {
         log_error("data is null");
-        goto failed;
+        return 1;
+    }
+
+    if(ves_template_measurement == 0) {
+        log_error("no measurement template");
+        return 1;
     }
 
     if(!(ves_common_header.info.vendor && ves_common_header.info.managed_element_id)) {
         log_error("unset VES information");
-        goto failed;
+        return 1;
     }
 
-    char *domain = "stndDefined";
-    char *event_type = "OAI_Alarm";
-    char *priority = "Low";
+    char *domain = "measurement";
 
-    content = strdup(ves_template_clear_alarm);
-    if(content == 0) {
-        log_error("strdup failed");
-        goto failed;
-    }
+    char start_epoch_microsec[32];
+    sprintf(start_epoch_microsec, "%lu", data->start_epoch_microsec);
 
-    content = str_replace_inplace(content, "@alarm@", data->alarm);
-    if(content == 0) {
-        log_error("str_replace_inplace() failed");
-        goto failed;
-    }
+    char interval[16];
+    sprintf(interval, "%d", data->interval);
 
-    content = str_replace_inplace(content, "@severity@", data->severity);
-    if(content == 0) {
-        log_error("str_replace_inplace() failed");
-        goto failed;
+    char mean_active_ue[16];
+    sprintf(mean_active_ue, "%d", data->mean_active_ue);
+
+    char max_active_ue[16];
+    sprintf(max_active_ue, "%d", data->max_active_ue);
+
+    char load_avg[16];
+    sprintf(load_avg, "%d", data->load_avg);
+
+    char ue_thp_dl[32];
+    sprintf(ue_thp_dl, "%ld", data->ue_thp_dl);
+
+    char ue_thp_ul[32];
+    sprintf(ue_thp_ul, "%ld", data->ue_thp_ul);
+
+    ves_template_field_t fields[] = {
+        {"start-epoch-microsec", start_epoch_microsec},
+        {"measurement-interval", interval},
+        {"mean-active-ue", mean_active_ue},
+        {"max-active-ue", max_active_ue},
+        {"load-avg", load_avg},
+        {"ue-thp-dl", ue_thp_dl},
+        {"ue-thp-ul", ue_thp_ul},
+    };
+
+    // consecutive measurements are coalesced into one eventBatch by the sender's ves.batch-window
+    int rc = ves_execute_template(ves_compiled_measurement, fields, sizeof(fields) / sizeof(fields[0]), domain, VES_PRIORITY_MEASUREMENT);
+    if(rc != 0) {
+        log_error("ves_execute_template() failed");
+        return 1;
     }
 
-    content = str_replace_inplace(content, "@alarm-type@", data->type);
-    if(content == 0) {
-        log_error("str_replace_inplace() failed");
+    return 0;
+}
+
+static int ves_compile_templates(void) {
+    ves_free_compiled_templates();
+
+    ves_compiled_new_alarm = ves_compile(ves_template_new_alarm, "stndDefined", "OAI_Alarm", VES_PRIORITY_ALARM, 0, 0);
+    if(ves_compiled_new_alarm == 0) {
+        log_error("ves_compile() failed");
         goto failed;
     }
 
-    content = str_replace_inplace(content, "@object-instance@", data->object_instance);
-    if(content == 0) {
-        log_error("str_replace_inplace() failed");
+    ves_compiled_clear_alarm = ves_compile(ves_template_clear_alarm, "stndDefined", "OAI_Alarm", VES_PRIORITY_ALARM, 0, 0);
+    if(ves_compiled_clear_alarm == 0) {
+        log_error("ves_compile() failed");
         goto failed;
     }
 
-    char notification_id[8];
-    sprintf(notification_id, "%d", data->notification_id);
-    content = str_replace_inplace(content, "@notification-id@", notification_id);
-    if(content == 0) {
-        log_error("str_replace_inplace() failed");
+    char sftp_port[8];
+    sprintf(sftp_port, "%d", ves_config->network.sftp_port);
+    ves_template_field_t file_ready[] = {
+        {"model", ves_config->info.model},
+        {"oamIp", ves_config->network.host},
+        {"port", sftp_port},
+        {"username", ves_config->network.username},
+        {"password", ves_config->network.password},
+    };
+    ves_compiled_file_ready = ves_compile(ves_template_file_ready, "stndDefined", "OAI_FileReady", VES_PRIORITY_FILE_READY, file_ready, sizeof(file_ready) / sizeof(file_ready[0]));
+    if(ves_compiled_file_ready == 0) {
+        log_error("ves_compile() failed");
         goto failed;
     }
-    
-    rc = ves_execute(content, domain, event_type, priority);
-    if(rc != 0) {
-        log_error("ves_execute() failed");
-        goto failed;
+
+    char heartbeat_interval[8];
+    sprintf(heartbeat_interval, "%d", ves_config->ves.heartbeat_interval);
+    ves_template_field_t heartbeat[] = {
+        {"heartbeat-interval", heartbeat_interval},
+    };
+    ves_compiled_heartbeat = ves_compile(ves_template_heartbeat, "heartbeat", "OAI_HeartBeat", VES_PRIORITY_HEARTBEAT, heartbeat, sizeof(heartbeat) / sizeof(heartbeat[0]));
+    if(ves_compiled_heartbeat == 0) {
+        log_error("ves_compile() failed");
+        goto failed;
+    }
+
+    if(ves_template_measurement) {
+        char du_id[16];
+        sprintf(du_id, "%d", ves_config->info.gnb_du_id);
+        char cell_id[16];
+        sprintf(cell_id, "%d", ves_config->info.cell_local_id);
+        ves_template_field_t measurement[] = {
+            {"du-id", du_id},
+            {"cell-id", cell_id},
+        };
+        ves_compiled_measurement = ves_compile(ves_template_measurement, "measurement", "OAI_Measurement", VES_PRIORITY_MEASUREMENT, measurement, sizeof(measurement) / sizeof(measurement[0]));
+        if(ves_compiled_measurement == 0) {
+            log_error("ves_compile() failed");
+            goto failed;
+        }
     }
 
-    free(content);
-    content = 0;
-    
-    return rc;
+    return 0;
 
 failed:
-    free(content);
+    ves_free_compiled_templates();
     return 1;
 }
 
-int ves_heartbeat_execute() {
-    char *content = 0;
-    int rc;
+// keeps the heartbeat on its interval grid, a late run does not push the following ones back
+static void ves_heartbeat_expired(void *arg) {
+    long int now = get_monotonic_milliseconds();
 
     if(!(ves_common_header.info.vendor && ves_common_header.info.managed_element_id)) {
-        log_error("unset VES information");
-        goto failed;
+        // nothing to send yet, check again in a second
+        timer_wheel_add(&ves_heartbeat_timer, 1000);
+        return;
     }
 
-    char *domain = "heartbeat";
-    char *event_type = "OAI_HeartBeat";
-    char *priority = "Low";
-
-    content = strdup(ves_template_heartbeat);
-    if(content == 0) {
-        log_error("strdup failed");
-        goto failed;
+    long int next = ves_heartbeat_timer.expires + ves_config->ves.heartbeat_interval * 1000L;
+    if(next <= now) {
+        next = now + ves_config->ves.heartbeat_interval * 1000L;
     }
+    timer_wheel_add_at(&ves_heartbeat_timer, next);
 
-    char heartbeat_interval[8];
-    sprintf(heartbeat_interval, "%d", ves_config->ves.heartbeat_interval);
-    content = str_replace_inplace(content, "@heartbeat-interval@", heartbeat_interval);
-    if(content == 0) {
-        log_error("str_replace_inplace() failed");
-        goto failed;
-    }
-    
-    rc = ves_execute(content, domain, event_type, priority);
+    int rc = ves_heartbeat_execute();
     if(rc != 0) {
-        log_error("ves_execute() failed");
-        goto failed;
+        log_error("ves_heartbeat_execute() failed");
     }
+}
 
-    free(content);
-    content = 0;
-    
-    return rc;
-
-failed:
-    free(content);
-    return 1;
+static void ves_free_compiled_templates(void) {
+    ves_template_free(ves_compiled_new_alarm);
+    ves_compiled_new_alarm = 0;
+    ves_template_free(ves_compiled_clear_alarm);
+    ves_compiled_clear_alarm = 0;
+    ves_template_free(ves_compiled_file_ready);
+    ves_compiled_file_ready = 0;
+    ves_template_free(ves_compiled_heartbeat);
+    ves_compiled_heartbeat = 0;
+    ves_template_free(ves_compiled_measurement);
+    ves_compiled_measurement = 0;
 }
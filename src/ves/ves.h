@@ -39,6 +39,7 @@ typedef struct ves_pnf_registration_data {
 typedef struct ves_file_ready {
     char *file_location;
     int file_size;
+    char *file_compression;     // "gzip" or "no"; null means "no"
     int notification_id;
 } ves_file_ready_t;
 
@@ -50,6 +51,16 @@ typedef struct ves_alarm {
     int notification_id;
 } ves_alarm_t;
 
+typedef struct ves_measurement {
+    unsigned long start_epoch_microsec;
+    int interval;               // seconds covered by this event
+    int mean_active_ue;
+    int max_active_ue;
+    int load_avg;
+    long int ue_thp_dl;
+    long int ue_thp_ul;
+} ves_measurement_t;
+
 int ves_init(const config_t *config);
 int ves_set_info(const ves_info_t *info);
 void ves_free();
@@ -60,3 +71,5 @@ int ves_fileready_execute(const ves_file_ready_t *data);
 int ves_alarm_new_execute(const ves_alarm_t *data);
 int ves_alarm_clear_execute(const ves_alarm_t *data);
 int ves_heartbeat_execute();
+// measurement events are coalesced with the other queued events by ves.batch-window
+int ves_measurement_execute(const ves_measurement_t *data);
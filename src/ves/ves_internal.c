@@ -24,37 +24,72 @@
 #define _GNU_SOURCE
 
 #include "ves_internal.h"
+#include "ves_sender.h"
 #include "common/utils.h"
+#include "common/timestamp.h"
 #include "common/log.h"
+#include "common/stages.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <curl/curl.h>
 
-struct memory {
-    char *response;
-    size_t size;
-};
-
-static int ves_http_request(const char *url, const char *username, const char* password, const char *method, const char *send_data, int *response_code, char **recv_data);
-static int ves_dummy_http_request(const char *url, const char *username, const char* password, const char *method, const char *send_data, int *response_code, char **recv_data);
 static size_t curl_write_cb(void *data, size_t size, size_t nmemb, void *userp);
+static const char *ves_event_unwrap(const char *event);
+static const char *ves_event_unwrap_end(const char *event);
+static struct curl_slist *ves_http_header_new(bool gzip);
 
 const config_t *ves_config = 0;
 ves_common_header_t ves_common_header = {0};
 
+// shared by all handles of the sender pool
+static bool ves_curl_global = false;
+static struct curl_slist *ves_curl_header = 0;
+static struct curl_slist *ves_curl_header_gzip = 0;    // same, for compressed bodies
+
 int ves_execute(const char* content, const char *domain, const char *event_type, const char *priority) {
+    long int start = stages_start();
+    char *post_data = ves_render(content, domain, event_type, priority);
+    if(post_data == 0) {
+        log_error("ves_render() failed");
+        goto failed;
+    }
+
+    // the sender takes ownership of post_data, even on failure
+    int rc = ves_sender_enqueue(post_data, domain, false, ves_sender_priority(priority));
+    post_data = 0;
+    if(rc != 0) {
+        log_error("ves_sender_enqueue() failed");
+        goto failed;
+    }
+
+    ves_common_header.seq_id++;
+    stages_record(STAGE_VES_EXECUTE, start);
+
+    return 0;
+
+failed:
+    free(post_data);
+    stages_record(STAGE_VES_EXECUTE, start);
+
+    return 1;
+}
+
+/**
+ * replaces the common event header placeholders of content, using the current ves_common_header.seq_id
+ * returns a newly allocated event, or 0 on failure
+*/
+char *ves_render(const char* content, const char *domain, const char *event_type, const char *priority) {
     char timestampMicrosec[32];
-    char* timestampISO3milisec;
+    char timestampISO3milisec[TIMESTAMP_SIZE];
     char seqId[32];
 
-    timestampISO3milisec = get_netconf_timestamp_with_miliseconds(0);
-    sprintf(timestampMicrosec, "%lu", get_microseconds_since_epoch());
+    // one clock read for both timestamps
+    long int now = timestamp_now_us();
+    timestamp_format_netconf(timestampISO3milisec, now);
+    sprintf(timestampMicrosec, "%lu", now);
     sprintf(seqId, "%d", ves_common_header.seq_id);
 
-    //log("*******ves_execute.....");
-    //log_error("*******ves_execute.....");
-    
     char *post_data = strdup(content);
     if(post_data == 0) {
         log_error("strdup failed");
@@ -118,43 +153,156 @@ int ves_execute(const char* content, const char *domain, const char *event_type,
         goto failed;
     }
 
-    //send request
-    int response_code;
-    char *response = 0;
-    int rc;
-      rc = ves_http_request(ves_config->ves.url, ves_config->ves.username, ves_config->ves.password, "POST", post_data, &response_code, &response);
-//    rc = ves_dummy_http_request(ves_config->ves.url, ves_config->ves.username, ves_config->ves.password, "POST", post_data, &response_code, &response);
-	
-    if(rc != 0) {
-        log_error("ves_http_request() failed");
-        goto failed;
+    return post_data;
+
+failed:
+    free(post_data);
+
+    return 0;
+}
+
+/**
+ * precompiles an event template: the common event header fields that only change with ves_set_info()
+ * and the caller's invariant fields are substituted now, everything else is left to ves_render_template()
+*/
+ves_template_t *ves_compile(const char *content, const char *domain, const char *event_type, const char *priority, const ves_template_field_t *invariant, int invariant_len) {
+    ves_template_field_t fields[VES_TEMPLATE_MAX_FIELDS] = {
+        {"domain", domain},
+        {"eventType", event_type},
+        {"priority", priority},
+        {"managed-element-id", ves_common_header.info.managed_element_id},
+        {"node-id", ves_config->info.node_id},
+        {"vendor", ves_common_header.info.vendor},
+    };
+    int fields_len = 6;
+
+    if(fields_len + invariant_len > VES_TEMPLATE_MAX_FIELDS) {
+        log_error("too many invariant fields");
+        return 0;
+    }
+
+    for(int i = 0; i < invariant_len; i++) {
+        fields[fields_len] = invariant[i];
+        fields_len++;
     }
 
-    log("response_code = %d", response_code);
-    if(response) {
-        log("response = %s", response);
+    ves_template_t *template = ves_template_compile(content, fields, fields_len);
+    if(template == 0) {
+        log_error("ves_template_compile() failed");
+        return 0;
     }
 
-    free(response);
-    if(response_code > 399) {
-        log_error("failure http response code: %d", response_code);
+    return template;
+}
+
+/**
+ * renders a precompiled event, filling the volatile common header fields and the caller's fields
+ * returns a newly allocated event, or 0 on failure
+*/
+char *ves_render_template(const ves_template_t *template, const ves_template_field_t *fields, int fields_len) {
+    char timestampMicrosec[32];
+    char seqId[32];
+    ves_template_field_t all[VES_TEMPLATE_MAX_FIELDS];
+
+    if(template == 0) {
+        log_error("template not compiled");
+        return 0;
+    }
+
+    if(fields_len + 3 > VES_TEMPLATE_MAX_FIELDS) {
+        log_error("too many fields");
+        return 0;
+    }
+
+    char timestampISO3milisec[TIMESTAMP_SIZE];
+    long int now = timestamp_now_us();
+    timestamp_format_netconf(timestampISO3milisec, now);
+    sprintf(timestampMicrosec, "%lu", now);
+    sprintf(seqId, "%d", ves_common_header.seq_id);
+
+    all[0] = (ves_template_field_t){"seqId", seqId};
+    all[1] = (ves_template_field_t){"timestampMicrosec", timestampMicrosec};
+    all[2] = (ves_template_field_t){"timestampISO3milisec", timestampISO3milisec};
+    for(int i = 0; i < fields_len; i++) {
+        all[3 + i] = fields[i];
+    }
+
+    char *post_data = ves_template_render(template, all, fields_len + 3);
+
+    return post_data;
+}
+
+// priority has to be the one the template was compiled with
+int ves_execute_template(const ves_template_t *template, const ves_template_field_t *fields, int fields_len, const char *domain, const char *priority) {
+    long int start = stages_start();
+    char *post_data = ves_render_template(template, fields, fields_len);
+    if(post_data == 0) {
+        log_error("ves_render_template() failed");
+        goto failed;
+    }
+
+    // the sender takes ownership of post_data, even on failure
+    int rc = ves_sender_enqueue(post_data, domain, false, ves_sender_priority(priority));
+    if(rc != 0) {
+        log_error("ves_sender_enqueue() failed");
         goto failed;
     }
 
-    
     ves_common_header.seq_id++;
-    free(post_data);
-    free(timestampISO3milisec);
+    stages_record(STAGE_VES_EXECUTE, start);
 
     return 0;
 
 failed:
-    free(post_data);
-    free(timestampISO3milisec);
+    stages_record(STAGE_VES_EXECUTE, start);
 
     return 1;
 }
 
+/**
+ * builds {"eventList": [...]} out of {"event": ...} events
+ * returns a newly allocated body, or 0 on failure
+*/
+char *ves_event_list(char **events, int count) {
+    char *post_data = 0;
+    size_t post_data_size = 0;
+
+    FILE *f = open_memstream(&post_data, &post_data_size);
+    if(f == 0) {
+        log_error("open_memstream failed");
+        return 0;
+    }
+
+    fprintf(f, "{\"eventList\": [");
+    for(int i = 0; i < count; i++) {
+        const char *start = ves_event_unwrap(events[i]);
+        const char *end = start ? ves_event_unwrap_end(events[i]) : 0;
+        if((start == 0) || (end == 0)) {
+            log_error("event %d is not an {\"event\": ...} object", i);
+            goto failed;
+        }
+
+        fprintf(f, "%s%.*s", (i == 0) ? "" : ",", (int)(end - start + 1), start);
+    }
+    fprintf(f, "]}");
+
+    if(fclose(f) != 0) {
+        f = 0;
+        log_error("fclose failed");
+        goto failed;
+    }
+
+    return post_data;
+
+failed:
+    if(f) {
+        fclose(f);
+    }
+    free(post_data);
+
+    return 0;
+}
+
 int ves_vsftp_daemon_init(void) {
     return system("/usr/sbin/vsftpd &");
 }
@@ -171,60 +319,105 @@ int ves_sftp_daemon_deinit(void) {
     return system("killall -9 sshd");
 }
 
-static int ves_http_request(const char *url, const char *username, const char* password, const char *method, const char *send_data, int *response_code, char **recv_data) {
-    const char *send_data_good = send_data;
-    if(send_data_good == 0) {
-        send_data_good = "";
+/**
+ * prepare what all curl handles share: the header lists
+*/
+int ves_http_init(void) {
+    CURLcode res = curl_global_init(CURL_GLOBAL_DEFAULT);
+    if(res != CURLE_OK) {
+        log_error("curl_global_init() error");
+        goto failed;
     }
-    CURL *curl = curl_easy_init();
+    ves_curl_global = true;
 
+    ves_curl_header = ves_http_header_new(false);
+    if(ves_curl_header == 0) {
+        log_error("ves_http_header_new() failed");
+        goto failed;
+    }
 
+    ves_curl_header_gzip = ves_http_header_new(true);
+    if(ves_curl_header_gzip == 0) {
+        log_error("ves_http_header_new() failed");
+        goto failed;
+    }
+
+    return 0;
+
+failed:
+    ves_http_free();
+    return 1;
+}
+
+void ves_http_free(void) {
+    curl_slist_free_all(ves_curl_header);
+    ves_curl_header = 0;
+    curl_slist_free_all(ves_curl_header_gzip);
+    ves_curl_header_gzip = 0;
+
+    if(ves_curl_global) {
+        curl_global_cleanup();
+        ves_curl_global = false;
+    }
+}
+
+/**
+ * new long lived POST handle for one collector
+ *   the handle keeps its connection to the collector alive and caches the TLS session between requests
+ *   per request only CURLOPT_URL, CURLOPT_POSTFIELDS(SIZE), CURLOPT_WRITEDATA (a ves_http_response_t)
+ *   and, for gzip bodies, CURLOPT_HTTPHEADER (ves_http_headers()) are set
+*/
+CURL *ves_http_handle_new(const char *username, const char *password) {
+    CURL *curl = curl_easy_init();
     if(curl == 0) {
         log_error("curl_easy_init() error");
         goto failed;
     }
 
-    //log("****curl_easy_init : %s", send_data);
+    CURLcode res = CURLE_OK;
+    res = curl_easy_setopt(curl, CURLOPT_HTTPHEADER, ves_curl_header);
+    if(res != CURLE_OK) {
+        log_error("curl_easy_setopt() error");
+        goto failed;
+    }
 
-    // set curl options
-    struct curl_slist *header = 0;
-    header = curl_slist_append(header, "Content-Type: application/json");
-    if(!header) {
-        log_error("curl_slist_append() failed");
+    res = curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 1L);     //seconds timeout for a connection
+    if(res != CURLE_OK) {
+        log_error("curl_easy_setopt() error");
         goto failed;
     }
-    header = curl_slist_append(header, "Accept: application/json");
-    if(!header) {
-        log_error("curl_slist_append() failed");
+
+    res = curl_easy_setopt(curl, CURLOPT_TIMEOUT, 1L);            //seconds timeout for an operation
+    if(res != CURLE_OK) {
+        log_error("curl_easy_setopt() error");
         goto failed;
     }
 
-    header = curl_slist_append(header, "X-MinorVersion: 1");
-    if(!header) {
-        log_error("curl_slist_append() failed");
+    res = curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    if(res != CURLE_OK) {
+        log_error("curl_easy_setopt() error");
         goto failed;
     }
 
-    CURLcode res = CURLE_OK;
-    res = curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header);
+    res = curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, 30L);
     if(res != CURLE_OK) {
         log_error("curl_easy_setopt() error");
         goto failed;
     }
 
-    res = curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 1L);     //seconds timeout for a connection
+    res = curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, 15L);
     if(res != CURLE_OK) {
         log_error("curl_easy_setopt() error");
         goto failed;
     }
 
-    res = curl_easy_setopt(curl, CURLOPT_TIMEOUT, 1L);            //seconds timeout for an operation
+    res = curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
     if(res != CURLE_OK) {
         log_error("curl_easy_setopt() error");
         goto failed;
     }
 
-    res = curl_easy_setopt(curl, CURLOPT_FRESH_CONNECT, 1L);
+    res = curl_easy_setopt(curl, CURLOPT_SSL_SESSIONID_CACHE, 1L);
     if(res != CURLE_OK) {
         log_error("curl_easy_setopt() error");
         goto failed;
@@ -262,105 +455,75 @@ static int ves_http_request(const char *url, const char *username, const char* p
         goto failed;
     }
 
-
-    res = curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method);
-    if(res != CURLE_OK) {
-        log_error("curl_easy_setopt() error");
-        goto failed;
-    }
-
-    res = curl_easy_setopt(curl, CURLOPT_POSTFIELDS, send_data_good);
+    res = curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "POST");
     if(res != CURLE_OK) {
         log_error("curl_easy_setopt() error");
         goto failed;
     }
 
-    res = curl_easy_setopt(curl, CURLOPT_URL, url);
+    res = curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_write_cb);
     if(res != CURLE_OK) {
         log_error("curl_easy_setopt() error");
         goto failed;
     }
 
-    char *credentials = 0;
     if((username) && (password)) {
-        asprintf(&credentials, "%s:%s", username, password);
-        if(credentials == 0) {
-            log_error("asprintf() failed");
-            goto failed;
-        }
-
-        res = curl_easy_setopt(curl, CURLOPT_USERPWD, credentials);
+        res = curl_easy_setopt(curl, CURLOPT_USERNAME, username);
         if(res != CURLE_OK) {
             log_error("curl_easy_setopt() error");
             goto failed;
         }
-    }
 
-    struct memory response_data = {0};
-    if(recv_data) {
-        res = curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_write_cb);
-        if(res != CURLE_OK) {
-            log_error("curl_easy_setopt() error");
-            goto failed;
-        }
-        res = curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&response_data);
+        res = curl_easy_setopt(curl, CURLOPT_PASSWORD, password);
         if(res != CURLE_OK) {
             log_error("curl_easy_setopt() error");
             goto failed;
         }
     }
-   
-    log("%s-ing cURL to url=\"%s\" with body=\"%s\"... ", method, url, send_data_good);
-//    log("####curl_easy_perform %p", curl)
-    res = curl_easy_perform(curl);
-    if(res != CURLE_OK) {
-    log_error("curl_easy_perform() failed");
-        goto failed;
-    }
-    //log("****curl_easy_getinfo**** curl %s CURLINFO_RESPONSE_CODE %d", curl, CURLINFO_RESPONSE_CODE);
-    if(response_code) {
-        long http_rc;
-        res = curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_rc);
-        if(res != CURLE_OK) {
-            log_error("curl_easy_getinfo() failed");
-            goto failed;
-        }
-        *response_code = http_rc;
-    }
-    
-    if(recv_data) {
-        *recv_data = response_data.response;
-    }
 
-    free(credentials);
-    curl_slist_free_all(header);
-    curl_easy_cleanup(curl);
-    return 0;
+    return curl;
 
 failed:
-    free(credentials);
-    curl_slist_free_all(header);
     curl_easy_cleanup(curl);
-    return 1;
+    return 0;
+}
+
+// header list for plain or gzip Content-Encoding bodies, owned by ves_internal
+struct curl_slist *ves_http_headers(bool gzip) {
+    return gzip ? ves_curl_header_gzip : ves_curl_header;
 }
 
-static int ves_dummy_http_request(const char *url, const char *username, const char* password, const char *method, const char *send_data, int *response_code, char **recv_data) {
-    log("ves_dummy_http_request");
-    log("======================");
-    log("url: %s", url);
-    log("username: %s", username);
-    log("password: %s", password);
-    log("method: %s", method);
-    log("send_data: %s", send_data);
-    *response_code = 200;
-    asprintf(recv_data, "DUMMY RESPONSE");
+static struct curl_slist *ves_http_header_new(bool gzip) {
+    const char *lines[] = {
+        "Content-Type: application/json",
+        "Accept: application/json",
+        "X-MinorVersion: 1",
+        "Expect:",                      // no "Expect: 100-continue" round trip for larger bodies
+        "Content-Encoding: gzip",
+    };
+    int lines_len = sizeof(lines) / sizeof(lines[0]);
+    struct curl_slist *header = 0;
 
-    return 0;
+    if(!gzip) {
+        lines_len--;
+    }
+
+    for(int i = 0; i < lines_len; i++) {
+        struct curl_slist *next = curl_slist_append(header, lines[i]);
+        if(next == 0) {
+            log_error("curl_slist_append() failed");
+            curl_slist_free_all(header);
+            return 0;
+        }
+        header = next;
+    }
+
+    return header;
 }
 
 static size_t curl_write_cb(void *data, size_t size, size_t nmemb, void *userp) {
     size_t realsize = size * nmemb;
-    struct memory *mem = (struct memory *)userp;
+    ves_http_response_t *mem = (ves_http_response_t *)userp;
 
     char *ptr = realloc(mem->response, mem->size + realsize + 1);
     if(ptr == NULL) {
@@ -375,3 +538,30 @@ static size_t curl_write_cb(void *data, size_t size, size_t nmemb, void *userp)
 
     return realsize;
 }
+
+// returns the opening brace of the object inside {"event": {...}}
+static const char *ves_event_unwrap(const char *event) {
+    const char *key = strstr(event, "\"event\"");
+    if(key == 0) {
+        return 0;
+    }
+
+    return strchr(key, '{');
+}
+
+// returns the closing brace of the object inside {"event": {...}}, i.e. the last but one '}'
+static const char *ves_event_unwrap_end(const char *event) {
+    const char *end = strrchr(event, '}');
+    if(end == 0) {
+        return 0;
+    }
+
+    while(end > event) {
+        end--;
+        if(*end == '}') {
+            return end;
+        }
+    }
+
+    return 0;
+}
@@ -25,16 +25,32 @@
 
 #include "common/config.h"
 #include "ves.h"
+#include "ves_template.h"
+#include <curl/curl.h>
 
 typedef struct ves_common_header {
     ves_info_t info;
     int seq_id;
 } ves_common_header_t;
 
+typedef struct ves_http_response {
+    char *response;
+    size_t size;
+} ves_http_response_t;
+
 extern const config_t *ves_config;
 extern ves_common_header_t ves_common_header;
 
 int ves_execute(const char* content, const char *domain, const char *event_type, const char *priority);
+char *ves_render(const char* content, const char *domain, const char *event_type, const char *priority);
+ves_template_t *ves_compile(const char *content, const char *domain, const char *event_type, const char *priority, const ves_template_field_t *invariant, int invariant_len);
+char *ves_render_template(const ves_template_t *template, const ves_template_field_t *fields, int fields_len);
+int ves_execute_template(const ves_template_t *template, const ves_template_field_t *fields, int fields_len, const char *domain, const char *priority);
+char *ves_event_list(char **events, int count);
+int ves_http_init(void);
+void ves_http_free(void);
+CURL *ves_http_handle_new(const char *username, const char *password);
+struct curl_slist *ves_http_headers(bool gzip);
 int ves_vsftp_daemon_init(void);
 int ves_vsftp_daemon_deinit(void);
 int ves_sftp_daemon_init(void);
@@ -0,0 +1,760 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+
+#define _GNU_SOURCE
+
+#include "ves_outbox.h"
+#include "common/log.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#define VES_OUTBOX_SEGMENT_SIZE     (1024 * 1024)
+#define VES_OUTBOX_ACK_WINDOW       65536           // acks tracked ahead of the cursor
+#define VES_OUTBOX_FLAG_BATCH       0x1
+#define VES_OUTBOX_PRIORITY_SHIFT   8       // priority + 1 in bits 8-15, 0 in records written before it was kept
+
+typedef struct ves_outbox_record {
+    uint32_t len;               // payload bytes
+    uint32_t crc;               // crc32 over the header from id on, and the payload
+    uint64_t id;
+    uint32_t flags;
+    char domain[28];
+} ves_outbox_record_t;
+
+typedef struct ves_outbox_segment {
+    uint64_t first_id;
+    off_t size;
+} ves_outbox_segment_t;
+
+typedef struct ves_outbox_reader {
+    int segment;
+    int fd;
+    off_t offset;
+    uint64_t min_id;
+} ves_outbox_reader_t;
+
+struct ves_outbox {
+    pthread_mutex_t mutex;
+    char *directory;
+    int dirfd;
+    int max_segments;
+
+    ves_outbox_segment_t *segments;     // sorted by first_id, the last one is active
+    int segments_len;
+    int segments_size;
+    int fd;                             // active segment
+    int retired_fd;                     // the segment rotated away, until it is synced
+    bool dirty;
+    bool dirfd_dirty;                   // a segment was created since the last sync
+
+    uint64_t next;
+    uint64_t cursor;                    // all ids <= cursor are acknowledged
+    int ack_fd;
+    uint8_t *ack_bits;                  // acks above cursor + 1, by id % window
+
+    ves_outbox_reader_t *readers;
+    int readers_len;
+    int legacy_reader;
+};
+
+static int ves_outbox_load_segments(ves_outbox_t *outbox);
+static int ves_outbox_recover_active(ves_outbox_t *outbox);
+static int ves_outbox_open_segment(ves_outbox_t *outbox, uint64_t first_id, bool create);
+static int ves_outbox_rotate(ves_outbox_t *outbox);
+static void ves_outbox_drop_oldest(ves_outbox_t *outbox);
+static void ves_outbox_reader_rewind(ves_outbox_t *outbox, ves_outbox_reader_t *reader, uint64_t id);
+static int ves_outbox_reader_next(ves_outbox_t *outbox, int index, uint64_t *id, char **post_data, char *domain, size_t domain_size, bool *batch);
+static void ves_outbox_cursor_advanced(ves_outbox_t *outbox);
+static void ves_outbox_reader_close(ves_outbox_reader_t *reader);
+static uint32_t ves_outbox_crc(const ves_outbox_record_t *record, const char *payload);
+static int ves_outbox_segment_compare(const void *a, const void *b);
+
+ves_outbox_t *ves_outbox_new(const char *directory, int max_segments, int readers, int legacy_reader) {
+    ves_outbox_t *outbox = (ves_outbox_t *)calloc(1, sizeof(ves_outbox_t));
+    if(outbox == 0) {
+        log_error("calloc failed");
+        return 0;
+    }
+
+    pthread_mutex_init(&outbox->mutex, 0);
+    outbox->max_segments = max_segments;
+    outbox->next = 1;
+    outbox->cursor = 0;
+    outbox->dirfd = -1;
+    outbox->fd = -1;
+    outbox->retired_fd = -1;
+    outbox->ack_fd = -1;
+
+    outbox->directory = strdup(directory);
+    if(outbox->directory == 0) {
+        log_error("strdup failed");
+        goto failure;
+    }
+
+    if((readers < 1) || (legacy_reader < 0) || (legacy_reader >= readers)) {
+        log_error("invalid readers");
+        goto failure;
+    }
+
+    outbox->readers = (ves_outbox_reader_t *)calloc(readers, sizeof(ves_outbox_reader_t));
+    if(outbox->readers == 0) {
+        log_error("calloc failed");
+        goto failure;
+    }
+    outbox->readers_len = readers;
+    outbox->legacy_reader = legacy_reader;
+    for(int i = 0; i < readers; i++) {
+        outbox->readers[i].fd = -1;
+    }
+
+    if((mkdir(directory, 0755) != 0) && (errno != EEXIST)) {
+        log_error("mkdir(%s) failed: %s", directory, strerror(errno));
+        goto failure;
+    }
+
+    outbox->dirfd = open(directory, O_RDONLY | O_DIRECTORY);
+    if(outbox->dirfd == -1) {
+        log_error("open(%s) failed: %s", directory, strerror(errno));
+        goto failure;
+    }
+
+    outbox->ack_bits = (uint8_t *)calloc(VES_OUTBOX_ACK_WINDOW / 8, 1);
+    if(outbox->ack_bits == 0) {
+        log_error("calloc failed");
+        goto failure;
+    }
+
+    outbox->ack_fd = openat(outbox->dirfd, "ack", O_RDWR | O_CREAT, 0644);
+    if(outbox->ack_fd == -1) {
+        log_error("open ack failed: %s", strerror(errno));
+        goto failure;
+    }
+
+    uint64_t cursor = 0;
+    if(pread(outbox->ack_fd, &cursor, sizeof(cursor), 0) == sizeof(cursor)) {
+        outbox->cursor = cursor;
+    }
+
+    if(ves_outbox_load_segments(outbox) != 0) {
+        log_error("ves_outbox_load_segments failed");
+        goto failure;
+    }
+
+    if(ves_outbox_recover_active(outbox) != 0) {
+        log_error("ves_outbox_recover_active failed");
+        goto failure;
+    }
+
+    if(outbox->cursor >= outbox->next) {
+        outbox->cursor = outbox->next - 1;
+    }
+
+    for(int i = 0; i < outbox->readers_len; i++) {
+        ves_outbox_reader_rewind(outbox, &outbox->readers[i], outbox->cursor + 1);
+    }
+
+    if(outbox->next - 1 > outbox->cursor) {
+        log("ves outbox: %" PRIu64 " unacknowledged events in %s", outbox->next - 1 - outbox->cursor, directory);
+    }
+
+    return outbox;
+
+failure:
+    ves_outbox_free(outbox);
+    return 0;
+}
+
+void ves_outbox_free(ves_outbox_t *outbox) {
+    if(outbox == 0) {
+        return;
+    }
+
+    for(int i = 0; i < outbox->readers_len; i++) {
+        ves_outbox_reader_close(&outbox->readers[i]);
+    }
+    free(outbox->readers);
+
+    if(outbox->retired_fd != -1) {
+        fdatasync(outbox->retired_fd);
+        close(outbox->retired_fd);
+        outbox->retired_fd = -1;
+    }
+
+    if(outbox->fd != -1) {
+        fdatasync(outbox->fd);
+        close(outbox->fd);
+        outbox->fd = -1;
+    }
+
+    if(outbox->ack_fd != -1) {
+        close(outbox->ack_fd);
+        outbox->ack_fd = -1;
+    }
+
+    if(outbox->dirfd != -1) {
+        close(outbox->dirfd);
+    }
+
+    free(outbox->segments);
+    free(outbox->ack_bits);
+    free(outbox->directory);
+    pthread_mutex_destroy(&outbox->mutex);
+    free(outbox);
+}
+
+int ves_outbox_append(ves_outbox_t *outbox, const char *post_data, const char *domain, bool batch, int priority, uint64_t *id) {
+    pthread_mutex_lock(&outbox->mutex);
+    if(outbox->fd == -1) {
+        log_error("outbox not open");
+        goto failure;
+    }
+
+    if(outbox->segments[outbox->segments_len - 1].size >= VES_OUTBOX_SEGMENT_SIZE) {
+        if(ves_outbox_rotate(outbox) != 0) {
+            log_error("ves_outbox_rotate failed");
+            goto failure;
+        }
+    }
+
+    ves_outbox_record_t record;
+    memset(&record, 0, sizeof(record));
+    record.len = strlen(post_data);
+    record.id = outbox->next;
+    record.flags = batch ? VES_OUTBOX_FLAG_BATCH : 0;
+    record.flags |= (uint32_t)((priority + 1) & 0xff) << VES_OUTBOX_PRIORITY_SHIFT;
+    snprintf(record.domain, sizeof(record.domain), "%s", domain ? domain : "");
+    record.crc = ves_outbox_crc(&record, post_data);
+
+    struct iovec iov[2] = {
+        { .iov_base = &record, .iov_len = sizeof(record) },
+        { .iov_base = (void *)post_data, .iov_len = record.len },
+    };
+
+    ssize_t expected = sizeof(record) + record.len;
+    ssize_t written = writev(outbox->fd, iov, 2);
+    if(written != expected) {
+        log_error("writev failed: %s", (written == -1) ? strerror(errno) : "short write");
+        // drop a torn record, so the next append starts on a record boundary
+        if(ftruncate(outbox->fd, outbox->segments[outbox->segments_len - 1].size) != 0) {
+            log_error("ftruncate failed: %s", strerror(errno));
+        }
+        goto failure;
+    }
+
+    outbox->segments[outbox->segments_len - 1].size += written;
+    outbox->dirty = true;
+    *id = outbox->next;
+    outbox->next++;
+    pthread_mutex_unlock(&outbox->mutex);
+
+    return 0;
+
+failure:
+    pthread_mutex_unlock(&outbox->mutex);
+    return 1;
+}
+
+/**
+ * the descriptors are taken under the lock, the disk is waited for outside of it, so
+ * appends of other threads go on meanwhile; on failure the records stay marked dirty
+ * and *synced keeps its old value
+*/
+int ves_outbox_sync(ves_outbox_t *outbox, uint64_t *synced) {
+    pthread_mutex_lock(&outbox->mutex);
+    uint64_t last = outbox->next - 1;
+    if((outbox->fd == -1) || ((!outbox->dirty) && (!outbox->dirfd_dirty) && (outbox->retired_fd == -1))) {
+        pthread_mutex_unlock(&outbox->mutex);
+        *synced = last;
+        return 0;
+    }
+
+    // a rotation may close the active segment before fdatasync() returns
+    int fd = dup(outbox->fd);
+    int retired_fd = outbox->retired_fd;
+    bool dirfd_dirty = outbox->dirfd_dirty;
+    outbox->retired_fd = -1;
+    outbox->dirty = false;
+    outbox->dirfd_dirty = false;
+    pthread_mutex_unlock(&outbox->mutex);
+
+    int rc = 0;
+    if(retired_fd != -1) {
+        if(fdatasync(retired_fd) != 0) {
+            log_error("fdatasync failed: %s", strerror(errno));
+            rc = 1;
+        }
+        close(retired_fd);
+    }
+
+    if((fd == -1) || (fdatasync(fd) != 0)) {
+        log_error("fdatasync failed: %s", strerror(errno));
+        rc = 1;
+    }
+    if(fd != -1) {
+        close(fd);
+    }
+
+    if(dirfd_dirty && (fsync(outbox->dirfd) != 0)) {
+        log_error("fsync failed: %s", strerror(errno));
+        rc = 1;
+    }
+
+    if(rc != 0) {
+        pthread_mutex_lock(&outbox->mutex);
+        outbox->dirty = true;
+        outbox->dirfd_dirty |= dirfd_dirty;
+        pthread_mutex_unlock(&outbox->mutex);
+        return rc;
+    }
+
+    *synced = last;
+
+    return 0;
+}
+
+void ves_outbox_ack(ves_outbox_t *outbox, uint64_t id) {
+    pthread_mutex_lock(&outbox->mutex);
+    if((id <= outbox->cursor) || (id >= outbox->next)) {
+        pthread_mutex_unlock(&outbox->mutex);
+        return;
+    }
+
+    if(id - outbox->cursor > VES_OUTBOX_ACK_WINDOW) {
+        // too far ahead to be tracked, it is sent again on the next replay
+        pthread_mutex_unlock(&outbox->mutex);
+        return;
+    }
+
+    outbox->ack_bits[(id % VES_OUTBOX_ACK_WINDOW) / 8] |= 1 << (id % 8);
+
+    uint64_t cursor = outbox->cursor;
+    while((cursor + 1 < outbox->next) && (outbox->ack_bits[((cursor + 1) % VES_OUTBOX_ACK_WINDOW) / 8] & (1 << ((cursor + 1) % 8)))) {
+        cursor++;
+        outbox->ack_bits[(cursor % VES_OUTBOX_ACK_WINDOW) / 8] &= ~(1 << (cursor % 8));
+    }
+
+    if(cursor != outbox->cursor) {
+        outbox->cursor = cursor;
+        ves_outbox_cursor_advanced(outbox);
+    }
+    pthread_mutex_unlock(&outbox->mutex);
+}
+
+bool ves_outbox_acked(ves_outbox_t *outbox, uint64_t id) {
+    bool acked = false;
+
+    pthread_mutex_lock(&outbox->mutex);
+    if(id <= outbox->cursor) {
+        acked = true;
+    }
+    else if(id - outbox->cursor <= VES_OUTBOX_ACK_WINDOW) {
+        acked = (outbox->ack_bits[(id % VES_OUTBOX_ACK_WINDOW) / 8] & (1 << (id % 8))) != 0;
+    }
+    pthread_mutex_unlock(&outbox->mutex);
+
+    return acked;
+}
+
+uint64_t ves_outbox_first_unacked(ves_outbox_t *outbox) {
+    pthread_mutex_lock(&outbox->mutex);
+    uint64_t id = outbox->cursor + 1;
+    pthread_mutex_unlock(&outbox->mutex);
+
+    return id;
+}
+
+uint64_t ves_outbox_next_id(ves_outbox_t *outbox) {
+    pthread_mutex_lock(&outbox->mutex);
+    uint64_t id = outbox->next;
+    pthread_mutex_unlock(&outbox->mutex);
+
+    return id;
+}
+
+void ves_outbox_rewind(ves_outbox_t *outbox, int reader, uint64_t id) {
+    if((reader < 0) || (reader >= outbox->readers_len)) {
+        return;
+    }
+
+    pthread_mutex_lock(&outbox->mutex);
+    ves_outbox_reader_rewind(outbox, &outbox->readers[reader], id);
+    pthread_mutex_unlock(&outbox->mutex);
+}
+
+int ves_outbox_read(ves_outbox_t *outbox, int reader, uint64_t *id, char **post_data, char *domain, size_t domain_size, bool *batch) {
+    if((reader < 0) || (reader >= outbox->readers_len)) {
+        log_error("invalid reader %d", reader);
+        return -1;
+    }
+
+    pthread_mutex_lock(&outbox->mutex);
+    int rc = ves_outbox_reader_next(outbox, reader, id, post_data, domain, domain_size, batch);
+    pthread_mutex_unlock(&outbox->mutex);
+
+    return rc;
+}
+
+static void ves_outbox_reader_rewind(ves_outbox_t *outbox, ves_outbox_reader_t *reader, uint64_t id) {
+    ves_outbox_reader_close(reader);
+
+    reader->segment = 0;
+    for(int i = outbox->segments_len - 1; i >= 0; i--) {
+        if(outbox->segments[i].first_id <= id) {
+            reader->segment = i;
+            break;
+        }
+    }
+
+    reader->offset = 0;
+    reader->min_id = id;
+}
+
+// records of the other readers are passed over by their header, without reading the payload
+static int ves_outbox_reader_next(ves_outbox_t *outbox, int index, uint64_t *id, char **post_data, char *domain, size_t domain_size, bool *batch) {
+    ves_outbox_reader_t *reader = &outbox->readers[index];
+    ves_outbox_record_t record;
+
+    while(reader->segment < outbox->segments_len) {
+        ves_outbox_segment_t *segment = &outbox->segments[reader->segment];
+
+        if(reader->fd == -1) {
+            char filename[64];
+            sprintf(filename, "seg-%016" PRIx64 ".log", segment->first_id);
+            reader->fd = openat(outbox->dirfd, filename, O_RDONLY);
+            if(reader->fd == -1) {
+                log_error("open %s failed: %s", filename, strerror(errno));
+                return -1;
+            }
+        }
+
+        if(reader->offset + (off_t)sizeof(record) > segment->size) {
+            if(reader->segment == outbox->segments_len - 1) {
+                return 0;
+            }
+
+            ves_outbox_reader_close(reader);
+            reader->segment++;
+            reader->offset = 0;
+            continue;
+        }
+
+        if(pread(reader->fd, &record, sizeof(record), reader->offset) != sizeof(record)) {
+            log_error("pread failed");
+            return -1;
+        }
+
+        if(reader->offset + (off_t)sizeof(record) + record.len > segment->size) {
+            log_error("truncated record in segment %016" PRIx64 ", skipping the rest of it", segment->first_id);
+            reader->offset = segment->size;
+            continue;
+        }
+
+        int priority = (int)((record.flags >> VES_OUTBOX_PRIORITY_SHIFT) & 0xff) - 1;
+        if((priority < 0) || (priority >= outbox->readers_len)) {
+            priority = outbox->legacy_reader;
+        }
+
+        if((priority != index) || (record.id < reader->min_id)) {
+            reader->offset += sizeof(record) + record.len;
+            continue;
+        }
+
+        char *payload = (char *)malloc(record.len + 1);
+        if(payload == 0) {
+            log_error("malloc failed");
+            return -1;
+        }
+
+        if(pread(reader->fd, payload, record.len, reader->offset + sizeof(record)) != record.len) {
+            log_error("truncated record in segment %016" PRIx64 ", skipping the rest of it", segment->first_id);
+            free(payload);
+            reader->offset = segment->size;
+            continue;
+        }
+        payload[record.len] = 0;
+
+        if(ves_outbox_crc(&record, payload) != record.crc) {
+            log_error("corrupted record in segment %016" PRIx64 ", skipping the rest of it", segment->first_id);
+            free(payload);
+            reader->offset = segment->size;
+            continue;
+        }
+
+        reader->offset += sizeof(record) + record.len;
+
+        *id = record.id;
+        *post_data = payload;
+        *batch = (record.flags & VES_OUTBOX_FLAG_BATCH) != 0;
+        snprintf(domain, domain_size, "%.*s", (int)sizeof(record.domain), record.domain);
+
+        return 1;
+    }
+
+    return 0;
+}
+
+static int ves_outbox_load_segments(ves_outbox_t *outbox) {
+    DIR *dir = fdopendir(dup(outbox->dirfd));
+    if(dir == 0) {
+        log_error("fdopendir failed: %s", strerror(errno));
+        return 1;
+    }
+
+    struct dirent *entry;
+    while((entry = readdir(dir)) != 0) {
+        uint64_t first_id;
+        if(sscanf(entry->d_name, "seg-%" SCNx64 ".log", &first_id) != 1) {
+            continue;
+        }
+
+        struct stat st;
+        if(fstatat(outbox->dirfd, entry->d_name, &st, 0) != 0) {
+            continue;
+        }
+
+        if(outbox->segments_len == outbox->segments_size) {
+            int size = outbox->segments_size ? outbox->segments_size * 2 : 16;
+            ves_outbox_segment_t *segments = (ves_outbox_segment_t *)realloc(outbox->segments, sizeof(ves_outbox_segment_t) * size);
+            if(segments == 0) {
+                log_error("realloc failed");
+                closedir(dir);
+                return 1;
+            }
+            outbox->segments = segments;
+            outbox->segments_size = size;
+        }
+
+        outbox->segments[outbox->segments_len].first_id = first_id;
+        outbox->segments[outbox->segments_len].size = st.st_size;
+        outbox->segments_len++;
+    }
+    closedir(dir);
+
+    qsort(outbox->segments, outbox->segments_len, sizeof(ves_outbox_segment_t), ves_outbox_segment_compare);
+
+    return 0;
+}
+
+// finds the next id in the active segment and cuts off a torn tail
+static int ves_outbox_recover_active(ves_outbox_t *outbox) {
+    if(outbox->segments_len == 0) {
+        outbox->next = outbox->cursor + 1;
+        return ves_outbox_open_segment(outbox, outbox->next, true);
+    }
+
+    ves_outbox_segment_t *active = &outbox->segments[outbox->segments_len - 1];
+    if(ves_outbox_open_segment(outbox, active->first_id, false) != 0) {
+        return 1;
+    }
+
+    uint64_t next = active->first_id;
+    off_t offset = 0;
+    ves_outbox_record_t record;
+    char *payload = 0;
+    while(pread(outbox->fd, &record, sizeof(record), offset) == sizeof(record)) {
+        // a torn or garbage header is not trusted with an allocation
+        if(((off_t)record.len > active->size - offset - (off_t)sizeof(record)) || (record.id != next)) {
+            break;
+        }
+
+        char *buffer = (char *)realloc(payload, record.len + 1);
+        if(buffer == 0) {
+            break;
+        }
+        payload = buffer;
+
+        if(pread(outbox->fd, payload, record.len, offset + sizeof(record)) != record.len) {
+            break;
+        }
+
+        if(ves_outbox_crc(&record, payload) != record.crc) {
+            break;
+        }
+
+        next = record.id + 1;
+        offset += sizeof(record) + record.len;
+    }
+    free(payload);
+
+    if(offset != active->size) {
+        log_error("ves outbox: dropping %ld bytes of torn records", (long)(active->size - offset));
+        if(ftruncate(outbox->fd, offset) != 0) {
+            log_error("ftruncate failed: %s", strerror(errno));
+            return 1;
+        }
+        active->size = offset;
+    }
+
+    outbox->next = next;
+
+    return 0;
+}
+
+static int ves_outbox_open_segment(ves_outbox_t *outbox, uint64_t first_id, bool create) {
+    char filename[64];
+    sprintf(filename, "seg-%016" PRIx64 ".log", first_id);
+
+    outbox->fd = openat(outbox->dirfd, filename, O_RDWR | O_APPEND | (create ? O_CREAT : 0), 0644);
+    if(outbox->fd == -1) {
+        log_error("open %s failed: %s", filename, strerror(errno));
+        return 1;
+    }
+
+    if(create) {
+        if(outbox->segments_len == outbox->segments_size) {
+            int size = outbox->segments_size ? outbox->segments_size * 2 : 16;
+            ves_outbox_segment_t *segments = (ves_outbox_segment_t *)realloc(outbox->segments, sizeof(ves_outbox_segment_t) * size);
+            if(segments == 0) {
+                log_error("realloc failed");
+                return 1;
+            }
+            outbox->segments = segments;
+            outbox->segments_size = size;
+        }
+
+        outbox->segments[outbox->segments_len].first_id = first_id;
+        outbox->segments[outbox->segments_len].size = 0;
+        outbox->segments_len++;
+
+        // its directory entry is made durable by the next ves_outbox_sync()
+        outbox->dirfd_dirty = true;
+    }
+
+    return 0;
+}
+
+// the full segment is left to the next ves_outbox_sync(), so appends do not wait for the disk
+static int ves_outbox_rotate(ves_outbox_t *outbox) {
+    if(outbox->retired_fd != -1) {
+        // two rotations without a sync in between, only under long bursts
+        fdatasync(outbox->retired_fd);
+        close(outbox->retired_fd);
+    }
+    outbox->retired_fd = outbox->fd;
+    outbox->fd = -1;
+
+    if(ves_outbox_open_segment(outbox, outbox->next, true) != 0) {
+        return 1;
+    }
+    outbox->dirty = false;
+
+    while((outbox->max_segments > 0) && (outbox->segments_len > outbox->max_segments)) {
+        int segments_len = outbox->segments_len;
+        ves_outbox_drop_oldest(outbox);
+        if(outbox->segments_len == segments_len) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+// outbox full: the oldest segment is given up, as if all its events were acknowledged
+static void ves_outbox_drop_oldest(ves_outbox_t *outbox) {
+    uint64_t last_id = outbox->segments[1].first_id - 1;
+    if(last_id > outbox->cursor) {
+        log_error("ves outbox full, dropping %" PRIu64 " unacknowledged events", last_id - outbox->cursor);
+
+        for(uint64_t id = outbox->cursor + 1; (id <= last_id) && (id - outbox->cursor <= VES_OUTBOX_ACK_WINDOW); id++) {
+            outbox->ack_bits[(id % VES_OUTBOX_ACK_WINDOW) / 8] &= ~(1 << (id % 8));
+        }
+
+        outbox->cursor = last_id;
+        ves_outbox_cursor_advanced(outbox);
+    }
+
+    for(int i = 0; i < outbox->readers_len; i++) {
+        if(outbox->readers[i].min_id <= last_id) {
+            ves_outbox_reader_rewind(outbox, &outbox->readers[i], last_id + 1);
+        }
+    }
+}
+
+// persists the cursor and deletes the segments it passed
+static void ves_outbox_cursor_advanced(ves_outbox_t *outbox) {
+    // losing the cursor only means events are sent again, so it is not synced
+    if(pwrite(outbox->ack_fd, &outbox->cursor, sizeof(outbox->cursor), 0) != sizeof(outbox->cursor)) {
+        log_error("pwrite ack failed: %s", strerror(errno));
+    }
+
+    // compaction: delete segments whose records are all acknowledged, never the active one
+    while((outbox->segments_len > 1) && (outbox->segments[1].first_id <= outbox->cursor + 1)) {
+        char filename[64];
+        sprintf(filename, "seg-%016" PRIx64 ".log", outbox->segments[0].first_id);
+        if((unlinkat(outbox->dirfd, filename, 0) != 0) && (errno != ENOENT)) {
+            log_error("unlinkat(%s) failed: %s", filename, strerror(errno));
+            break;
+        }
+
+        for(int i = 0; i < outbox->readers_len; i++) {
+            ves_outbox_reader_t *reader = &outbox->readers[i];
+            if(reader->segment == 0) {
+                ves_outbox_reader_close(reader);
+                reader->offset = 0;
+            }
+            else {
+                reader->segment--;
+            }
+        }
+
+        memmove(&outbox->segments[0], &outbox->segments[1], sizeof(ves_outbox_segment_t) * (outbox->segments_len - 1));
+        outbox->segments_len--;
+    }
+}
+
+static void ves_outbox_reader_close(ves_outbox_reader_t *reader) {
+    if(reader->fd != -1) {
+        close(reader->fd);
+        reader->fd = -1;
+    }
+}
+
+static uint32_t ves_outbox_crc(const ves_outbox_record_t *record, const char *payload) {
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, (const Bytef *)&record->id, sizeof(ves_outbox_record_t) - offsetof(ves_outbox_record_t, id));
+    crc = crc32(crc, (const Bytef *)payload, record->len);
+    return (uint32_t)crc;
+}
+
+static int ves_outbox_segment_compare(const void *a, const void *b) {
+    const ves_outbox_segment_t *sa = (const ves_outbox_segment_t *)a;
+    const ves_outbox_segment_t *sb = (const ves_outbox_segment_t *)b;
+
+    if(sa->first_id < sb->first_id) {
+        return -1;
+    }
+
+    return (sa->first_id > sb->first_id) ? 1 : 0;
+}
@@ -0,0 +1,60 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * append-only on-disk outbox for VES events
+ *   events are appended to segment files (seg-<first id>.log) before they are sent and
+ *   acknowledged once the collector accepted them; the "ack" file keeps the highest id
+ *   below which everything is acknowledged
+ *   fully acknowledged segments are deleted as a whole, which is the only compaction
+ *   records are read back by priority: reader r returns the records appended with priority r in order,
+ *   records appended without a valid one go to legacy_reader
+ *   one outbox per directory; calls are serialized by the outbox's own lock, which is held for
+ *   writes and reads but not while ves_outbox_sync() waits for the disk
+*/
+typedef struct ves_outbox ves_outbox_t;
+
+ves_outbox_t *ves_outbox_new(const char *directory, int max_segments, int readers, int legacy_reader);
+void ves_outbox_free(ves_outbox_t *outbox);
+
+// priority is kept with the record as a small number (0-254), it selects the reader
+int ves_outbox_append(ves_outbox_t *outbox, const char *post_data, const char *domain, bool batch, int priority, uint64_t *id);
+// makes the records appended so far durable; *synced is set to the last of them
+int ves_outbox_sync(ves_outbox_t *outbox, uint64_t *synced);
+
+void ves_outbox_ack(ves_outbox_t *outbox, uint64_t id);
+bool ves_outbox_acked(ves_outbox_t *outbox, uint64_t id);
+uint64_t ves_outbox_first_unacked(ves_outbox_t *outbox);
+uint64_t ves_outbox_next_id(ves_outbox_t *outbox);
+
+// positions the reader on its first record with an id >= id
+void ves_outbox_rewind(ves_outbox_t *outbox, int reader, uint64_t id);
+// reads the reader's next record; returns 1 when read, 0 at the end of the outbox, -1 on error
+int ves_outbox_read(ves_outbox_t *outbox, int reader, uint64_t *id, char **post_data, char *domain, size_t domain_size, bool *batch);
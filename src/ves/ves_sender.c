@@ -0,0 +1,1220 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+
+#define _GNU_SOURCE
+
+#include "ves_sender.h"
+#include "ves_internal.h"
+#include "ves_outbox.h"
+#include "common/log.h"
+#include "common/utils.h"
+#include "common/histogram.h"
+#include "common/stages.h"
+#include "common/trace.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <curl/curl.h>
+#include <zlib.h>
+
+#define VES_SENDER_STATS_INTERVAL   60      // seconds between two stats log lines
+#define VES_SENDER_DRAIN_TIMEOUT    2       // seconds ves_sender_free() waits for pending events
+#define VES_SENDER_POLL_TIMEOUT     1000    // ms
+#define VES_SENDER_COMPRESSION_MIN  512     // bytes, smaller bodies are sent as they are
+#define VES_SENDER_BACKOFF_MIN      1000    // ms, doubled per failed attempt
+#define VES_SENDER_BACKOFF_MAX      60000   // ms, also caps the doubled open time of the breaker
+
+typedef struct ves_sender_event {
+    char *post_data;
+    char domain[32];
+    bool batch;                 // post_data already is an eventList
+    long int enqueued;          // monotonic us, 0 for events replayed from the outbox
+    uint64_t id;                // outbox record id, 0 when not persisted
+    ves_sender_priority_t priority;
+} ves_sender_event_t;
+
+// bounded ring, producers are any thread, the consumer is the sender thread
+typedef struct ves_sender_queue {
+    ves_sender_event_t *events;
+    int size;
+    int head;
+    int len;
+} ves_sender_queue_t;
+
+struct ves_sender_collector;
+
+typedef struct ves_sender_slot {
+    struct ves_sender_collector *collector;
+    CURL *curl;
+    bool busy;
+    ves_sender_event_t event;
+    int events;                 // events carried by this request, all of event.priority
+    uint64_t *ids;              // their outbox ids
+    long int *enqueued;         // and enqueue timestamps
+    unsigned char *gzip;        // compressed body, kept between requests
+    size_t gzip_size;
+    ves_http_response_t response;
+    long int posted;            // get_monotonic_microseconds() when handed to curl
+} ves_sender_slot_t;
+
+/**
+ * everything kept per collector: its connections, priority queues, outbox and circuit breaker
+ *   queues, stats and breaker are guarded by ves_sender_mutex; the outbox has its own lock,
+ *   so no disk I/O runs under ves_sender_mutex; the rest is only touched by the sender thread after init
+*/
+typedef struct ves_sender_collector {
+    char *name;
+    char *url;
+    char *batch_url;
+
+    ves_sender_queue_t queues[VES_SENDER_PRIORITIES];
+    ves_sender_stats_t stats;
+    histogram_t latency[VES_SENDER_PRIORITIES];     // enqueue to acknowledgement, us
+
+    double low_tokens;          // token bucket shaping the low priority queue
+    long int low_refilled;      // monotonic us
+
+    pthread_mutex_t enqueue_mutex;  // producers append and queue in id order, the sender thread never takes it
+    ves_outbox_t *outbox;       // 0 when disabled
+    bool replaying[VES_SENDER_PRIORITIES];      // the outbox, not the queue, holds the oldest events of a priority
+    uint64_t replay_next[VES_SENDER_PRIORITIES];    // the replay of a priority read all its records below this id
+    uint64_t synced;            // outbox records up to this id are durable, sender thread only
+    bool sync_failed;           // the last ves_outbox_sync() failed, retried at the poll timeout
+
+    ves_sender_breaker_state_t breaker;
+    int breaker_failures;
+    long int breaker_until;     // monotonic ms, end of the open state
+    int breaker_interval;       // ms, open time, doubled per failed probe
+    bool breaker_probing;       // the half-open probe is in flight
+
+    int backoff;                // ms, wait before the next retry below the breaker threshold
+    long int retry_until;       // monotonic ms
+
+    ves_sender_slot_t *slots;
+    int slots_len;
+} ves_sender_collector_t;
+
+static pthread_t ves_sender_thread;
+static bool ves_sender_running = false;
+static bool ves_sender_stop = false;
+static pthread_mutex_t ves_sender_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static ves_sender_collector_t *ves_sender_collectors = 0;
+static int ves_sender_collectors_len = 0;
+
+// only touched by the sender thread after init
+static CURLM *ves_sender_multi = 0;             // shared by the slots of all collectors
+static int ves_sender_batch_window = 0;         // ms, 0 disables coalescing
+static int ves_sender_batch_max_events = 1;
+static char **ves_sender_batch_events = 0;      // scratch list for building an eventList
+static bool ves_sender_compression = false;
+static z_stream ves_sender_zstream;             // reset for every body
+
+static int ves_sender_breaker_threshold = 1;    // consecutive failed requests that open a breaker
+static int ves_sender_breaker_probe_interval = 0;   // ms
+
+static int ves_sender_low_rate = 0;             // low priority events/s, 0 disables shaping
+static int ves_sender_low_burst = 1;
+
+static int ves_sender_collector_init(ves_sender_collector_t *collector, const config_t *config, const char *name, const char *url, const char *username, const char *password, const char *outbox);
+static void ves_sender_collector_free(ves_sender_collector_t *collector);
+static int ves_sender_collector_enqueue(ves_sender_collector_t *collector, char *post_data, const char *domain, bool batch, ves_sender_priority_t priority);
+static void *ves_sender_routine(void *arg);
+static int ves_sender_start_transfers(ves_sender_collector_t *collector, int *wait_ms);
+static void ves_sender_abandon(ves_sender_collector_t *collector, ves_sender_slot_t *slot, bool retry);
+static int ves_sender_take(ves_sender_collector_t *collector, ves_sender_slot_t *slot, int *wait_ms);
+static int ves_sender_take_queue(ves_sender_collector_t *collector, ves_sender_queue_t *queue, int max_events, bool wait_window, ves_sender_slot_t *slot, int *wait_ms);
+static int ves_sender_shape(ves_sender_collector_t *collector, int *wait_ms);
+static int ves_sender_complete_transfers(void);
+static void ves_sender_refill(ves_sender_collector_t *collector);
+static void ves_sender_replay(ves_sender_collector_t *collector, ves_sender_priority_t priority);
+static bool ves_sender_replaying(const ves_sender_collector_t *collector);
+static bool ves_sender_in_flight(const ves_sender_collector_t *collector, uint64_t id);
+static int ves_sender_queue_len(const ves_sender_collector_t *collector);
+static void ves_sender_queue_clear(ves_sender_queue_t *queue);
+static void ves_sender_breaker_update(ves_sender_collector_t *collector, bool reachable);
+static void ves_sender_breaker_open(ves_sender_collector_t *collector);
+static void ves_sender_retry_later(ves_sender_collector_t *collector);
+static void ves_sender_log_stats(void);
+static long int ves_sender_deflate(ves_sender_slot_t *slot, const char *data, size_t size);
+
+int ves_sender_init(const config_t *config) {
+    ves_sender_stop = false;
+
+    ves_sender_batch_window = config->ves.batch_window;
+    ves_sender_batch_max_events = config->ves.batch_max_events;
+    if((ves_sender_batch_window <= 0) || (ves_sender_batch_max_events < 2)) {
+        ves_sender_batch_window = 0;
+        ves_sender_batch_max_events = 1;
+    }
+
+    ves_sender_batch_events = (char **)malloc(sizeof(char *) * ves_sender_batch_max_events);
+    if(ves_sender_batch_events == 0) {
+        log_error("malloc failed");
+        goto failure;
+    }
+
+    ves_sender_breaker_threshold = config->ves.breaker_threshold;
+    if(ves_sender_breaker_threshold < 1) {
+        ves_sender_breaker_threshold = 1;
+    }
+    ves_sender_breaker_probe_interval = config->ves.breaker_probe_interval * 1000;
+
+    ves_sender_low_rate = (config->ves.low_priority_rate > 0) ? config->ves.low_priority_rate : 0;
+    ves_sender_low_burst = config->ves.low_priority_burst;
+    if(ves_sender_low_burst < 1) {
+        ves_sender_low_burst = 1;
+    }
+
+    ves_sender_compression = false;
+    if(config->ves.compression) {
+        memset(&ves_sender_zstream, 0, sizeof(z_stream));
+        // 15 + 16 selects the gzip wrapper instead of raw zlib
+        if(deflateInit2(&ves_sender_zstream, config->ves.compression_level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            log_error("deflateInit2() failed");
+            goto failure;
+        }
+        ves_sender_compression = true;
+    }
+
+    ves_sender_multi = curl_multi_init();
+    if(ves_sender_multi == 0) {
+        log_error("curl_multi_init() failed");
+        goto failure;
+    }
+
+    ves_sender_collectors = (ves_sender_collector_t *)calloc(1 + config->ves.collectors_len, sizeof(ves_sender_collector_t));
+    if(ves_sender_collectors == 0) {
+        log_error("calloc failed");
+        goto failure;
+    }
+
+    // the primary collector keeps using ves.outbox itself, additional ones get a subdirectory
+    const char *outbox = ((config->ves.outbox) && (config->ves.outbox[0])) ? config->ves.outbox : 0;
+    ves_sender_collectors_len++;
+    if(ves_sender_collector_init(&ves_sender_collectors[0], config, "primary", config->ves.url, config->ves.username, config->ves.password, outbox) != 0) {
+        log_error("ves_sender_collector_init() failed");
+        goto failure;
+    }
+
+    for(int i = 0; i < config->ves.collectors_len; i++) {
+        const config_ves_collector_t *c = &config->ves.collectors[i];
+        char *collector_outbox = 0;
+        if(outbox) {
+            asprintf(&collector_outbox, "%s/%s", outbox, c->name);
+            if(collector_outbox == 0) {
+                log_error("asprintf() failed");
+                goto failure;
+            }
+        }
+
+        ves_sender_collectors_len++;
+        int rc = ves_sender_collector_init(&ves_sender_collectors[i + 1], config, c->name, c->url, c->username, c->password, collector_outbox);
+        free(collector_outbox);
+        if(rc != 0) {
+            log_error("ves_sender_collector_init() failed");
+            goto failure;
+        }
+    }
+
+    if(pthread_create(&ves_sender_thread, 0, ves_sender_routine, 0) != 0) {
+        log_error("pthread_create() failed");
+        goto failure;
+    }
+    ves_sender_running = true;
+
+    return 0;
+
+failure:
+    ves_sender_free();
+    return 1;
+}
+
+void ves_sender_free() {
+    if(ves_sender_running) {
+        pthread_mutex_lock(&ves_sender_mutex);
+        ves_sender_stop = true;
+        pthread_mutex_unlock(&ves_sender_mutex);
+        curl_multi_wakeup(ves_sender_multi);
+
+        pthread_join(ves_sender_thread, 0);
+        ves_sender_running = false;
+
+        ves_sender_log_stats();
+    }
+
+    for(int i = 0; i < ves_sender_collectors_len; i++) {
+        ves_sender_collector_free(&ves_sender_collectors[i]);
+    }
+    free(ves_sender_collectors);
+    ves_sender_collectors = 0;
+    ves_sender_collectors_len = 0;
+
+    if(ves_sender_multi) {
+        curl_multi_cleanup(ves_sender_multi);
+        ves_sender_multi = 0;
+    }
+
+    free(ves_sender_batch_events);
+    ves_sender_batch_events = 0;
+
+    if(ves_sender_compression) {
+        deflateEnd(&ves_sender_zstream);
+        ves_sender_compression = false;
+    }
+}
+
+// every collector gets its own copy of the event; fails only when none of them took it
+int ves_sender_enqueue(char *post_data, const char *domain, bool batch, ves_sender_priority_t priority) {
+    if(post_data == 0) {
+        log_error("post_data is null");
+        return 1;
+    }
+
+    int accepted = 0;
+    for(int i = 0; i < ves_sender_collectors_len; i++) {
+        char *data = post_data;
+        if(i < ves_sender_collectors_len - 1) {
+            data = strdup(post_data);
+            if(data == 0) {
+                log_error("strdup failed");
+                continue;
+            }
+        }
+
+        if(ves_sender_collector_enqueue(&ves_sender_collectors[i], data, domain, batch, priority) == 0) {
+            accepted++;
+        }
+    }
+
+    if(ves_sender_collectors_len == 0) {
+        free(post_data);
+    }
+
+    if(accepted == 0) {
+        return 1;
+    }
+
+    curl_multi_wakeup(ves_sender_multi);
+
+    return 0;
+}
+
+// VES commonEventHeader priority (High, Medium, Normal, Low) to sender queue
+ves_sender_priority_t ves_sender_priority(const char *priority) {
+    if(priority && (strcmp(priority, "High") == 0)) {
+        return VES_SENDER_PRIORITY_HIGH;
+    }
+
+    if(priority && ((strcmp(priority, "Medium") == 0) || (strcmp(priority, "Normal") == 0))) {
+        return VES_SENDER_PRIORITY_NORMAL;
+    }
+
+    return VES_SENDER_PRIORITY_LOW;
+}
+
+int ves_sender_collectors_count(void) {
+    return ves_sender_collectors_len;
+}
+
+void ves_sender_get_stats(int collector, ves_sender_stats_t *stats) {
+    memset(stats, 0, sizeof(ves_sender_stats_t));
+    if((collector < 0) || (collector >= ves_sender_collectors_len)) {
+        return;
+    }
+
+    ves_sender_collector_t *c = &ves_sender_collectors[collector];
+    pthread_mutex_lock(&ves_sender_mutex);
+    memcpy(stats, &c->stats, sizeof(ves_sender_stats_t));
+    stats->collector = c->name;
+    for(int i = 0; i < VES_SENDER_PRIORITIES; i++) {
+        stats->queue_depths[i] = c->queues[i].len;
+        stats->queue_depth += c->queues[i].len;
+    }
+    stats->breaker = c->breaker;
+    stats->outbox_pending = c->outbox ? (long int)(ves_outbox_next_id(c->outbox) - ves_outbox_first_unacked(c->outbox)) : 0;
+    pthread_mutex_unlock(&ves_sender_mutex);
+}
+
+void ves_sender_get_latency(int collector, ves_sender_priority_t priority, histogram_t *latency) {
+    histogram_reset(latency);
+    if((collector < 0) || (collector >= ves_sender_collectors_len) || (priority < 0) || (priority >= VES_SENDER_PRIORITIES)) {
+        return;
+    }
+
+    pthread_mutex_lock(&ves_sender_mutex);
+    histogram_merge(latency, &ves_sender_collectors[collector].latency[priority]);
+    pthread_mutex_unlock(&ves_sender_mutex);
+}
+
+static int ves_sender_collector_init(ves_sender_collector_t *collector, const config_t *config, const char *name, const char *url, const char *username, const char *password, const char *outbox) {
+    int queue_size = config->ves.queue_size;
+    int max_in_flight = config->ves.max_in_flight;
+
+    if(queue_size < 1) {
+        queue_size = 1;
+    }
+
+    if(max_in_flight < 1) {
+        max_in_flight = 1;
+    }
+
+    pthread_mutex_init(&collector->enqueue_mutex, 0);
+    collector->breaker = VES_SENDER_BREAKER_CLOSED;
+    collector->breaker_interval = ves_sender_breaker_probe_interval;
+    collector->backoff = VES_SENDER_BACKOFF_MIN;
+
+    collector->name = strdup(name);
+    collector->url = strdup(url);
+    if((collector->name == 0) || (collector->url == 0)) {
+        log_error("strdup failed");
+        goto failure;
+    }
+
+    int url_len = strlen(url);
+    if((url_len > 0) && (url[url_len - 1] == '/')) {
+        url_len--;
+    }
+    asprintf(&collector->batch_url, "%.*s/eventBatch", url_len, url);
+    if(collector->batch_url == 0) {
+        log_error("asprintf() failed");
+        goto failure;
+    }
+
+    if(outbox) {
+        // one reader per priority, records written before priorities were kept go with the normal ones
+        collector->outbox = ves_outbox_new(outbox, config->ves.outbox_max_segments, VES_SENDER_PRIORITIES, VES_SENDER_PRIORITY_NORMAL);
+        if(collector->outbox == 0) {
+            log_error("ves_outbox_new() failed");
+            goto failure;
+        }
+
+        // events left over from the last run go first
+        for(int i = 0; i < VES_SENDER_PRIORITIES; i++) {
+            collector->replaying[i] = (ves_outbox_first_unacked(collector->outbox) < ves_outbox_next_id(collector->outbox));
+        }
+    }
+
+    // ves.queue-size applies to each priority
+    for(int i = 0; i < VES_SENDER_PRIORITIES; i++) {
+        collector->queues[i].events = (ves_sender_event_t *)malloc(sizeof(ves_sender_event_t) * queue_size);
+        if(collector->queues[i].events == 0) {
+            log_error("malloc failed");
+            goto failure;
+        }
+        collector->queues[i].size = queue_size;
+    }
+
+    collector->low_tokens = ves_sender_low_burst;
+    collector->low_refilled = get_monotonic_microseconds();
+
+    collector->slots = (ves_sender_slot_t *)calloc(max_in_flight, sizeof(ves_sender_slot_t));
+    if(collector->slots == 0) {
+        log_error("calloc failed");
+        goto failure;
+    }
+    collector->slots_len = max_in_flight;
+
+    for(int i = 0; i < collector->slots_len; i++) {
+        ves_sender_slot_t *slot = &collector->slots[i];
+        slot->collector = collector;
+
+        slot->curl = ves_http_handle_new(username, password);
+        if(slot->curl == 0) {
+            log_error("ves_http_handle_new() failed");
+            goto failure;
+        }
+
+        slot->ids = (uint64_t *)malloc(sizeof(uint64_t) * ves_sender_batch_max_events);
+        slot->enqueued = (long int *)malloc(sizeof(long int) * ves_sender_batch_max_events);
+        if((slot->ids == 0) || (slot->enqueued == 0)) {
+            log_error("malloc failed");
+            goto failure;
+        }
+
+        CURLcode res = curl_easy_setopt(slot->curl, CURLOPT_PRIVATE, (void *)slot);
+        if(res != CURLE_OK) {
+            log_error("curl_easy_setopt() error");
+            goto failure;
+        }
+    }
+
+    return 0;
+
+failure:
+    return 1;
+}
+
+static void ves_sender_collector_free(ves_sender_collector_t *collector) {
+    for(int i = 0; i < collector->slots_len; i++) {
+        ves_sender_slot_t *slot = &collector->slots[i];
+        if(slot->busy) {
+            curl_multi_remove_handle(ves_sender_multi, slot->curl);
+            free(slot->event.post_data);
+            free(slot->response.response);
+        }
+        curl_easy_cleanup(slot->curl);
+        free(slot->ids);
+        free(slot->enqueued);
+        free(slot->gzip);
+    }
+    free(collector->slots);
+
+    for(int i = 0; i < VES_SENDER_PRIORITIES; i++) {
+        ves_sender_queue_clear(&collector->queues[i]);
+        free(collector->queues[i].events);
+    }
+
+    ves_outbox_free(collector->outbox);
+
+    free(collector->name);
+    free(collector->url);
+    free(collector->batch_url);
+    pthread_mutex_destroy(&collector->enqueue_mutex);
+    memset(collector, 0, sizeof(ves_sender_collector_t));
+}
+
+static int ves_sender_collector_enqueue(ves_sender_collector_t *collector, char *post_data, const char *domain, bool batch, ves_sender_priority_t priority) {
+    uint64_t id = 0;
+    ves_sender_queue_t *queue = &collector->queues[priority];
+
+    pthread_mutex_lock(&collector->enqueue_mutex);
+    if(collector->outbox) {
+        // written before it is sent, made durable by the sender thread before the first attempt
+        if(ves_outbox_append(collector->outbox, post_data, domain, batch, priority, &id) != 0) {
+            log_error("ves_outbox_append() failed, event not persisted for %s", collector->name);
+            id = 0;
+        }
+    }
+
+    pthread_mutex_lock(&ves_sender_mutex);
+    if((id == 0) && (collector->breaker == VES_SENDER_BREAKER_OPEN)) {
+        // collector known to be down and nowhere to keep the event: fail fast
+        collector->stats.rejected++;
+        pthread_mutex_unlock(&ves_sender_mutex);
+        pthread_mutex_unlock(&collector->enqueue_mutex);
+
+        free(post_data);
+        return 1;
+    }
+
+    // only the replay of its own priority holds an event back, alarms keep going to their queue during a backlog of others
+    if((id != 0) && (collector->replaying[priority] || (id < collector->replay_next[priority]) || (queue->len == queue->size))) {
+        // the sender picks it up from the outbox, in order, unless the replay read it already after the append
+        if((!collector->replaying[priority]) && (id >= collector->replay_next[priority])) {
+            collector->replaying[priority] = true;
+            ves_outbox_rewind(collector->outbox, priority, id);
+        }
+
+        collector->stats.enqueued++;
+        pthread_mutex_unlock(&ves_sender_mutex);
+        pthread_mutex_unlock(&collector->enqueue_mutex);
+
+        free(post_data);
+        return 0;
+    }
+
+    if(queue->len == queue->size) {
+        collector->stats.dropped++;
+        pthread_mutex_unlock(&ves_sender_mutex);
+        pthread_mutex_unlock(&collector->enqueue_mutex);
+
+        log_error_ratelimited(1, 5, "ves sender queue of %s full, event dropped", collector->name);
+        free(post_data);
+        return 1;
+    }
+
+    ves_sender_event_t *event = &queue->events[(queue->head + queue->len) % queue->size];
+    event->post_data = post_data;
+    snprintf(event->domain, sizeof(event->domain), "%s", domain ? domain : "");
+    event->batch = batch;
+    event->enqueued = get_monotonic_microseconds();
+    event->id = id;
+    event->priority = priority;
+    queue->len++;
+    collector->stats.enqueued++;
+    pthread_mutex_unlock(&ves_sender_mutex);
+    pthread_mutex_unlock(&collector->enqueue_mutex);
+
+    return 0;
+}
+
+static void *ves_sender_routine(void *arg) {
+    long int stats_timestamp = get_seconds_since_epoch() + VES_SENDER_STATS_INTERVAL;
+    long int drain_deadline = -1;
+
+    (void)arg;
+
+    while(1) {
+        int wait_ms = VES_SENDER_POLL_TIMEOUT;
+        int in_flight = 0;
+        for(int i = 0; i < ves_sender_collectors_len; i++) {
+            in_flight += ves_sender_start_transfers(&ves_sender_collectors[i], &wait_ms);
+        }
+
+        int running_handles = 0;
+        CURLMcode mc = curl_multi_perform(ves_sender_multi, &running_handles);
+        if(mc != CURLM_OK) {
+            log_error("curl_multi_perform() failed: %s", curl_multi_strerror(mc));
+        }
+
+        // freed handles can take queued events right away
+        if(ves_sender_complete_transfers() > 0) {
+            wait_ms = 0;
+        }
+
+        long int now = get_seconds_since_epoch();
+        if(now >= stats_timestamp) {
+            stats_timestamp = now + VES_SENDER_STATS_INTERVAL;
+            ves_sender_log_stats();
+        }
+
+        pthread_mutex_lock(&ves_sender_mutex);
+        bool stop = ves_sender_stop;
+        int queue_len = 0;
+        for(int i = 0; i < ves_sender_collectors_len; i++) {
+            ves_sender_collector_t *collector = &ves_sender_collectors[i];
+            if(collector->outbox && (ves_sender_replaying(collector) || (collector->breaker != VES_SENDER_BREAKER_CLOSED))) {
+                // whatever is left waits in the outbox for the next start
+                continue;
+            }
+            queue_len += ves_sender_queue_len(collector);
+        }
+        pthread_mutex_unlock(&ves_sender_mutex);
+
+        if(stop) {
+            if(drain_deadline == -1) {
+                drain_deadline = now + VES_SENDER_DRAIN_TIMEOUT;
+            }
+
+            if(((queue_len == 0) && (in_flight == 0) && (running_handles == 0)) || (now >= drain_deadline)) {
+                break;
+            }
+        }
+
+        mc = curl_multi_poll(ves_sender_multi, 0, 0, wait_ms, 0);
+        if(mc != CURLM_OK) {
+            log_error("curl_multi_poll() failed: %s", curl_multi_strerror(mc));
+        }
+    }
+
+    return 0;
+}
+
+// hands queued events of a collector to its idle handles, returns the number of its transfers in flight
+static int ves_sender_start_transfers(ves_sender_collector_t *collector, int *wait_ms) {
+    int in_flight = 0;
+    bool queue_idle = false;
+
+    for(int i = 0; i < collector->slots_len; i++) {
+        ves_sender_slot_t *slot = &collector->slots[i];
+        if(slot->busy) {
+            in_flight++;
+            continue;
+        }
+
+        if(queue_idle) {
+            continue;
+        }
+
+        int events = ves_sender_take(collector, slot, wait_ms);
+        if(events == 0) {
+            queue_idle = true;
+            continue;
+        }
+
+        slot->events = events;
+        memset(&slot->response, 0, sizeof(ves_http_response_t));
+
+        const char *url = slot->event.batch ? collector->batch_url : collector->url;
+        const void *body = slot->event.post_data;
+        long int body_size = slot->event.post_data ? (long int)strlen(slot->event.post_data) : 0;
+        bool gzip = false;
+        if(ves_sender_compression && (body_size >= VES_SENDER_COMPRESSION_MIN)) {
+            long int gzip_size = ves_sender_deflate(slot, slot->event.post_data, body_size);
+            if(gzip_size > 0) {
+                pthread_mutex_lock(&ves_sender_mutex);
+                collector->stats.bytes_uncompressed += body_size;
+                collector->stats.bytes_compressed += gzip_size;
+                pthread_mutex_unlock(&ves_sender_mutex);
+
+                body = slot->gzip;
+                body_size = gzip_size;
+                gzip = true;
+            }
+        }
+
+        if((slot->event.post_data == 0) ||
+            (curl_easy_setopt(slot->curl, CURLOPT_URL, url) != CURLE_OK) ||
+            (curl_easy_setopt(slot->curl, CURLOPT_HTTPHEADER, ves_http_headers(gzip)) != CURLE_OK) ||
+            (curl_easy_setopt(slot->curl, CURLOPT_POSTFIELDSIZE, body_size) != CURLE_OK) ||
+            (curl_easy_setopt(slot->curl, CURLOPT_POSTFIELDS, body) != CURLE_OK) ||
+            (curl_easy_setopt(slot->curl, CURLOPT_WRITEDATA, (void *)&slot->response) != CURLE_OK)) {
+            log_error("request setup failed, %d events dropped", events);
+            ves_sender_abandon(collector, slot, false);
+            continue;
+        }
+
+        log_trace("POST-ing cURL to url=\"%s\" with body=\"%s\"... ", url, slot->event.post_data);
+        CURLMcode mc = curl_multi_add_handle(ves_sender_multi, slot->curl);
+        if(mc != CURLM_OK) {
+            log_error("curl_multi_add_handle() failed: %s", curl_multi_strerror(mc));
+            ves_sender_abandon(collector, slot, true);
+            continue;
+        }
+
+        slot->busy = true;
+        slot->posted = get_monotonic_microseconds();
+        trace_event(TRACE_VES_SEND, events, body_size);
+        in_flight++;
+    }
+
+    pthread_mutex_lock(&ves_sender_mutex);
+    collector->stats.in_flight = in_flight;
+    pthread_mutex_unlock(&ves_sender_mutex);
+
+    return in_flight;
+}
+
+/**
+ * gives up on a request that never reached curl, the way a completed one that failed is handled
+ *   with retry its outbox records are replayed after the backoff, otherwise they are acked as dropped
+*/
+static void ves_sender_abandon(ves_sender_collector_t *collector, ves_sender_slot_t *slot, bool retry) {
+    free(slot->event.post_data);
+    slot->event.post_data = 0;
+
+    pthread_mutex_lock(&ves_sender_mutex);
+    retry = retry && collector->outbox && (slot->ids[0] != 0);
+    if(retry) {
+        collector->stats.retried += slot->events;
+        ves_sender_replay(collector, slot->event.priority);
+        ves_sender_retry_later(collector);
+    }
+    else {
+        collector->stats.failed += slot->events;
+    }
+    pthread_mutex_unlock(&ves_sender_mutex);
+
+    if(collector->outbox && !retry) {
+        for(int i = 0; i < slot->events; i++) {
+            ves_outbox_ack(collector->outbox, slot->ids[i]);
+        }
+    }
+}
+
+/**
+ * pops the next request off the collector's queues into slot->event, returns the number of events it carries
+ *   every free handle goes to high priority first, then normal, then low; low is shaped by a token bucket
+ *   0 means nothing is ready; *wait_ms is lowered when a batch window or the shaper is pending
+*/
+static int ves_sender_take(ves_sender_collector_t *collector, ves_sender_slot_t *slot, int *wait_ms) {
+    int count = 0;
+    bool stop = false;
+
+    pthread_mutex_lock(&ves_sender_mutex);
+    if(collector->breaker == VES_SENDER_BREAKER_OPEN) {
+        long int remaining = collector->breaker_until - get_monotonic_milliseconds();
+        if(remaining > 0) {
+            if(remaining < *wait_ms) {
+                *wait_ms = remaining;
+            }
+
+            pthread_mutex_unlock(&ves_sender_mutex);
+            return 0;
+        }
+
+        collector->breaker = VES_SENDER_BREAKER_HALF_OPEN;
+        collector->breaker_probing = false;
+    }
+
+    if((collector->breaker == VES_SENDER_BREAKER_HALF_OPEN) && collector->breaker_probing) {
+        // a single request probes the collector, the rest waits for its outcome
+        pthread_mutex_unlock(&ves_sender_mutex);
+        return 0;
+    }
+
+    long int backoff = collector->retry_until - get_monotonic_milliseconds();
+    if(backoff > 0) {
+        if(backoff < *wait_ms) {
+            *wait_ms = backoff;
+        }
+
+        pthread_mutex_unlock(&ves_sender_mutex);
+        return 0;
+    }
+    stop = ves_sender_stop;
+    pthread_mutex_unlock(&ves_sender_mutex);
+
+    // producers keep appending to the outbox meanwhile, only its own lock is taken
+    if(collector->outbox) {
+        if(!stop) {
+            ves_sender_refill(collector);
+        }
+
+        collector->sync_failed = (ves_outbox_sync(collector->outbox, &collector->synced) != 0);
+    }
+
+    pthread_mutex_lock(&ves_sender_mutex);
+    if(collector->breaker == VES_SENDER_BREAKER_OPEN) {
+        // the outbox could not be read
+        pthread_mutex_unlock(&ves_sender_mutex);
+        return 0;
+    }
+
+    // alarms go out as soon as they are queued, without waiting for a batch window
+    count = ves_sender_take_queue(collector, &collector->queues[VES_SENDER_PRIORITY_HIGH], ves_sender_batch_max_events, false, slot, wait_ms);
+
+    if(count == 0) {
+        count = ves_sender_take_queue(collector, &collector->queues[VES_SENDER_PRIORITY_NORMAL], ves_sender_batch_max_events, true, slot, wait_ms);
+    }
+
+    if((count == 0) && (collector->queues[VES_SENDER_PRIORITY_LOW].len > 0)) {
+        int tokens = ves_sender_shape(collector, wait_ms);
+        if(tokens > 0) {
+            count = ves_sender_take_queue(collector, &collector->queues[VES_SENDER_PRIORITY_LOW], (tokens < ves_sender_batch_max_events) ? tokens : ves_sender_batch_max_events, true, slot, wait_ms);
+            if(ves_sender_low_rate > 0) {
+                collector->low_tokens -= count;
+            }
+        }
+    }
+
+    if(count == 0) {
+        pthread_mutex_unlock(&ves_sender_mutex);
+        return 0;
+    }
+
+    if(count > 1) {
+        collector->stats.batches++;
+    }
+    if(collector->breaker == VES_SENDER_BREAKER_HALF_OPEN) {
+        collector->breaker_probing = true;
+    }
+    pthread_mutex_unlock(&ves_sender_mutex);
+
+    if(count > 1) {
+        // null post_data is reported as a failed setup by the caller
+        slot->event.post_data = ves_event_list(ves_sender_batch_events, count);
+        slot->event.batch = true;
+        for(int i = 0; i < count; i++) {
+            free(ves_sender_batch_events[i]);
+        }
+    }
+
+    return count;
+}
+
+/**
+ * moves up to max_events from the head of one queue into slot, called with ves_sender_mutex held
+ *   with wait_window, a batch that could still grow waits until ves.batch-window after its first event
+*/
+static int ves_sender_take_queue(ves_sender_collector_t *collector, ves_sender_queue_t *queue, int max_events, bool wait_window, ves_sender_slot_t *slot, int *wait_ms) {
+    int count = 1;
+
+    if((queue->len == 0) || (max_events < 1)) {
+        return 0;
+    }
+
+    ves_sender_event_t *head = &queue->events[queue->head];
+    if(head->id > collector->synced) {
+        // appended after the last ves_outbox_sync(), sent once the next one made it durable
+        if(!collector->sync_failed) {
+            *wait_ms = 0;
+        }
+        return 0;
+    }
+
+    if((ves_sender_batch_window > 0) && (!head->batch)) {
+        // only consecutive events of the head's domain can join, so ordering is kept
+        while((count < queue->len) && (count < max_events)) {
+            const ves_sender_event_t *next = &queue->events[(queue->head + count) % queue->size];
+            if((next->batch) || (strcmp(next->domain, head->domain) != 0) || (next->id > collector->synced)) {
+                break;
+            }
+            count++;
+        }
+
+        // the batch can still grow only if nothing else is queued behind it
+        bool closed = (!wait_window) || (count == max_events) || (count < queue->len) || ves_sender_stop;
+        long int age = (get_monotonic_microseconds() - head->enqueued) / 1000;
+        if((!closed) && (age < ves_sender_batch_window)) {
+            int remaining = ves_sender_batch_window - age;
+            if(remaining < *wait_ms) {
+                *wait_ms = remaining;
+            }
+
+            return 0;
+        }
+    }
+
+    slot->event = *head;
+    for(int i = 0; i < count; i++) {
+        const ves_sender_event_t *event = &queue->events[(queue->head + i) % queue->size];
+        ves_sender_batch_events[i] = event->post_data;
+        slot->ids[i] = event->id;
+        slot->enqueued[i] = event->enqueued;
+    }
+    queue->head = (queue->head + count) % queue->size;
+    queue->len -= count;
+
+    return count;
+}
+
+/**
+ * token bucket for low priority events, called with ves_sender_mutex held
+ *   returns how many low priority events may go out now; when none, *wait_ms is lowered to the next token
+*/
+static int ves_sender_shape(ves_sender_collector_t *collector, int *wait_ms) {
+    if(ves_sender_low_rate <= 0) {
+        return ves_sender_batch_max_events;
+    }
+
+    long int now = get_monotonic_microseconds();
+    collector->low_tokens += (double)(now - collector->low_refilled) * ves_sender_low_rate / 1000000.0;
+    collector->low_refilled = now;
+    if(collector->low_tokens > ves_sender_low_burst) {
+        collector->low_tokens = ves_sender_low_burst;
+    }
+
+    if(collector->low_tokens >= 1.0) {
+        return (int)collector->low_tokens;
+    }
+
+    int remaining = (int)((1.0 - collector->low_tokens) * 1000.0 / ves_sender_low_rate) + 1;
+    if(remaining < *wait_ms) {
+        *wait_ms = remaining;
+    }
+
+    return 0;
+}
+
+// returns the number of finished transfers
+static int ves_sender_complete_transfers(void) {
+    CURLMsg *msg;
+    int msgs_left;
+    int completed = 0;
+
+    while((msg = curl_multi_info_read(ves_sender_multi, &msgs_left))) {
+        if(msg->msg != CURLMSG_DONE) {
+            continue;
+        }
+
+        ves_sender_slot_t *slot = 0;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&slot);
+        ves_sender_collector_t *collector = slot->collector;
+
+        bool ok = false;
+        bool retry = true;
+        long http_rc = 0;           // stays 0 when the transfer itself failed
+        if(msg->data.result != CURLE_OK) {
+            // a collector that is down fails every retry
+            log_error_ratelimited(1, 5, "curl transfer to %s failed: %s", collector->name, curl_easy_strerror(msg->data.result));
+        }
+        else {
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &http_rc);
+            log_debug("response_code = %ld", http_rc);
+            if(slot->response.response) {
+                log_trace("response = %s", slot->response.response);
+            }
+
+            if(http_rc > 399) {
+                log_error_ratelimited(1, 5, "failure http response code from %s: %ld", collector->name, http_rc);
+                // the collector rejected the event itself, sending it again would not help
+                retry = (http_rc >= 500) || (http_rc == 408) || (http_rc == 429);
+            }
+            else {
+                ok = true;
+            }
+        }
+        trace_event(TRACE_VES_ACK, http_rc, get_monotonic_microseconds() - slot->posted);
+
+        curl_multi_remove_handle(ves_sender_multi, slot->curl);
+        free(slot->event.post_data);
+        slot->event.post_data = 0;
+        free(slot->response.response);
+        memset(&slot->response, 0, sizeof(ves_http_response_t));
+        slot->busy = false;
+
+        pthread_mutex_lock(&ves_sender_mutex);
+        // a rejection still proves the collector is up
+        ves_sender_breaker_update(collector, ok || !retry);
+
+        if(ok) {
+            collector->stats.sent += slot->events;
+
+            long int now = get_monotonic_microseconds();
+            for(int i = 0; i < slot->events; i++) {
+                if(slot->enqueued[i] != 0) {
+                    histogram_record(&collector->latency[slot->event.priority], (uint64_t)(now - slot->enqueued[i]));
+                    stages_record(STAGE_VES_ACK, slot->enqueued[i]);
+                }
+            }
+        }
+        else if(retry && collector->outbox && (slot->ids[0] != 0)) {
+            collector->stats.retried += slot->events;
+            ves_sender_replay(collector, slot->event.priority);
+            ves_sender_retry_later(collector);
+        }
+        else {
+            collector->stats.failed += slot->events;
+        }
+        collector->stats.in_flight--;
+        pthread_mutex_unlock(&ves_sender_mutex);
+
+        // writes the ack file and deletes segments, under the outbox lock only
+        if(collector->outbox && (ok || !retry)) {
+            for(int i = 0; i < slot->events; i++) {
+                ves_outbox_ack(collector->outbox, slot->ids[i]);
+            }
+        }
+
+        completed++;
+    }
+
+    return completed;
+}
+
+/**
+ * moves outbox records into their queues, each priority as far as its queue has room
+ *   every priority has its own outbox reader, so a backlog of low priority records does not hold back alarms
+ *   the outbox is read outside ves_sender_mutex; the end of a priority is confirmed under it, as enqueue
+ *   leaves new records of that priority to the outbox for as long as its replay runs
+*/
+static void ves_sender_refill(ves_sender_collector_t *collector) {
+    for(int priority = 0; priority < VES_SENDER_PRIORITIES; priority++) {
+        ves_sender_queue_t *queue = &collector->queues[priority];
+
+        while(true) {
+            pthread_mutex_lock(&ves_sender_mutex);
+            bool room = collector->replaying[priority] && (queue->len < queue->size);
+            pthread_mutex_unlock(&ves_sender_mutex);
+
+            if(!room) {
+                break;
+            }
+
+            ves_sender_event_t event;
+            int rc = ves_outbox_read(collector->outbox, priority, &event.id, &event.post_data, event.domain, sizeof(event.domain), &event.batch);
+
+            pthread_mutex_lock(&ves_sender_mutex);
+            if(rc == 0) {
+                rc = ves_outbox_read(collector->outbox, priority, &event.id, &event.post_data, event.domain, sizeof(event.domain), &event.batch);
+                if(rc == 0) {
+                    collector->replaying[priority] = false;
+                    pthread_mutex_unlock(&ves_sender_mutex);
+                    break;
+                }
+            }
+
+            if(rc < 0) {
+                log_error("ves_outbox_read() failed, pausing the sender for %s", collector->name);
+                ves_sender_breaker_open(collector);
+                pthread_mutex_unlock(&ves_sender_mutex);
+                return;
+            }
+            collector->replay_next[priority] = event.id + 1;
+
+            // a replay started by one failed request finds the other requests of its priority still in flight
+            if(ves_outbox_acked(collector->outbox, event.id) || ves_sender_in_flight(collector, event.id)) {
+                pthread_mutex_unlock(&ves_sender_mutex);
+                free(event.post_data);
+                continue;
+            }
+
+            event.priority = (ves_sender_priority_t)priority;
+            event.enqueued = 0;
+
+            // enqueue does not add to this queue while it is replaying, so the room checked above is still there
+            queue->events[(queue->head + queue->len) % queue->size] = event;
+            queue->len++;
+            pthread_mutex_unlock(&ves_sender_mutex);
+        }
+    }
+}
+
+// a request failed: replay everything unacknowledged of its priority from the outbox in order; called with ves_sender_mutex held
+static void ves_sender_replay(ves_sender_collector_t *collector, ves_sender_priority_t priority) {
+    // queued events are all in the outbox as well
+    ves_sender_queue_clear(&collector->queues[priority]);
+    collector->replaying[priority] = true;
+    ves_outbox_rewind(collector->outbox, priority, ves_outbox_first_unacked(collector->outbox));
+}
+
+static bool ves_sender_replaying(const ves_sender_collector_t *collector) {
+    for(int i = 0; i < VES_SENDER_PRIORITIES; i++) {
+        if(collector->replaying[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// slots are only touched by the sender thread; a failed request is no longer busy when it starts the replay
+static bool ves_sender_in_flight(const ves_sender_collector_t *collector, uint64_t id) {
+    for(int i = 0; i < collector->slots_len; i++) {
+        const ves_sender_slot_t *slot = &collector->slots[i];
+        if(!slot->busy) {
+            continue;
+        }
+
+        for(int j = 0; j < slot->events; j++) {
+            if(slot->ids[j] == id) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static int ves_sender_queue_len(const ves_sender_collector_t *collector) {
+    int len = 0;
+    for(int i = 0; i < VES_SENDER_PRIORITIES; i++) {
+        len += collector->queues[i].len;
+    }
+    return len;
+}
+
+static void ves_sender_queue_clear(ves_sender_queue_t *queue) {
+    for(int i = 0; i < queue->len; i++) {
+        free(queue->events[(queue->head + i) % queue->size].post_data);
+    }
+    queue->head = 0;
+    queue->len = 0;
+}
+
+/**
+ * circuit breaker, called with ves_sender_mutex held after every finished request
+ *   closed: requests go out, ves.breaker-threshold consecutive failures open it
+ *   open: nothing is sent for ves.breaker-probe-interval; new events fail fast, or only go to the outbox
+ *   half-open: one request probes the collector, success closes the breaker and failure opens it again
+ *   for twice as long as before, up to VES_SENDER_BACKOFF_MAX
+*/
+static void ves_sender_breaker_update(ves_sender_collector_t *collector, bool reachable) {
+    if(reachable) {
+        collector->breaker_failures = 0;
+        collector->breaker_interval = ves_sender_breaker_probe_interval;
+        collector->backoff = VES_SENDER_BACKOFF_MIN;
+        if(collector->breaker == VES_SENDER_BREAKER_HALF_OPEN) {
+            log("ves collector %s reachable again, circuit closed", collector->name);
+            collector->breaker = VES_SENDER_BREAKER_CLOSED;
+        }
+        return;
+    }
+
+    collector->breaker_failures++;
+    if(collector->breaker == VES_SENDER_BREAKER_HALF_OPEN) {
+        int max = (ves_sender_breaker_probe_interval > VES_SENDER_BACKOFF_MAX) ? ves_sender_breaker_probe_interval : VES_SENDER_BACKOFF_MAX;
+        collector->breaker_interval = (collector->breaker_interval > max / 2) ? max : collector->breaker_interval * 2;
+    }
+
+    if((collector->breaker == VES_SENDER_BREAKER_HALF_OPEN) ||
+        ((collector->breaker == VES_SENDER_BREAKER_CLOSED) && (collector->breaker_failures >= ves_sender_breaker_threshold))) {
+        log_error("ves collector %s unavailable after %d failed requests, circuit open for %d ms", collector->name, collector->breaker_failures, collector->breaker_interval);
+        ves_sender_breaker_open(collector);
+    }
+}
+
+static void ves_sender_breaker_open(ves_sender_collector_t *collector) {
+    collector->breaker = VES_SENDER_BREAKER_OPEN;
+    collector->breaker_until = get_monotonic_milliseconds() + collector->breaker_interval;
+    collector->breaker_probing = false;
+    collector->retry_until = 0;
+    collector->stats.breaker_opened++;
+
+    if(!collector->outbox) {
+        // nothing would send them before the collector is back
+        collector->stats.rejected += ves_sender_queue_len(collector);
+        for(int i = 0; i < VES_SENDER_PRIORITIES; i++) {
+            ves_sender_queue_clear(&collector->queues[i]);
+        }
+    }
+}
+
+// a retried request failed below the breaker threshold: back off exponentially before the next attempt
+static void ves_sender_retry_later(ves_sender_collector_t *collector) {
+    long int now = get_monotonic_milliseconds();
+    if((collector->breaker != VES_SENDER_BREAKER_CLOSED) || (collector->retry_until > now)) {
+        // the other requests in flight fail the same attempt
+        return;
+    }
+
+    collector->retry_until = now + collector->backoff;
+    collector->backoff = (collector->backoff > VES_SENDER_BACKOFF_MAX / 2) ? VES_SENDER_BACKOFF_MAX : collector->backoff * 2;
+}
+
+static void ves_sender_log_stats(void) {
+    for(int i = 0; i < ves_sender_collectors_len; i++) {
+        ves_sender_stats_t stats;
+        ves_sender_get_stats(i, &stats);
+
+        const char *breaker = "closed";
+        if(stats.breaker == VES_SENDER_BREAKER_OPEN) {
+            breaker = "open";
+        }
+        else if(stats.breaker == VES_SENDER_BREAKER_HALF_OPEN) {
+            breaker = "half-open";
+        }
+
+        log("ves sender %s: queue_depth %d, in_flight %d, enqueued %ld, sent %ld, failed %ld, dropped %ld, batches %ld, retried %ld, outbox_pending %ld, breaker %s (opened %ld, rejected %ld), gzip %ld -> %ld bytes",
+            stats.collector, stats.queue_depth, stats.in_flight, stats.enqueued, stats.sent, stats.failed, stats.dropped, stats.batches, stats.retried, stats.outbox_pending,
+            breaker, stats.breaker_opened, stats.rejected, stats.bytes_uncompressed, stats.bytes_compressed);
+    }
+}
+
+/**
+ * gzips data into slot->gzip, growing it when needed
+ * returns the compressed size, or 0 when the body should go out uncompressed
+*/
+static long int ves_sender_deflate(ves_sender_slot_t *slot, const char *data, size_t size) {
+    if(deflateReset(&ves_sender_zstream) != Z_OK) {
+        log_error("deflateReset() failed");
+        return 0;
+    }
+
+    size_t bound = deflateBound(&ves_sender_zstream, size);
+    if(bound > slot->gzip_size) {
+        unsigned char *gzip = (unsigned char *)realloc(slot->gzip, bound);
+        if(gzip == 0) {
+            log_error("realloc failed");
+            return 0;
+        }
+        slot->gzip = gzip;
+        slot->gzip_size = bound;
+    }
+
+    ves_sender_zstream.next_in = (Bytef *)data;
+    ves_sender_zstream.avail_in = size;
+    ves_sender_zstream.next_out = slot->gzip;
+    ves_sender_zstream.avail_out = slot->gzip_size;
+
+    // the buffer holds deflateBound() bytes, so a single call finishes the stream
+    if(deflate(&ves_sender_zstream, Z_FINISH) != Z_STREAM_END) {
+        log_error("deflate() failed");
+        return 0;
+    }
+
+    return (long int)(slot->gzip_size - ves_sender_zstream.avail_out);
+}
@@ -0,0 +1,97 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+
+#pragma once
+
+#include <stdbool.h>
+#include "common/config.h"
+#include "common/histogram.h"
+
+/**
+ * asynchronous VES sender
+ *   rendered events are queued by the callers (alarms, pm_data, ves_loop) which return immediately
+ *   a dedicated thread drives curl_multi with a pool of keep-alive handles, several requests in flight
+ *   the queue is bounded; events arriving while it is full are dropped and counted, unless
+ *   ves.outbox is set: then every event is appended to the on-disk outbox before it is sent,
+ *   acknowledged on 2xx/3xx (or dropped on a 4xx rejection), and transport errors or 5xx make
+ *   the sender replay the outbox in order, also after a restart; every priority is replayed on its own,
+ *   so a backlog of low priority records does not hold back alarms
+ *   a circuit breaker stops all requests once the collector keeps failing and probes it again
+ *   every ves.breaker-probe-interval seconds; meanwhile events fail fast unless the outbox takes them
+ *   with ves.batch-window set, consecutive queued events of the same domain are coalesced
+ *   into one eventBatch request (up to ves.batch-max-events), keeping their order and seq_id
+ *   with ves.compression set, bodies of 512 bytes and more are sent gzip encoded
+ *   events are queued by priority (ves_sender_priority() of their commonEventHeader priority):
+ *   every free handle takes high priority events first and those skip the batch window, so an
+ *   alarm waits at most for one request in flight; low priority events are shaped to
+ *   ves.low-priority-rate events/s with bursts of ves.low-priority-burst; ves.queue-size is per priority
+ *   every event goes to the primary collector (ves.url) and to each of ves.collectors; each collector
+ *   has its own handles, queue, outbox (ves.outbox/<name>) and breaker, all sharing one curl_multi
+*/
+
+typedef enum ves_sender_priority {
+    VES_SENDER_PRIORITY_HIGH = 0,       // alarms, always sent first
+    VES_SENDER_PRIORITY_NORMAL,         // heartbeats
+    VES_SENDER_PRIORITY_LOW,            // file-ready, measurements; shaped by ves.low-priority-rate
+
+    VES_SENDER_PRIORITIES,
+} ves_sender_priority_t;
+
+typedef enum ves_sender_breaker_state {
+    VES_SENDER_BREAKER_CLOSED = 0,
+    VES_SENDER_BREAKER_OPEN,
+    VES_SENDER_BREAKER_HALF_OPEN,
+} ves_sender_breaker_state_t;
+
+typedef struct ves_sender_stats {
+    const char *collector;      // name, valid until ves_sender_free()
+    int queue_depth;
+    int queue_depths[VES_SENDER_PRIORITIES];
+    int in_flight;
+    long int enqueued;
+    long int sent;              // events acknowledged with 2xx/3xx
+    long int failed;            // events lost to transport errors and http >= 400
+    long int dropped;           // rejected because the queue was full
+    long int batches;           // eventBatch requests built by coalescing
+    long int retried;           // events left in the outbox for another attempt
+    long int outbox_pending;    // events in the outbox not acknowledged yet
+    ves_sender_breaker_state_t breaker;
+    long int breaker_opened;    // times the collector was found unavailable
+    long int rejected;          // failed fast while the breaker was open
+    long int bytes_uncompressed;    // bodies sent with Content-Encoding: gzip, before
+    long int bytes_compressed;      // and after compression
+} ves_sender_stats_t;
+
+int ves_sender_init(const config_t *config);
+// waits a short while for queued and in flight events before stopping
+void ves_sender_free();
+
+// takes ownership of post_data; batch tells post_data already is an eventList for url/eventBatch
+int ves_sender_enqueue(char *post_data, const char *domain, bool batch, ves_sender_priority_t priority);
+ves_sender_priority_t ves_sender_priority(const char *priority);
+
+int ves_sender_collectors_count(void);
+void ves_sender_get_stats(int collector, ves_sender_stats_t *stats);
+// enqueue to acknowledgement time of the events sent so far, in us; replayed events are not counted
+void ves_sender_get_latency(int collector, ves_sender_priority_t priority, histogram_t *latency);
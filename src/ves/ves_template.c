@@ -0,0 +1,211 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+
+#define _GNU_SOURCE
+
+#include "ves_template.h"
+#include "common/log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static size_t ves_template_placeholder(const char *s);
+static const char *ves_template_lookup(const ves_template_field_t *fields, int fields_len, const char *name, size_t name_len);
+static int ves_template_add_chunk(ves_template_t *template, size_t offset, size_t length, const char *slot, size_t slot_len);
+
+ves_template_t *ves_template_compile(const char *content, const ves_template_field_t *invariant, int invariant_len) {
+    char *text = 0;
+    size_t text_size = 0;
+    FILE *f = 0;
+
+    ves_template_t *template = (ves_template_t *)calloc(1, sizeof(ves_template_t));
+    if(template == 0) {
+        log_error("calloc failed");
+        goto failed;
+    }
+
+    f = open_memstream(&text, &text_size);
+    if(f == 0) {
+        log_error("open_memstream failed");
+        goto failed;
+    }
+
+    size_t chunk_offset = 0;
+    const char *p = content;
+    while(*p) {
+        size_t name_len = ves_template_placeholder(p);
+        if(name_len == 0) {
+            fputc(*p, f);
+            p++;
+            continue;
+        }
+
+        const char *name = p + 1;
+        p += name_len + 2;
+
+        const char *value = ves_template_lookup(invariant, invariant_len, name, name_len);
+        if(value) {
+            fputs(value, f);
+            continue;
+        }
+
+        fflush(f);
+        if(ves_template_add_chunk(template, chunk_offset, text_size - chunk_offset, name, name_len) != 0) {
+            goto failed;
+        }
+        chunk_offset = text_size;
+    }
+
+    fflush(f);
+    if(ves_template_add_chunk(template, chunk_offset, text_size - chunk_offset, 0, 0) != 0) {
+        goto failed;
+    }
+
+    if(fclose(f) != 0) {
+        f = 0;
+        log_error("fclose failed");
+        goto failed;
+    }
+    template->text = text;
+
+    return template;
+
+failed:
+    if(f) {
+        fclose(f);
+    }
+    free(text);
+    ves_template_free(template);
+
+    return 0;
+}
+
+void ves_template_free(ves_template_t *template) {
+    if(template == 0) {
+        return;
+    }
+
+    for(int i = 0; i < template->chunks_len; i++) {
+        free(template->chunks[i].slot);
+    }
+    free(template->chunks);
+    free(template->text);
+    free(template);
+}
+
+char *ves_template_render(const ves_template_t *template, const ves_template_field_t *fields, int fields_len) {
+    const char *values[template->chunks_len];
+    size_t values_len[template->chunks_len];
+    size_t length = 0;
+
+    for(int i = 0; i < template->chunks_len; i++) {
+        const ves_template_chunk_t *chunk = &template->chunks[i];
+        length += chunk->length;
+
+        values[i] = 0;
+        values_len[i] = 0;
+        if(chunk->slot) {
+            values[i] = ves_template_lookup(fields, fields_len, chunk->slot, strlen(chunk->slot));
+            values_len[i] = values[i] ? strlen(values[i]) : strlen(chunk->slot) + 2;
+        }
+        length += values_len[i];
+    }
+
+    char *event = (char *)malloc(length + 1);
+    if(event == 0) {
+        log_error("malloc failed");
+        return 0;
+    }
+
+    char *p = event;
+    for(int i = 0; i < template->chunks_len; i++) {
+        const ves_template_chunk_t *chunk = &template->chunks[i];
+        memcpy(p, template->text + chunk->offset, chunk->length);
+        p += chunk->length;
+
+        if(values[i]) {
+            memcpy(p, values[i], values_len[i]);
+        }
+        else if(chunk->slot) {
+            sprintf(p, "@%s@", chunk->slot);
+        }
+        p += values_len[i];
+    }
+    *p = 0;
+
+    return event;
+}
+
+// returns the name length when s starts with @name@, 0 otherwise
+static size_t ves_template_placeholder(const char *s) {
+    if(s[0] != '@') {
+        return 0;
+    }
+
+    size_t i = 1;
+    while((s[i] == '-') || (s[i] == '_') || ((s[i] >= '0') && (s[i] <= '9')) || ((s[i] >= 'a') && (s[i] <= 'z')) || ((s[i] >= 'A') && (s[i] <= 'Z'))) {
+        i++;
+    }
+
+    if((i == 1) || (s[i] != '@')) {
+        return 0;
+    }
+
+    return i - 1;
+}
+
+static const char *ves_template_lookup(const ves_template_field_t *fields, int fields_len, const char *name, size_t name_len) {
+    for(int i = 0; i < fields_len; i++) {
+        if((strncmp(fields[i].name, name, name_len) == 0) && (fields[i].name[name_len] == 0)) {
+            return fields[i].value;
+        }
+    }
+
+    return 0;
+}
+
+static int ves_template_add_chunk(ves_template_t *template, size_t offset, size_t length, const char *slot, size_t slot_len) {
+    ves_template_chunk_t *chunks = (ves_template_chunk_t *)realloc(template->chunks, sizeof(ves_template_chunk_t) * (template->chunks_len + 1));
+    if(chunks == 0) {
+        log_error("realloc failed");
+        return 1;
+    }
+    template->chunks = chunks;
+
+    ves_template_chunk_t *chunk = &template->chunks[template->chunks_len];
+    chunk->offset = offset;
+    chunk->length = length;
+    chunk->slot = 0;
+    if(slot) {
+        chunk->slot = strndup(slot, slot_len);
+        if(chunk->slot == 0) {
+            log_error("strndup failed");
+            return 1;
+        }
+    }
+    template->chunks_len++;
+
+    return 0;
+}
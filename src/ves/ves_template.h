@@ -0,0 +1,59 @@
+/*
+* Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+* contributor license agreements.  See the NOTICE file distributed with
+* this work for additional information regarding copyright ownership.
+* The OpenAirInterface Software Alliance licenses this file to You under
+* the OAI Public License, Version 1.1  (the "License"); you may not use this file
+* except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.openairinterface.org/?page_id=698
+*
+* Copyright: Fraunhofer Heinrich Hertz Institute
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*-------------------------------------------------------------------------------
+* For more information about the OpenAirInterface (OAI) Software Alliance:
+*      contact@openairinterface.org
+*/
+
+
+#pragma once
+
+#include <stddef.h>
+
+#define VES_TEMPLATE_MAX_FIELDS     16
+
+/**
+ * precompiled @placeholder@ templates
+ *   compiling substitutes the invariant fields once and splits the rest of the text
+ *   into literal chunks, each followed by the name of a volatile slot
+ *   rendering fills the slots and builds the event with a single allocation;
+ *   slots without a value are kept as @name@, like str_replace_inplace() leaves them
+*/
+typedef struct ves_template_field {
+    const char *name;           // placeholder without the surrounding @
+    const char *value;
+} ves_template_field_t;
+
+typedef struct ves_template_chunk {
+    size_t offset;              // literal text in ves_template_t.text
+    size_t length;
+    char *slot;                 // placeholder following the literal, 0 for the last chunk
+} ves_template_chunk_t;
+
+typedef struct ves_template {
+    char *text;
+    ves_template_chunk_t *chunks;
+    int chunks_len;
+} ves_template_t;
+
+ves_template_t *ves_template_compile(const char *content, const ves_template_field_t *invariant, int invariant_len);
+void ves_template_free(ves_template_t *template);
+
+// returns a newly allocated event, or 0 on failure
+char *ves_template_render(const ves_template_t *template, const ves_template_field_t *fields, int fields_len);